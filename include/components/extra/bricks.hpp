@@ -0,0 +1,307 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <array>
+#include <atomic>
+#include <span>
+#include <utility>
+#include <vector>
+//
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <fmt/base.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include "core/buffer.hpp"
+#include "core/image.hpp"
+#include "core/parallel.hpp"
+
+// sparse brick map of the grid signed distances, sphere traced by extra/bricks.frag and sampled by extra/slice.comp
+// the indirection volume holds the atlas slot of every brick (0 when empty), the atlas 8³ samples per brick
+// neighbouring bricks share their border samples, so each covers 7³ voxels and is filtered without neighbour lookups
+struct Bricks {
+    // query points have to lie on a lattice with the given spacing, starting at origin
+    template<typename QueryPoint>
+    auto init(vk::Device device, vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<const QueryPoint> query_points, glm::vec3 origin, glm::vec3 extent, float voxelsize) -> bool {
+        if (!init_dims(origin, extent, voxelsize)) return false;
+        auto get_sample = [&](const QueryPoint& point) -> glm::uvec3 {
+            return glm::uvec3(glm::round((point.first - origin) / voxelsize));
+        };
+        auto get_brick_i = [&](glm::uvec3 brick) -> std::size_t {
+            return ((std::size_t)brick.z * _dims.y + brick.y) * _dims.x + brick.x;
+        };
+
+        // mark bricks holding at least one sample in their interior, then assign atlas slots in order
+        std::vector<uint32_t> indirection((std::size_t)_dims.x * _dims.y * _dims.z, 0);
+        std::size_t batch_size = 1 << 16;
+        std::size_t batch_n = (query_points.size() + batch_size - 1) / batch_size;
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) {
+                glm::uvec3 brick = glm::min(get_sample(query_points[i]) / brick_voxels, _dims - 1u);
+                std::atomic_ref(indirection[get_brick_i(brick)]).store(1, std::memory_order_relaxed);
+            }
+        });
+        _brick_n = 0;
+        for (uint32_t flag: indirection) _brick_n += flag;
+        if (!init_atlas_extent()) return false;
+        uint32_t slots_x = _atlas_extent.width / brick_samples;
+        uint32_t slots_y = _atlas_extent.height / brick_samples;
+        std::vector<uint32_t> entries;
+        entries.reserve(_brick_n);
+        for (uint32_t i = 0, slot = 0; i < indirection.size(); i++) {
+            if (indirection[i] == 0) continue;
+            indirection[i] = 1u << 31 | slot % slots_x | slot / slots_x % slots_y << 8 | slot / (slots_x * slots_y) << 16;
+            entries.push_back(indirection[i]);
+            slot++;
+        }
+
+        // samples missing within occupied bricks are filled from the nearest known sample of the same brick
+        std::size_t texel_n = (std::size_t)_atlas_extent.width * _atlas_extent.height * _atlas_extent.depth;
+        init_staging(vmalloc, queues, _staging_atlas, texel_n * sizeof(uint16_t));
+        init_staging(vmalloc, queues, _staging_indirection, indirection.size() * sizeof(uint32_t));
+        std::memcpy(_staging_indirection.map(vmalloc), indirection.data(), indirection.size() * sizeof(uint32_t));
+        vmalloc.unmapMemory(_staging_indirection._allocation);
+        uint16_t* atlas_p = static_cast<uint16_t*>(_staging_atlas.map(vmalloc));
+        parallel::for_each((texel_n + batch_size - 1) / batch_size, [&](std::size_t b) {
+            std::fill(atlas_p + b * batch_size, atlas_p + std::min(texel_n, (b + 1) * batch_size), missing);
+        });
+        // samples on the lower border of a brick are shared with the upper border of the previous one
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) {
+                glm::uvec3 sample = get_sample(query_points[i]);
+                uint16_t distance = glm::packHalf1x16(query_points[i].second);
+                for (uint32_t corner = 0; corner < 8; corner++) {
+                    glm::uvec3 brick = sample / brick_voxels;
+                    glm::uvec3 local = sample % brick_voxels;
+                    bool valid = true;
+                    for (int axis = 0; axis < 3; axis++) {
+                        if ((corner >> axis & 1) == 0) continue;
+                        valid = valid && local[axis] == 0 && brick[axis] > 0;
+                        brick[axis] -= 1;
+                        local[axis] = brick_voxels;
+                    }
+                    if (!valid || glm::any(glm::greaterThanEqual(brick, _dims))) continue;
+                    uint32_t entry = indirection[get_brick_i(brick)];
+                    if (entry == 0) continue;
+                    glm::uvec3 texel = glm::uvec3(entry & 0xff, entry >> 8 & 0xff, entry >> 16 & 0xff) * brick_samples + local;
+                    atlas_p[((std::size_t)texel.z * _atlas_extent.height + texel.y) * _atlas_extent.width + texel.x] = distance;
+                }
+            }
+        });
+        parallel::for_each(entries.size(), [&](std::size_t e) {
+            fill_missing(atlas_p, glm::uvec3(entries[e] & 0xff, entries[e] >> 8 & 0xff, entries[e] >> 16 & 0xff) * brick_samples);
+        });
+        vmalloc.unmapMemory(_staging_atlas._allocation);
+        init_images(device, vmalloc);
+        fmt::println("brick map: {} of {} bricks occupied ({:.1f}%), {:.1f} MB atlas",
+            _brick_n, indirection.size(), 100.0 * get_occupancy(), (double)get_memory_size() / (1024.0 * 1024.0));
+        return true;
+    }
+    // restore the staged contents of an earlier brick map over the same query points, e.g. from a cache
+    auto init(vk::Device device, vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<const uint32_t> indirection, std::span<const uint16_t> atlas, glm::vec3 origin, glm::vec3 extent, float voxelsize) -> bool {
+        if (!init_dims(origin, extent, voxelsize)) return false;
+        if (indirection.size() != (std::size_t)_dims.x * _dims.y * _dims.z) return false;
+        _brick_n = 0;
+        for (uint32_t entry: indirection) _brick_n += entry != 0;
+        if (!init_atlas_extent()) return false;
+        if (atlas.size() != (std::size_t)_atlas_extent.width * _atlas_extent.height * _atlas_extent.depth) {
+            _brick_n = 0;
+            return false;
+        }
+        init_staging(vmalloc, queues, _staging_indirection, indirection.size_bytes());
+        init_staging(vmalloc, queues, _staging_atlas, atlas.size_bytes());
+        std::memcpy(_staging_indirection.map(vmalloc), indirection.data(), indirection.size_bytes());
+        vmalloc.unmapMemory(_staging_indirection._allocation);
+        std::memcpy(_staging_atlas.map(vmalloc), atlas.data(), atlas.size_bytes());
+        vmalloc.unmapMemory(_staging_atlas._allocation);
+        init_images(device, vmalloc);
+        return true;
+    }
+    // staged contents until the upload has finished, to be passed to init() later, unmap_staged() afterwards
+    auto map_staged(vma::Allocator vmalloc) -> std::pair<std::span<const uint32_t>, std::span<const uint16_t>> {
+        if (!_staged) return {};
+        std::size_t texel_n = (std::size_t)_atlas_extent.width * _atlas_extent.height * _atlas_extent.depth;
+        return {
+            { static_cast<const uint32_t*>(_staging_indirection.map(vmalloc)), (std::size_t)_dims.x * _dims.y * _dims.z },
+            { static_cast<const uint16_t*>(_staging_atlas.map(vmalloc)), texel_n },
+        };
+    }
+    void unmap_staged(vma::Allocator vmalloc) {
+        if (!_staged) return;
+        vmalloc.unmapMemory(_staging_indirection._allocation);
+        vmalloc.unmapMemory(_staging_atlas._allocation);
+    }
+    void destroy(vk::Device device, vma::Allocator vmalloc) {
+        if (_brick_n == 0) return;
+        release_staging(vmalloc);
+        _indirection.destroy(device, vmalloc);
+        _atlas.destroy(device, vmalloc);
+        _brick_n = 0;
+    }
+    // copy the staged volumes into their images, recorded once before their first use
+    void upload(vk::CommandBuffer cmd, uint64_t frame_i) {
+        if (_uploaded) return;
+        for (auto [image_p, staging_p]: { std::pair(&_indirection, &_staging_indirection), std::pair(&_atlas, &_staging_atlas) }) {
+            image_p->transition_layout({
+                .cmd = cmd,
+                .new_layout = vk::ImageLayout::eTransferDstOptimal,
+                .dst_stage = vk::PipelineStageFlagBits2::eCopy,
+                .dst_access = vk::AccessFlagBits2::eTransferWrite,
+            });
+            vk::BufferImageCopy region {
+                .bufferOffset = 0,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource { .aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+                .imageOffset = vk::Offset3D(0, 0, 0),
+                .imageExtent = image_p->_extent,
+            };
+            cmd.copyBufferToImage(staging_p->_data, image_p->_image, vk::ImageLayout::eTransferDstOptimal, region);
+            image_p->transition_layout({
+                .cmd = cmd,
+                .new_layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                .dst_stage = vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+                .dst_access = vk::AccessFlagBits2::eShaderSampledRead,
+            });
+        }
+        _uploaded = true;
+        _upload_frame = frame_i;
+    }
+    // free the staging buffers once the upload has finished
+    void release_staging(vma::Allocator vmalloc) {
+        if (!_staged) return;
+        _staging_indirection.destroy(vmalloc);
+        _staging_atlas.destroy(vmalloc);
+        _staged = false;
+    }
+    auto get_occupancy() const -> double {
+        return (double)_brick_n / ((double)_dims.x * _dims.y * _dims.z);
+    }
+    auto get_memory_size() const -> std::size_t {
+        return (std::size_t)_atlas_extent.width * _atlas_extent.height * _atlas_extent.depth * sizeof(uint16_t)
+            + (std::size_t)_dims.x * _dims.y * _dims.z * sizeof(uint32_t);
+    }
+
+    static constexpr uint32_t brick_samples = 8;
+    static constexpr uint32_t brick_voxels = brick_samples - 1;
+    static constexpr uint32_t max_slots = 256; // per atlas axis, as slots are packed into 8 bits each
+    static constexpr uint32_t max_dim = 2048; // guaranteed 3d image size
+    static constexpr uint16_t missing = 0xffff; // half nan, marks atlas samples without a query point
+    Image _indirection; // R32Uint, 1 << 31 | slot z << 16 | slot y << 8 | slot x when occupied
+    Image _atlas; // R16Sfloat, signed distances in voxels
+    glm::vec3 _origin = glm::vec3(0); // position of the first sample
+    float _voxelsize = 1.0f;
+    glm::uvec3 _dims = glm::uvec3(0); // bricks along each axis
+    vk::Extent3D _atlas_extent;
+    uint32_t _brick_n = 0;
+    bool _staged = false; // staging buffers are still alive
+    bool _uploaded = false; // copies into the images have been recorded
+    uint64_t _upload_frame = 0; // frame the copies were recorded in
+    double _trace_ms = 0.0; // of the last frame, as read back by the renderer
+
+private:
+    // images are filled on the render thread, see upload()
+    void init_images(vk::Device device, vma::Allocator vmalloc) {
+        _indirection.init({
+            .device = device, .vmalloc = vmalloc,
+            .format = vk::Format::eR32Uint,
+            .extent { _dims.x, _dims.y, _dims.z },
+            .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+            .type = vk::ImageType::e3D,
+        });
+        _atlas.init({
+            .device = device, .vmalloc = vmalloc,
+            .format = vk::Format::eR16Sfloat,
+            .extent = _atlas_extent,
+            .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+            .type = vk::ImageType::e3D,
+        });
+        _staged = true;
+        _uploaded = false;
+    }
+    auto init_dims(glm::vec3 origin, glm::vec3 extent, float voxelsize) -> bool {
+        _origin = origin;
+        _voxelsize = voxelsize;
+        glm::uvec3 samples = glm::uvec3(glm::round(extent / voxelsize)) + 1u;
+        _dims = (samples - 1u) / brick_voxels + 1u;
+        if (glm::any(glm::greaterThan(_dims, glm::uvec3(max_dim)))) {
+            fmt::println("grid too large for a brick map: {}x{}x{} bricks", _dims.x, _dims.y, _dims.z);
+            return false;
+        }
+        return true;
+    }
+    // atlas slots of _brick_n bricks, filled row by row
+    auto init_atlas_extent() -> bool {
+        uint32_t slots_x = std::max<uint32_t>(std::min<uint32_t>(_brick_n, max_slots), 1);
+        uint32_t slots_y = std::min<uint32_t>((_brick_n + slots_x - 1) / slots_x, max_slots);
+        uint32_t slots_z = (_brick_n + slots_x * slots_y - 1) / std::max<uint32_t>(slots_x * slots_y, 1);
+        if (_brick_n == 0 || slots_z > max_slots) {
+            fmt::println("unable to fit {} bricks into the atlas", _brick_n);
+            _brick_n = 0;
+            return false;
+        }
+        _atlas_extent = vk::Extent3D { slots_x * brick_samples, slots_y * brick_samples, slots_z * brick_samples };
+        return true;
+    }
+    // grow the known samples of one brick into its missing ones, one texel per pass along the 6 axis neighbours
+    // interior query points always land in their own brick, so every occupied brick holds at least one known sample
+    void fill_missing(uint16_t* atlas_p, glm::uvec3 base) const {
+        std::array<uint16_t, brick_samples * brick_samples * brick_samples> local, next;
+        auto get_texel_i = [&](glm::uvec3 texel) -> std::size_t {
+            return ((std::size_t)texel.z * _atlas_extent.height + texel.y) * _atlas_extent.width + texel.x;
+        };
+        auto get_local_i = [](glm::uvec3 local) -> uint32_t {
+            return (local.z * brick_samples + local.y) * brick_samples + local.x;
+        };
+        auto get_local = [](uint32_t i) -> glm::uvec3 {
+            return glm::uvec3(i % brick_samples, i / brick_samples % brick_samples, i / (brick_samples * brick_samples));
+        };
+        bool missing_any = false;
+        for (uint32_t i = 0; i < local.size(); i++) {
+            glm::uvec3 texel = base + get_local(i);
+            local[i] = atlas_p[get_texel_i(texel)];
+            missing_any = missing_any || local[i] == missing;
+        }
+        if (!missing_any) return;
+        for (bool changed = true; changed;) {
+            changed = false;
+            next = local;
+            for (uint32_t i = 0; i < local.size(); i++) {
+                if (local[i] != missing) continue;
+                glm::uvec3 sample = get_local(i);
+                for (uint32_t n = 0; n < 6 && next[i] == missing; n++) {
+                    glm::uvec3 neighbor = sample;
+                    uint32_t axis = n / 2;
+                    if (n % 2 == 0 && neighbor[axis] == 0) continue;
+                    if (n % 2 == 1 && neighbor[axis] == brick_voxels) continue;
+                    neighbor[axis] = n % 2 == 0 ? neighbor[axis] - 1 : neighbor[axis] + 1;
+                    next[i] = local[get_local_i(neighbor)];
+                }
+                changed = changed || next[i] != missing;
+            }
+            local = next;
+        }
+        for (uint32_t i = 0; i < local.size(); i++) {
+            glm::uvec3 texel = base + get_local(i);
+            atlas_p[get_texel_i(texel)] = local[i];
+        }
+    }
+    static void init_staging(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, DeviceBuffer<std::byte>& buffer, vk::DeviceSize size) {
+        buffer.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = size,
+                .usage = vk::BufferUsageFlagBits::eTransferSrc,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            vma::AllocationCreateInfo {
+                .flags = vma::AllocationCreateFlagBits::eHostAccessRandom,
+                .usage = vma::MemoryUsage::eAutoPreferHost,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            });
+    }
+    DeviceBuffer<std::byte> _staging_indirection;
+    DeviceBuffer<std::byte> _staging_atlas;
+};
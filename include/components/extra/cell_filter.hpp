@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <optional>
+//
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <glm/glm.hpp>
+#include "core/buffer.hpp"
+#include "components/extra/grid.hpp"
+
+// selects the grid cells near the surface on the gpu, see extra/cell_filter.comp
+// passing cells are compacted into a list, which is drawn as one wireframe cube instance each
+struct CellFilter {
+    // predicates a cell has to pass, all enabled ones are combined
+    struct Settings {
+        glm::vec3 box_min = glm::vec3(0.0f); // clip box relative to the grid bounds
+        glm::vec3 box_max = glm::vec3(1.0f);
+        float threshold = 0.5f; // largest distance of the closest corner, in voxels
+        bool zero_crossing = true;
+        bool near_surface = false;
+        bool box = false;
+        auto operator==(const Settings& other) const -> bool = default;
+    };
+
+    // allocate the compacted list for the worst case, the grid has to stay alive
+    auto init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, const Grid& grid) -> bool {
+        _cell_n = grid._cell_n;
+        _selected.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = (vk::DeviceSize)_cell_n * sizeof(uint32_t),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            vma::AllocationCreateInfo {
+                .usage = vma::MemoryUsage::eAutoPreferDevice,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal,
+            });
+        // instance count is reset and counted on the gpu, then read back for display
+        _draw.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = sizeof(vk::DrawIndirectCommand),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            vma::AllocationCreateInfo {
+                .flags = vma::AllocationCreateFlagBits::eHostAccessRandom,
+                .usage = vma::MemoryUsage::eAuto,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            });
+        _draw_mapped_p = _draw.map(vmalloc);
+        vk::DrawIndirectCommand draw { .vertexCount = vertices_per_cell, .instanceCount = 0, .firstVertex = 0, .firstInstance = 0 };
+        std::memcpy(_draw_mapped_p, &draw, sizeof(draw));
+        _settings_applied.reset();
+        return true;
+    }
+    void destroy(vma::Allocator vmalloc) {
+        if (_draw_mapped_p == nullptr) return;
+        vmalloc.unmapMemory(_draw._allocation);
+        _draw_mapped_p = nullptr;
+        _selected.destroy(vmalloc);
+        _draw.destroy(vmalloc);
+    }
+    void draw(vk::CommandBuffer cmd) {
+        cmd.drawIndirect(_draw._data, 0, 1, sizeof(vk::DrawIndirectCommand));
+    }
+    // read back the number of selected cells, the filter submission has to be finished
+    auto get_selected_count() const -> uint32_t {
+        vk::DrawIndirectCommand draw;
+        std::memcpy(&draw, _draw_mapped_p, sizeof(draw));
+        return draw.instanceCount;
+    }
+
+    static constexpr uint32_t vertices_per_cell = 24; // line list of the 12 cube edges
+    DeviceBuffer<uint32_t> _selected; // cell indices
+    DeviceBuffer<vk::DrawIndirectCommand> _draw;
+    void* _draw_mapped_p = nullptr;
+    uint32_t _cell_n = 0;
+    std::optional<Settings> _settings_applied; // of the current selection
+    // of the last filter pass, as read back by the renderer
+    uint32_t _selected_n = 0;
+    double _filter_ms = 0.0;
+};
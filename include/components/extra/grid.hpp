@@ -1,81 +1,479 @@
 #pragma once
-#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <string>
 #include <vector>
+#include <span>
 #include <array>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <bit>
 //
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.hpp>
 #include <fmt/base.h>
 #include <glm/glm.hpp>
-#include "components/mesh/mesh.hpp"
-#include "components/mesh/vertices.hpp"
-#include "components/mesh/indices.hpp"
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#endif
+#include "core/buffer.hpp"
+#include "core/queues.hpp"
+#include "core/staging.hpp"
+#include "core/cache.hpp"
+#include "components/extra/bricks.hpp"
+#include "components/extra/sdf_index.hpp"
+#include "core/parallel.hpp"
+#include "core/platform.hpp"
 
 struct Grid {
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::string_view path_rel) {
-		std::ifstream file;
+    // returns whether the grid was uploaded, the cache holds the converted query points, the raw cells, unique cell edges, the brick map and the sdf index
+    // reordering sorts query points and cells along a z-order curve instead of keeping the hash table order of the file
+    // measuring converts the file even when cached, to time traversals of the cells before and after reordering
+    auto init(vk::Device device, vma::Allocator vmalloc, Queues& queues, std::string_view path_rel, bool use_cache = false, bool reorder = false, bool measure = false) -> bool {
+        auto time_beg = std::chrono::steady_clock::now();
+        _traversal_rate = 0.0;
+        _traversal_rate_unordered = 0.0;
         std::string path_full = SDL_GetBasePath();
         path_full.append(path_rel.data());
-		file.open(path_full, std::ifstream::binary);
-        if (file.good()) {
-            // read header
-            float voxelsize = 0;
-            std::size_t query_points_n = 0;
-            std::size_t cells_n = 0;
-			file.read(reinterpret_cast<char*>(&voxelsize), sizeof(float));
-			file.read(reinterpret_cast<char*>(&query_points_n), sizeof(std::size_t));
-			file.read(reinterpret_cast<char*>(&cells_n), sizeof(std::size_t));
-            fmt::println("voxelsize of: {} with {} query points and {} cells", voxelsize, query_points_n, cells_n);
-            
-			// alloc and read query points
-			std::vector<QueryPoint> query_points;
-            query_points.reserve(query_points_n);
-            for (std::size_t i = 0; i < query_points_n; i++) {
-                glm::vec3 position;
-				float signed_distance;
-				file.read(reinterpret_cast<char*>(&position), sizeof(glm::vec3));
-				file.read(reinterpret_cast<char*>(&signed_distance), sizeof(float));
-                std::swap(position.y, position.z);
-                position.y *= -1.0;
-                query_points.emplace_back(position, signed_distance * (1.0f / voxelsize));
-            }
-            // alloc and read cells (indexing into query points)
-            std::vector<Index> cell_indices;
-            cell_indices.reserve(cells_n * 8); // TODO: multiply with indices per cell
-            for (std::size_t i = 0; i < cells_n; i++) {
-                std::array<Index, 8> cell;
-				file.read(reinterpret_cast<char*>(cell.data()), sizeof(cell));
-                // build cell edge via line strip indices
-                // front side
-                cell_indices.insert(cell_indices.end(), cell.cbegin() + 0, cell.cbegin() + 4);
-                cell_indices.push_back(cell[0]);
-                // back side
-                cell_indices.insert(cell_indices.end(), cell.cbegin() + 4, cell.cbegin() + 8);
-                cell_indices.push_back(cell[4]);
-                cell_indices.push_back(std::numeric_limits<Index>().max()); // restart strip
-                // missing edges
-                cell_indices.push_back(cell[3]);
-                cell_indices.push_back(cell[7]);
-                cell_indices.push_back(cell[6]);
-                cell_indices.push_back(cell[2]);
-                cell_indices.push_back(cell[1]);
-                cell_indices.push_back(cell[5]);
-                cell_indices.push_back(std::numeric_limits<Index>().max()); // restart strip
-            }
-			_query_points.init(vmalloc, queues, query_points, cell_indices);
+        std::string path_cache = path_full + ".cache";
+        cache::Stamp stamp = cache::get_stamp(path_full, cache_version, reorder ? 1 : 0);
+        if (use_cache && !measure && load_cache(device, vmalloc, queues, path_cache, stamp)) return true;
+        if (use_cache && !measure) fmt::println("building cache for {}", path_rel);
 
+        platform::MappedFile file;
+        if (!file.open(path_full)) {
+            fmt::println("unable to read grid: {}", path_full);
+            return false;
+        }
+        // header sizes have to match the file, as they decide how much is read
+        auto data = file.data();
+        Header header;
+        if (data.size() < header_size) {
+            fmt::println("corrupted grid header: {}", path_full);
             file.close();
+            return false;
         }
-        else {
-            fmt::println("unable to read grid: {}", path_full);
+        std::memcpy(&header.voxelsize, data.data(), sizeof(float));
+        std::memcpy(&header.query_points_n, data.data() + sizeof(float), sizeof(uint64_t));
+        std::memcpy(&header.cells_n, data.data() + sizeof(float) + sizeof(uint64_t), sizeof(uint64_t));
+        std::size_t body_size = data.size() - header_size;
+        bool valid = header.voxelsize > 0.0f && header.voxelsize < std::numeric_limits<float>::infinity();
+        valid = valid && header.query_points_n <= body_size / point_size;
+        valid = valid && header.cells_n <= (body_size - header.query_points_n * point_size) / cell_size;
+        valid = valid && header.query_points_n > 0 && header.query_points_n <= std::numeric_limits<Index>::max();
+        valid = valid && header.cells_n > 0 && header.cells_n <= std::numeric_limits<uint32_t>::max() / (2 * cell_edges.size());
+        if (!valid) {
+            fmt::println("corrupted grid header: {} (voxelsize {}, {} query points and {} cells in {} bytes)",
+                path_full, header.voxelsize, header.query_points_n, header.cells_n, data.size());
+            file.close();
+            return false;
+        }
+        std::size_t trailing = body_size - header.query_points_n * point_size - header.cells_n * cell_size;
+        if (trailing > 0) fmt::println("ignoring {} trailing bytes in {}", trailing, path_full);
+        fmt::println("voxelsize of: {} with {} query points and {} cells", header.voxelsize, header.query_points_n, header.cells_n);
+
+        // swizzle positions and scale distances in one parallel pass over the mapping
+        std::vector<QueryPoint> query_points(header.query_points_n);
+        auto points_src = data.subspan(header_size, header.query_points_n * point_size);
+        float scale = 1.0f / header.voxelsize;
+        std::size_t batch_size = 1 << 16;
+        parallel::for_each((query_points.size() + batch_size - 1) / batch_size, [&](std::size_t b) {
+            std::size_t beg = b * batch_size;
+            std::size_t end = std::min(query_points.size(), beg + batch_size);
+            convert_points(points_src.data() + beg * point_size, scale, reinterpret_cast<float*>(query_points.data() + beg), end - beg);
+        });
+        // cells are uploaded unchanged after validation, their edges are shared with neighbours and get deduplicated below
+        // they start 4 byte aligned within the page aligned mapping, as the header is 20 bytes
+        auto cells = std::span(reinterpret_cast<const Cell*>(data.data() + header_size + header.query_points_n * point_size), header.cells_n);
+        std::atomic<std::size_t> invalid_n = 0;
+        parallel::for_each((header.cells_n + batch_size - 1) / batch_size, [&](std::size_t b) {
+            std::size_t beg = b * batch_size;
+            std::size_t end = std::min<std::size_t>(header.cells_n, beg + batch_size);
+            std::size_t batch_invalid_n = 0;
+            for (std::size_t i = beg; i < end; i++) {
+                for (Index corner: cells[i]) batch_invalid_n += corner >= header.query_points_n;
+            }
+            invalid_n += batch_invalid_n;
+        });
+        if (invalid_n > 0) {
+            fmt::println("corrupted grid cells: {} corners out of range in {}", invalid_n.load(), path_full);
+            file.close();
+            return false;
+        }
+        std::vector<Cell> cells_reordered;
+        if (reorder) {
+            if (measure) _traversal_rate_unordered = get_traversal_rate(query_points, cells).first;
+            cells_reordered = reorder_z(query_points, cells, header.voxelsize);
+            cells = cells_reordered;
+        }
+        if (measure) {
+            auto [traversal_rate, crossing_n] = get_traversal_rate(query_points, cells);
+            _traversal_rate = traversal_rate;
+            fmt::println("{} cells cross the zero level, traversed at {:.1f} M cells/s", crossing_n, _traversal_rate / 1'000'000.0);
+            if (reorder) fmt::println("traversed at {:.1f} M cells/s before reordering", _traversal_rate_unordered / 1'000'000.0);
         }
+        std::vector<Edge> edges = get_edges(cells);
+        std::size_t edges_all_n = cells.size() * cell_edges.size();
+        fmt::println("removed {} of {} cell edges as duplicates ({:.1f}%)", edges_all_n - edges.size(), edges_all_n,
+            100.0 * (double)(edges_all_n - edges.size()) / (double)edges_all_n);
+        CacheMeta meta { .voxelsize = header.voxelsize, .bricks = 0 };
+        upload(device, vmalloc, queues, meta, query_points, cells, edges);
+        meta.bricks = _bricks._brick_n > 0;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_beg).count();
+        double mb = (double)data.size() / (1024.0 * 1024.0);
+        fmt::println("loaded grid in {:.1f} ms ({:.1f} MB/s, {} point conversion)", ms, mb / (ms / 1000.0), simd_name);
+
+        cache::Writer writer;
+        if (use_cache && writer.open(path_cache, section_n)) {
+            write_cache(vmalloc, writer, stamp, meta, query_points, cells, edges);
+        }
+        file.close();
+        return true;
     }
-    void destroy(vma::Allocator vmalloc) {
+    void destroy(vk::Device device, vma::Allocator vmalloc) {
+        if (_edge_n == 0) return;
 		_query_points.destroy(vmalloc);
+		_cells.destroy(vmalloc);
+		_edges.destroy(vmalloc);
+        _bricks.destroy(device, vmalloc);
+        _index.destroy();
+        _cell_n = 0;
+        _edge_n = 0;
+    }
+    // non-indexed line list, the vertex shader pulls both query points of each unique edge
+    void draw(vk::CommandBuffer cmd) {
+        cmd.draw(_edge_n * 2, 1, 0, 0);
     }
     
 public:
     typedef uint32_t Index;
     typedef std::pair<glm::vec3, float> QueryPoint;
-    Mesh<QueryPoint, Index> _query_points; // indexed line list
-};
\ No newline at end of file
+    typedef std::array<Index, 8> Cell;
+    typedef std::array<Index, 2> Edge; // query point indices, smaller one first
+    DeviceBuffer<QueryPoint> _query_points; // storage buffer
+    DeviceBuffer<Cell> _cells; // storage buffer, as stored in the file unless reordered
+    DeviceBuffer<Edge> _edges; // storage buffer, each edge shared by neighbouring cells is stored once
+    uint32_t _query_point_n = 0;
+    uint32_t _cell_n = 0;
+    uint32_t _edge_n = 0;
+    glm::vec3 _bounds_min = glm::vec3(0);
+    glm::vec3 _bounds_max = glm::vec3(0); // of the query point positions
+    float _voxelsize = 1.0f; // spacing of the query point lattice
+    Bricks _bricks; // signed distances for sphere tracing, empty when the grid does not fit
+    SdfIndex _index; // cpu copy of the signed distances, kept for queries after loading
+    // cells per second visiting all corners in buffer order, zero unless measured while converting
+    double _traversal_rate = 0.0;
+    double _traversal_rate_unordered = 0.0; // before reordering
+    double _draw_ms = 0.0; // of the last cell draw, as read back by the renderer
+    static constexpr uint32_t cache_version = 7; // bump whenever the conversion changes
+
+private:
+    // file layout: packed header, then query points (position and signed distance), then cells of 8 query point indices
+    struct Header {
+        float voxelsize;
+        uint64_t query_points_n;
+        uint64_t cells_n;
+    };
+    static constexpr std::size_t header_size = sizeof(float) + 2 * sizeof(uint64_t);
+    static constexpr std::size_t point_size = 4 * sizeof(float);
+    static constexpr std::size_t cell_size = 8 * sizeof(Index);
+    static_assert(sizeof(QueryPoint) == point_size);
+    static_assert(sizeof(Cell) == cell_size);
+    // corner pairs of the 12 cube edges: front face, back face, then the connecting edges
+    static constexpr std::array<std::pair<uint8_t, uint8_t>, 12> cell_edges = {{
+        { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+        { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+    }};
+    // unique edges of all cells: keys are partitioned by hash into buckets, which are then sorted and deduplicated in parallel
+    static auto get_edges(std::span<const Cell> cells) -> std::vector<Edge> {
+        auto get_key = [](const Cell& cell, std::size_t e) -> uint64_t {
+            Index a = cell[cell_edges[e].first];
+            Index b = cell[cell_edges[e].second];
+            return a < b ? (uint64_t)a | (uint64_t)b << 32 : (uint64_t)b | (uint64_t)a << 32;
+        };
+        auto get_bucket = [](uint64_t key) -> std::size_t {
+            return (key * 0x9e3779b97f4a7c15ull) >> (64 - bucket_bits);
+        };
+        constexpr std::size_t bucket_n = 1 << bucket_bits;
+        std::size_t batch_size = 1 << 14;
+        std::size_t batch_n = (cells.size() + batch_size - 1) / batch_size;
+
+        // count keys per batch and bucket, then scatter them into contiguous buckets
+        std::vector<std::size_t> offsets(batch_n * bucket_n, 0);
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            std::size_t* counts_p = offsets.data() + b * bucket_n;
+            for (std::size_t i = b * batch_size; i < std::min(cells.size(), (b + 1) * batch_size); i++) {
+                for (std::size_t e = 0; e < cell_edges.size(); e++) counts_p[get_bucket(get_key(cells[i], e))]++;
+            }
+        });
+        std::vector<std::size_t> bucket_begs(bucket_n + 1, 0);
+        for (std::size_t k = 0, offset = 0; k < bucket_n; k++) {
+            bucket_begs[k] = offset;
+            for (std::size_t b = 0; b < batch_n; b++) {
+                std::size_t count = offsets[b * bucket_n + k];
+                offsets[b * bucket_n + k] = offset;
+                offset += count;
+            }
+        }
+        bucket_begs[bucket_n] = cells.size() * cell_edges.size();
+        std::vector<uint64_t> keys(cells.size() * cell_edges.size());
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            std::size_t* offsets_p = offsets.data() + b * bucket_n;
+            for (std::size_t i = b * batch_size; i < std::min(cells.size(), (b + 1) * batch_size); i++) {
+                for (std::size_t e = 0; e < cell_edges.size(); e++) {
+                    uint64_t key = get_key(cells[i], e);
+                    keys[offsets_p[get_bucket(key)]++] = key;
+                }
+            }
+        });
+
+        // equal keys always share a bucket
+        std::vector<std::size_t> unique_ns(bucket_n + 1, 0);
+        parallel::for_each(bucket_n, [&](std::size_t k) {
+            auto beg = keys.begin() + bucket_begs[k];
+            auto end = keys.begin() + bucket_begs[k + 1];
+            std::sort(beg, end);
+            unique_ns[k] = std::unique(beg, end) - beg;
+        });
+        std::vector<std::size_t> unique_begs(bucket_n + 1, 0);
+        for (std::size_t k = 0; k < bucket_n; k++) unique_begs[k + 1] = unique_begs[k] + unique_ns[k];
+        std::vector<Edge> edges(unique_begs[bucket_n]);
+        parallel::for_each(bucket_n, [&](std::size_t k) {
+            for (std::size_t i = 0; i < unique_ns[k]; i++) {
+                uint64_t key = keys[bucket_begs[k] + i];
+                edges[unique_begs[k] + i] = { (Index)key, (Index)(key >> 32) };
+            }
+        });
+        return edges;
+    }
+    static constexpr std::size_t bucket_bits = 8;
+    // interleave the lower 21 bits with two zero bits each
+    static auto spread_bits(uint64_t v) -> uint64_t {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffffull;
+        v = (v | v << 16) & 0x1f0000ff0000ffull;
+        v = (v | v << 8) & 0x100f00f00f00f00full;
+        v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+        v = (v | v << 2) & 0x1249249249249249ull;
+        return v;
+    }
+    // sort query points by the morton code of their lattice coordinates and remap the cell corners to match,
+    // cells are then sorted by their smallest corner index, which orders them by the code of their minimum corner
+    static auto reorder_z(std::vector<QueryPoint>& query_points, std::span<const Cell> cells, float voxelsize) -> std::vector<Cell> {
+        auto time_beg = std::chrono::steady_clock::now();
+        std::size_t batch_size = 1 << 16;
+        std::size_t batch_n = (query_points.size() + batch_size - 1) / batch_size;
+        std::vector<glm::vec3> batch_mins(batch_n);
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            glm::vec3 min = query_points[b * batch_size].first;
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) min = glm::min(min, query_points[i].first);
+            batch_mins[b] = min;
+        });
+        glm::vec3 origin = batch_mins.front();
+        for (glm::vec3 min: batch_mins) origin = glm::min(origin, min);
+
+        // lattice coordinates beyond 21 bits per axis wrap, which only costs locality
+        std::vector<std::pair<uint64_t, Index>> codes(query_points.size());
+        std::vector<uint32_t> batch_maxs(batch_n);
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            uint32_t max = 0;
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) {
+                glm::vec3 lattice = glm::round((query_points[i].first - origin) / voxelsize);
+                uint32_t x = (uint32_t)lattice.x, y = (uint32_t)lattice.y, z = (uint32_t)lattice.z;
+                max = std::max({ max, x, y, z });
+                codes[i] = { spread_bits(x) | spread_bits(y) << 1 | spread_bits(z) << 2, (Index)i };
+            }
+            batch_maxs[b] = max;
+        });
+        std::size_t axis_bits = std::min<std::size_t>(21, std::bit_width(*std::max_element(batch_maxs.begin(), batch_maxs.end())));
+        parallel::radix_sort(codes, [](const std::pair<uint64_t, Index>& code) { return code.first; }, 3 * axis_bits);
+
+        std::vector<QueryPoint> query_points_sorted(query_points.size());
+        std::vector<Index> remap(query_points.size());
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) {
+                query_points_sorted[i] = query_points[codes[i].second];
+                remap[codes[i].second] = (Index)i;
+            }
+        });
+        query_points.swap(query_points_sorted);
+        std::vector<Cell> cells_sorted(cells.size());
+        parallel::for_each((cells.size() + batch_size - 1) / batch_size, [&](std::size_t b) {
+            for (std::size_t i = b * batch_size; i < std::min(cells.size(), (b + 1) * batch_size); i++) {
+                for (std::size_t c = 0; c < cells[i].size(); c++) cells_sorted[i][c] = remap[cells[i][c]];
+            }
+        });
+        auto get_key = [](const Cell& cell) -> Index { return *std::min_element(cell.begin(), cell.end()); };
+        parallel::radix_sort(cells_sorted, get_key, std::bit_width(query_points.size() - 1));
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_beg).count();
+        fmt::println("reordered {} query points and {} cells along a z-order curve in {:.1f} ms", query_points.size(), cells.size(), ms);
+        return cells_sorted;
+    }
+    // single threaded pass gathering the corners of every cell in buffer order, as a proxy for neighbour queries
+    // returns cells per second and how many of them cross the zero level
+    static auto get_traversal_rate(std::span<const QueryPoint> query_points, std::span<const Cell> cells) -> std::pair<double, std::size_t> {
+        auto time_beg = std::chrono::steady_clock::now();
+        std::size_t crossing_n = 0;
+        for (const Cell& cell: cells) {
+            float min = std::numeric_limits<float>::max();
+            float max = std::numeric_limits<float>::lowest();
+            for (Index corner: cell) {
+                min = std::min(min, query_points[corner].second);
+                max = std::max(max, query_points[corner].second);
+            }
+            crossing_n += min <= 0.0f && max >= 0.0f;
+        }
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_beg).count();
+        return { (double)cells.size() / std::max(s, 1e-9), crossing_n };
+    }
+#if defined(__AVX2__)
+    static constexpr const char* simd_name = "avx2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static constexpr const char* simd_name = "neon";
+#else
+    static constexpr const char* simd_name = "scalar";
+#endif
+    // (x, y, z, d) -> (x, -z, y, d * scale), src may be unaligned
+    static void convert_points(const std::byte* src_p, float scale, float* dst_p, std::size_t n) {
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        // two points per register, swizzle within each 128 bit lane
+        __m256 factors = _mm256_setr_ps(1.0f, -1.0f, 1.0f, scale, 1.0f, -1.0f, 1.0f, scale);
+        for (; i + 2 <= n; i += 2) {
+            __m256 points = _mm256_loadu_ps(reinterpret_cast<const float*>(src_p + i * point_size));
+            points = _mm256_permute_ps(points, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm256_storeu_ps(dst_p + i * 4, _mm256_mul_ps(points, factors));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        float32x4_t factors = { 1.0f, 1.0f, -1.0f, scale };
+        for (; i < n; i++) {
+            float32x4_t point = vmulq_f32(vld1q_f32(reinterpret_cast<const float*>(src_p + i * point_size)), factors);
+            float32x4_t swizzled = vcopyq_laneq_f32(point, 1, point, 2);
+            swizzled = vcopyq_laneq_f32(swizzled, 2, point, 1);
+            vst1q_f32(dst_p + i * 4, swizzled);
+        }
+#endif
+        for (; i < n; i++) {
+            std::array<float, 4> point;
+            std::memcpy(point.data(), src_p + i * point_size, point_size);
+            dst_p[i * 4 + 0] = point[0];
+            dst_p[i * 4 + 1] = point[2] * -1.0f;
+            dst_p[i * 4 + 2] = point[1];
+            dst_p[i * 4 + 3] = point[3] * scale;
+        }
+    }
+    // device local buffers written once, mapped directly when host visible (ReBAR) and streamed through staging chunks otherwise
+    template<typename T>
+    static void upload(vma::Allocator vmalloc, Queues& queues, StagingStream& stream, DeviceBuffer<T>& buffer, std::span<const T> data) {
+        buffer.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = data.size_bytes(),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = 1,
+                .pQueueFamilyIndices = &queues._universal_i,
+            },
+            vma::AllocationCreateInfo {
+                .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite,
+                .usage = vma::MemoryUsage::eAutoPreferDevice,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                .preferredFlags = vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible,
+            });
+        void* map_p = buffer._require_staging ? nullptr : vmalloc.mapMemory(buffer._allocation);
+        stream.begin(buffer._data, buffer._allocation, map_p);
+        auto bytes = std::as_bytes(data);
+        std::size_t batch = stream.get_chunk_size();
+        for (std::size_t beg = 0; beg < bytes.size(); beg += batch) {
+            std::size_t size = std::min(bytes.size(), beg + batch) - beg;
+            std::memcpy(stream.acquire(size), bytes.data() + beg, size);
+            stream.commit(size);
+        }
+        if (map_p != nullptr) vmalloc.unmapMemory(buffer._allocation);
+    }
+    // values of the header that are not derived from the sections
+    struct CacheMeta {
+        float voxelsize;
+        uint32_t bricks; // whether the grid fits into a brick map, otherwise its sections are empty
+    };
+    // bricks and index are restored from the cache when it holds them, built from the query points otherwise
+    void upload(vk::Device device, vma::Allocator vmalloc, Queues& queues, const CacheMeta& meta, std::span<const QueryPoint> query_points, std::span<const Cell> cells, std::span<const Edge> edges, const cache::Reader* reader_p = nullptr) {
+        StagingStream stream;
+        stream.init(device, vmalloc, queues);
+        upload(vmalloc, queues, stream, _query_points, query_points);
+        upload(vmalloc, queues, stream, _cells, cells);
+        upload(vmalloc, queues, stream, _edges, edges);
+        stream.destroy();
+        _query_point_n = (uint32_t)query_points.size();
+        _cell_n = (uint32_t)cells.size();
+        _edge_n = (uint32_t)edges.size();
+
+        // bounds of each batch, then combined
+        std::size_t batch_size = 1 << 16;
+        std::size_t batch_n = (query_points.size() + batch_size - 1) / batch_size;
+        std::vector<std::pair<glm::vec3, glm::vec3>> batch_bounds(batch_n);
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            glm::vec3 min = query_points[b * batch_size].first;
+            glm::vec3 max = min;
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) {
+                min = glm::min(min, query_points[i].first);
+                max = glm::max(max, query_points[i].first);
+            }
+            batch_bounds[b] = { min, max };
+        });
+        _bounds_min = batch_bounds.front().first;
+        _bounds_max = batch_bounds.front().second;
+        for (auto& [min, max]: batch_bounds) {
+            _bounds_min = glm::min(_bounds_min, min);
+            _bounds_max = glm::max(_bounds_max, max);
+        }
+        // built from the host copy, as the device buffers may not be readable
+        _voxelsize = meta.voxelsize;
+        glm::vec3 extent = _bounds_max - _bounds_min;
+        bool bricks_cached = reader_p != nullptr && meta.bricks && _bricks.init(device, vmalloc, queues._universal_i,
+            reader_p->get<uint32_t>(eBrickIndirection), reader_p->get<uint16_t>(eBrickAtlas), _bounds_min, extent, _voxelsize);
+        if (!bricks_cached && (reader_p == nullptr || meta.bricks)) {
+            _bricks.init(device, vmalloc, queues._universal_i, query_points, _bounds_min, extent, _voxelsize);
+        }
+        bool index_cached = reader_p != nullptr && _index.init(reader_p->get(eIndexSlots), reader_p->get(eIndexBlocks), _bounds_min, _voxelsize);
+        if (!index_cached) _index.init(query_points, _bounds_min, _voxelsize);
+    }
+    // the derived bricks and index are stored too, so a cache hit only copies them
+    void write_cache(vma::Allocator vmalloc, cache::Writer& writer, const cache::Stamp& stamp, const CacheMeta& meta, std::span<const QueryPoint> query_points, std::span<const Cell> cells, std::span<const Edge> edges) {
+        writer.add(eMeta, std::span(&meta, 1));
+        writer.add(eQueryPoints, query_points);
+        writer.add(eCells, cells);
+        writer.add(eEdges, edges);
+        auto [indirection, atlas] = _bricks.map_staged(vmalloc);
+        writer.add(eBrickIndirection, indirection);
+        writer.add(eBrickAtlas, atlas);
+        _bricks.unmap_staged(vmalloc);
+        writer.add(eIndexSlots, _index.get_slots());
+        writer.add(eIndexBlocks, _index.get_blocks());
+        writer.commit(stamp);
+    }
+    enum Section: uint32_t { eQueryPoints, eCells, eEdges, eMeta, eBrickIndirection, eBrickAtlas, eIndexSlots, eIndexBlocks };
+    static constexpr std::size_t section_n = 8;
+    auto load_cache(vk::Device device, vma::Allocator vmalloc, Queues& queues, const std::string& path_cache, const cache::Stamp& stamp) -> bool {
+        cache::Reader reader;
+        if (!reader.open(path_cache, stamp)) return false;
+        auto meta = reader.get<CacheMeta>(eMeta);
+        auto query_points = reader.get<QueryPoint>(eQueryPoints);
+        auto cells = reader.get<Cell>(eCells);
+        auto edges = reader.get<Edge>(eEdges);
+        bool valid = meta.size() == 1 && query_points.size() > 0 && cells.size() > 0 && edges.size() > 0;
+        if (valid) {
+            // uploaded straight from the mapping
+            upload(device, vmalloc, queues, meta.front(), query_points, cells, edges, &reader);
+            fmt::println("loaded grid from cache: {} query points, {} cells, {} unique edges", query_points.size(), cells.size(), edges.size());
+        }
+        else fmt::println("corrupted cache: {}", path_cache);
+        reader.close();
+        return valid;
+    }
+};
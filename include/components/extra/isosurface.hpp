@@ -0,0 +1,236 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+//
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <glm/glm.hpp>
+#include "core/buffer.hpp"
+#include "components/extra/grid.hpp"
+#include "components/extra/plymesh.hpp"
+
+// marching cubes over the grid cells on the gpu, see extra/marching_cubes.glsl
+// vertices are counted per cell, scanned into offsets and then emitted along with an indirect draw
+struct Isosurface {
+    // lay out the extraction over the grid, buffers are only allocated once it is first enabled, see update()
+    auto init(const vk::ArrayProxy<uint32_t>& queues, const Grid& grid) -> bool {
+        _queues.assign(queues.begin(), queues.end());
+        _cell_n = grid._cell_n;
+        _vertex_capacity = 0;
+        _vertex_total = 0;
+        glm::vec3 extent = glm::max(grid._bounds_max - grid._bounds_min, glm::vec3(std::numeric_limits<float>::min()));
+        _bounds = { glm::vec4(grid._bounds_min, 0), glm::vec4(extent, 1) };
+
+        // scan levels: per cell counts, then the sums of each block of the previous level, down to the total
+        _scan_levels.clear();
+        _scan_levels.push_back({ 0, _cell_n });
+        do {
+            auto [beg, n] = _scan_levels.back();
+            _scan_levels.push_back({ beg + n, (n + scan_block - 1) / scan_block });
+        } while (_scan_levels.back().second > 1);
+        _iso_extracted = std::numeric_limits<float>::quiet_NaN();
+        return true;
+    }
+    // allocate on first use and grow the vertices to the uncapped total of a finished extraction, which is then repeated
+    // replaced vertices may still be drawn by frames in flight, so they are only released once those have finished
+    void update(vma::Allocator vmalloc, uint64_t finished_frame_n) {
+        if (_vertices_retired.has_value() && _retired_frame_n <= finished_frame_n) {
+            _vertices_retired->destroy(vmalloc);
+            _vertices_retired.reset();
+        }
+        if (_draw_mapped_p == nullptr) {
+            allocate(vmalloc);
+            return;
+        }
+        if (!_extract_pending || _extract_frame >= finished_frame_n) return;
+        _extract_pending = false;
+        _vertex_total = get_vertex_total();
+        if (_vertex_total <= _vertex_capacity || _vertices_retired.has_value()) return;
+        _vertices_retired = _vertices;
+        _retired_frame_n = finished_frame_n + frames_max;
+        init_vertices(vmalloc, _vertex_total + _vertex_total / 4);
+        _iso_extracted = std::numeric_limits<float>::quiet_NaN();
+    }
+    void destroy(vma::Allocator vmalloc) {
+        if (_vertices_retired.has_value()) _vertices_retired->destroy(vmalloc);
+        _vertices_retired.reset();
+        if (_draw_mapped_p == nullptr) return;
+        vmalloc.unmapMemory(_draw._allocation);
+        _draw_mapped_p = nullptr;
+        _cases.destroy(vmalloc);
+        _scan.destroy(vmalloc);
+        _vertices.destroy(vmalloc);
+        _draw.destroy(vmalloc);
+        _vertex_capacity = 0;
+        _vertex_total = 0;
+        _extract_pending = false;
+    }
+    void draw(vk::CommandBuffer cmd) {
+        cmd.bindVertexBuffers(0, _vertices._data, { 0 });
+        cmd.drawIndirect(_draw._data, 0, 1, sizeof(vk::DrawIndirectCommand));
+    }
+    // read back the vertex count of the last extraction, its submission has to be finished
+    auto get_vertex_total() const -> uint32_t {
+        Draw draw;
+        std::memcpy(&draw, _draw_mapped_p, sizeof(Draw));
+        return draw.vertex_total;
+    }
+
+    // 15 edge indices of up to 5 triangles, packed into 4 bits each (std430 uvec4)
+    struct Case {
+        uint32_t vertex_n;
+        std::array<uint32_t, 2> edges;
+        uint32_t _pad;
+    };
+    // indirect draw followed by the vertex count before capping it to the capacity
+    struct Draw {
+        vk::DrawIndirectCommand command;
+        uint32_t vertex_total;
+    };
+    static constexpr uint32_t scan_block = 1024; // elements per workgroup of defaults/scan.comp
+    static constexpr uint32_t vertices_min = 3 << 16; // initial capacity, grown to fit the first extraction
+    static constexpr uint64_t frames_max = 3; // frames in flight that may still draw replaced vertices
+    DeviceBuffer<Case> _cases;
+    DeviceBuffer<uint32_t> _scan; // vertex counts per cell, scanned in place into vertex offsets
+    DeviceBuffer<Plymesh::VertexPacked> _vertices;
+    DeviceBuffer<Draw> _draw;
+    void* _draw_mapped_p = nullptr;
+    std::vector<std::pair<uint32_t, uint32_t>> _scan_levels; // beginning and length within the scan buffer
+    Plymesh::Bounds _bounds; // of the grid, to quantize positions
+    uint32_t _cell_n = 0;
+    uint32_t _vertex_capacity = 0; // zero until allocated
+    float _iso_extracted = std::numeric_limits<float>::quiet_NaN(); // iso value of the current vertices
+    uint64_t _extract_frame = 0; // frame that recorded the last extraction, set by the renderer
+    bool _extract_pending = false; // its vertex total has not been read back yet
+    // of the last extraction, as read back once its frame has finished
+    uint32_t _vertex_total = 0;
+    double _extract_ms = 0.0;
+
+private:
+    void allocate(vma::Allocator vmalloc) {
+        uint32_t scan_n = _scan_levels.back().first + 1;
+        _scan.init(vmalloc, get_info(_queues, scan_n * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer), get_info_device());
+        init_vertices(vmalloc, vertices_min);
+        // case table written once, the draw is read back for its uncapped vertex count
+        _cases.init(vmalloc, get_info(_queues, sizeof(Case) * 256, vk::BufferUsageFlagBits::eStorageBuffer),
+            vma::AllocationCreateInfo {
+                .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite,
+                .usage = vma::MemoryUsage::eAutoPreferDevice,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                .preferredFlags = vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible,
+            });
+        std::array<Case, 256> cases = get_cases();
+        _cases.write(vmalloc, 0, sizeof(cases), cases.data());
+        _draw.init(vmalloc, get_info(_queues, sizeof(Draw), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer),
+            vma::AllocationCreateInfo {
+                .flags = vma::AllocationCreateFlagBits::eHostAccessRandom,
+                .usage = vma::MemoryUsage::eAuto,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            });
+        _draw_mapped_p = _draw.map(vmalloc);
+        std::memset(_draw_mapped_p, 0, sizeof(Draw));
+        _iso_extracted = std::numeric_limits<float>::quiet_NaN();
+    }
+    void init_vertices(vma::Allocator vmalloc, uint32_t capacity) {
+        _vertex_capacity = capacity;
+        _vertices.init(vmalloc,
+            get_info(_queues, (vk::DeviceSize)_vertex_capacity * sizeof(Plymesh::VertexPacked), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer),
+            get_info_device());
+    }
+    static auto get_info_device() -> vma::AllocationCreateInfo {
+        return vma::AllocationCreateInfo {
+            .usage = vma::MemoryUsage::eAutoPreferDevice,
+            .requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal,
+        };
+    }
+    static auto get_info(const vk::ArrayProxy<uint32_t>& queues, vk::DeviceSize size, vk::BufferUsageFlags usage) -> vk::BufferCreateInfo {
+        return vk::BufferCreateInfo {
+            .size = size,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = queues.size(),
+            .pQueueFamilyIndices = queues.data(),
+        };
+    }
+    // triangulate the surface of every corner configuration (bit i set when corner i is below the iso value)
+    // crossed edges of each face are linked into segments, ambiguous faces keep the corners below apart,
+    // so neighbouring cells always agree on their shared face. the segments form closed loops, which are fanned
+    static auto get_cases() -> std::array<Case, 256> {
+        // corner order of the grid cells, as drawn by extra/cells.vert
+        constexpr std::array<std::pair<uint8_t, uint8_t>, 12> edges = {{
+            { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 },
+            { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+            { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 },
+        }};
+        constexpr std::array<std::array<uint8_t, 4>, 6> faces = {{
+            { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 0, 1, 5, 4 },
+            { 1, 2, 6, 5 }, { 2, 3, 7, 6 }, { 3, 0, 4, 7 },
+        }};
+        auto get_edge = [&](uint8_t a, uint8_t b) -> uint8_t {
+            for (uint8_t e = 0; e < edges.size(); e++) {
+                if ((edges[e].first == a && edges[e].second == b) || (edges[e].first == b && edges[e].second == a)) return e;
+            }
+            return 0xff;
+        };
+
+        std::array<Case, 256> cases = {};
+        for (uint32_t c = 0; c < cases.size(); c++) {
+            // each crossed edge lies on two faces, so it is linked to exactly two others
+            std::array<std::array<uint8_t, 2>, 12> links;
+            for (auto& link: links) link = { 0xff, 0xff };
+            auto add_link = [&](uint8_t a, uint8_t b) {
+                links[a][links[a][0] == 0xff ? 0 : 1] = b;
+                links[b][links[b][0] == 0xff ? 0 : 1] = a;
+            };
+            for (const auto& face: faces) {
+                std::array<bool, 4> below;
+                for (std::size_t i = 0; i < 4; i++) below[i] = c >> face[i] & 1;
+                std::array<uint8_t, 4> crossed;
+                std::size_t crossed_n = 0;
+                for (uint8_t i = 0; i < 4; i++) {
+                    if (below[i] != below[(i + 1) % 4]) crossed[crossed_n++] = i;
+                }
+                if (crossed_n == 2) {
+                    add_link(get_edge(face[crossed[0]], face[(crossed[0] + 1) % 4]), get_edge(face[crossed[1]], face[(crossed[1] + 1) % 4]));
+                }
+                else if (crossed_n == 4) {
+                    // cut off both corners below, each by the segment between its two face edges
+                    for (std::size_t i = 0; i < 4; i++) {
+                        if (below[i]) add_link(get_edge(face[(i + 3) % 4], face[i]), get_edge(face[i], face[(i + 1) % 4]));
+                    }
+                }
+            }
+            // walk each loop and fan it from its first edge
+            std::array<bool, 12> visited = {};
+            std::vector<uint8_t> triangles;
+            for (uint8_t e = 0; e < edges.size(); e++) {
+                if (links[e][0] == 0xff || visited[e]) continue;
+                std::vector<uint8_t> loop;
+                for (uint8_t prev = 0xff, cur = e; !visited[cur];) {
+                    visited[cur] = true;
+                    loop.push_back(cur);
+                    uint8_t next = links[cur][0] != prev ? links[cur][0] : links[cur][1];
+                    prev = cur;
+                    cur = next;
+                }
+                for (std::size_t i = 1; i + 1 < loop.size(); i++) {
+                    triangles.insert(triangles.end(), { loop[0], loop[i], loop[i + 1] });
+                }
+            }
+            cases[c].vertex_n = (uint32_t)triangles.size();
+            for (std::size_t i = 0; i < triangles.size(); i++) {
+                cases[c].edges[i / 8] |= (uint32_t)triangles[i] << (i % 8 * 4);
+            }
+        }
+        return cases;
+    }
+
+    std::vector<uint32_t> _queues; // families sharing the buffers
+    std::optional<DeviceBuffer<Plymesh::VertexPacked>> _vertices_retired; // replaced by a larger buffer
+    uint64_t _retired_frame_n = 0; // finished frames after which it is no longer drawn
+};
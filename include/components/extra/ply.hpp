@@ -0,0 +1,669 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <bit>
+#include <fmt/base.h>
+#include "core/parallel.hpp"
+
+namespace ply {
+    enum class Format { eAscii, eBinaryLittleEndian, eBinaryBigEndian };
+    enum class Type: uint8_t { eInvalid, eInt8, eUint8, eInt16, eUint16, eInt32, eUint32, eFloat32, eFloat64 };
+
+    inline auto parse_type(std::string_view str) -> Type {
+        if (str == "char"   || str == "int8")    return Type::eInt8;
+        if (str == "uchar"  || str == "uint8")   return Type::eUint8;
+        if (str == "short"  || str == "int16")   return Type::eInt16;
+        if (str == "ushort" || str == "uint16")  return Type::eUint16;
+        if (str == "int"    || str == "int32")   return Type::eInt32;
+        if (str == "uint"   || str == "uint32")  return Type::eUint32;
+        if (str == "float"  || str == "float32") return Type::eFloat32;
+        if (str == "double" || str == "float64") return Type::eFloat64;
+        return Type::eInvalid;
+    }
+    inline auto size_of(Type type) -> std::size_t {
+        switch (type) {
+            case Type::eInt8: case Type::eUint8: return 1;
+            case Type::eInt16: case Type::eUint16: return 2;
+            case Type::eInt32: case Type::eUint32: case Type::eFloat32: return 4;
+            case Type::eFloat64: return 8;
+            default: return 0;
+        }
+    }
+
+    // load a single binary value, optionally swapping its byte order
+    template<typename T>
+    inline auto load(const std::byte* src_p, bool swap) -> T {
+        std::array<std::byte, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), src_p, sizeof(T));
+        if (swap) std::reverse(bytes.begin(), bytes.end());
+        return std::bit_cast<T>(bytes);
+    }
+    // load a single binary value of the given type and convert it to T
+    template<typename T>
+    inline auto read(const std::byte* src_p, Type type, bool swap) -> T {
+        switch (type) {
+            case Type::eInt8:    return (T)load<int8_t>(src_p, swap);
+            case Type::eUint8:   return (T)load<uint8_t>(src_p, swap);
+            case Type::eInt16:   return (T)load<int16_t>(src_p, swap);
+            case Type::eUint16:  return (T)load<uint16_t>(src_p, swap);
+            case Type::eInt32:   return (T)load<int32_t>(src_p, swap);
+            case Type::eUint32:  return (T)load<uint32_t>(src_p, swap);
+            case Type::eFloat32: return (T)load<float>(src_p, swap);
+            case Type::eFloat64: return (T)load<double>(src_p, swap);
+            default: return T(0);
+        }
+    }
+
+    // whitespace separated number tokens of ascii element data
+    struct AsciiCursor {
+        template<typename T>
+        auto next(T& value) -> bool {
+            while (_p < _end && is_space(*_p)) _p++;
+            auto [ptr, ec] = std::from_chars(_p, _end, value);
+            if (ec != std::errc()) return false;
+            _p = ptr;
+            return true;
+        }
+        // step over the next token without converting it
+        auto skip() -> bool {
+            while (_p < _end && is_space(*_p)) _p++;
+            if (_p >= _end) return false;
+            while (_p < _end && !is_space(*_p)) _p++;
+            return true;
+        }
+        static auto is_space(char c) -> bool {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
+        const char* _p;
+        const char* _end;
+    };
+
+    struct Property {
+        auto is_list() const -> bool {
+            return count_type != Type::eInvalid;
+        }
+        std::string name;
+        Type type = Type::eInvalid; // value type or list item type
+        Type count_type = Type::eInvalid; // list count type, invalid for scalars
+        std::size_t offset = 0; // byte offset within a fixed size binary element
+    };
+    struct Element {
+        auto find(std::string_view property_name) const -> const Property* {
+            for (auto& property: properties) {
+                if (property.name == property_name) return &property;
+            }
+            return nullptr;
+        }
+        auto is_fixed() const -> bool {
+            return stride > 0;
+        }
+        std::string name;
+        std::size_t count = 0;
+        std::size_t stride = 0; // byte size per binary instance, 0 when lists are present
+        std::vector<Property> properties;
+        std::span<const std::byte> data; // element data within the file
+    };
+
+    struct Header {
+        auto parse(std::span<const std::byte> file) -> bool {
+            const char* beg_p = reinterpret_cast<const char*>(file.data());
+            const char* end_p = beg_p + file.size();
+            const char* cur_p = beg_p;
+            auto next_line = [&]() -> std::string_view {
+                const char* line_p = cur_p;
+                while (cur_p < end_p && *cur_p != '\n') cur_p++;
+                std::string_view line { line_p, (std::size_t)(cur_p - line_p) };
+                if (cur_p < end_p) cur_p++; // skip newline
+                if (line.size() > 0 && line.back() == '\r') line.remove_suffix(1);
+                return line;
+            };
+            auto split = [](std::string_view line) {
+                std::vector<std::string_view> tokens;
+                while (line.size() > 0) {
+                    std::size_t beg = line.find_first_not_of(" \t");
+                    if (beg == std::string_view::npos) break;
+                    line.remove_prefix(beg);
+                    std::size_t end = std::min(line.find_first_of(" \t"), line.size());
+                    tokens.push_back(line.substr(0, end));
+                    line.remove_prefix(end);
+                }
+                return tokens;
+            };
+
+            // validate header start
+            if (next_line() != "ply") {
+                fmt::println("missing ply magic");
+                return false;
+            }
+            bool has_format = false;
+            bool has_end = false;
+            while (cur_p < end_p && !has_end) {
+                auto tokens = split(next_line());
+                if (tokens.size() == 0) continue;
+                std::string_view keyword = tokens[0];
+                if (keyword == "comment" || keyword == "obj_info") continue;
+                else if (keyword == "end_header") has_end = true;
+                else if (keyword == "format" && tokens.size() >= 2) {
+                    if      (tokens[1] == "ascii") _format = Format::eAscii;
+                    else if (tokens[1] == "binary_little_endian") _format = Format::eBinaryLittleEndian;
+                    else if (tokens[1] == "binary_big_endian") _format = Format::eBinaryBigEndian;
+                    else {
+                        fmt::println("unknown ply format: {}", tokens[1]);
+                        return false;
+                    }
+                    has_format = true;
+                }
+                else if (keyword == "element" && tokens.size() >= 3) {
+                    Element& element = _elements.emplace_back();
+                    element.name = tokens[1];
+                    auto [_, ec] = std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), element.count);
+                    if (ec != std::errc()) {
+                        fmt::println("invalid element count: {}", tokens[2]);
+                        return false;
+                    }
+                }
+                else if (keyword == "property" && tokens.size() >= 3 && _elements.size() > 0) {
+                    Property property;
+                    if (tokens[1] == "list" && tokens.size() >= 5) {
+                        property.count_type = parse_type(tokens[2]);
+                        property.type = parse_type(tokens[3]);
+                        property.name = tokens[4];
+                        if (property.count_type == Type::eInvalid || property.count_type == Type::eFloat32 || property.count_type == Type::eFloat64) {
+                            fmt::println("invalid list count type: {}", tokens[2]);
+                            return false;
+                        }
+                    }
+                    else {
+                        property.type = parse_type(tokens[1]);
+                        property.name = tokens[2];
+                    }
+                    if (property.type == Type::eInvalid) {
+                        fmt::println("unknown property type for: {}", property.name);
+                        return false;
+                    }
+                    _elements.back().properties.push_back(property);
+                }
+                else {
+                    fmt::println("unexpected header line: {}", keyword);
+                    return false;
+                }
+            }
+            if (!has_format || !has_end) {
+                fmt::println("missing/unexpected header end");
+                return false;
+            }
+            _size = (std::size_t)(cur_p - beg_p);
+
+            // compute binary layouts of elements
+            for (auto& element: _elements) {
+                element.stride = 0;
+                for (auto& property: element.properties) {
+                    if (property.is_list()) {
+                        element.stride = 0;
+                        break;
+                    }
+                    property.offset = element.stride;
+                    element.stride += size_of(property.type);
+                }
+            }
+            // locate element data within file
+            for (auto& element: _elements) {
+                std::size_t size = 0;
+                if (_format == Format::eAscii) {
+                    // one line per element instance
+                    const char* line_p = cur_p;
+                    for (std::size_t i = 0; i < element.count && line_p < end_p; i++) {
+                        while (line_p < end_p && *line_p != '\n') line_p++;
+                        if (line_p < end_p) line_p++;
+                    }
+                    size = (std::size_t)(line_p - cur_p);
+                }
+                else if (element.is_fixed()) {
+                    size = element.count * element.stride;
+                }
+                else if (&element == &_elements.back()) {
+                    // the last one takes the rest of the file, its reader stops after count instances and scans them in parallel
+                    size = (std::size_t)(end_p - cur_p);
+                }
+                else {
+                    // walk variable length instances
+                    bool swap = is_swapped();
+                    const std::byte* src_p = reinterpret_cast<const std::byte*>(cur_p);
+                    const std::byte* src_end_p = reinterpret_cast<const std::byte*>(end_p);
+                    for (std::size_t i = 0; i < element.count; i++) {
+                        for (auto& property: element.properties) {
+                            if (property.is_list()) {
+                                if (src_p + size_of(property.count_type) > src_end_p) break;
+                                std::size_t count = read<std::size_t>(src_p, property.count_type, swap);
+                                src_p += size_of(property.count_type) + count * size_of(property.type);
+                            }
+                            else src_p += size_of(property.type);
+                        }
+                    }
+                    size = (std::size_t)(reinterpret_cast<const char*>(src_p) - cur_p);
+                }
+                if (cur_p + size > end_p) {
+                    fmt::println("element {} exceeds file size", element.name);
+                    return false;
+                }
+                element.data = std::span(reinterpret_cast<const std::byte*>(cur_p), size);
+                cur_p += size;
+            }
+            return true;
+        }
+        auto find(std::string_view element_name) const -> const Element* {
+            for (auto& element: _elements) {
+                if (element.name == element_name) return &element;
+            }
+            return nullptr;
+        }
+        auto is_swapped() const -> bool {
+            if (_format == Format::eBinaryLittleEndian) return std::endian::native != std::endian::little;
+            if (_format == Format::eBinaryBigEndian) return std::endian::native != std::endian::big;
+            return false;
+        }
+
+        Format _format = Format::eAscii;
+        std::vector<Element> _elements;
+        std::size_t _size = 0; // header size in bytes, including end_header line
+    };
+
+    // convert selected scalar properties of element instances to floats, missing properties (nullptr) read as 0
+    template<std::size_t N>
+    struct ScalarReader {
+        // binary reads hand out [beg + b * batch_size, beg + (b + 1) * batch_size) to a single thread
+        static constexpr std::size_t batch_size = 1 << 14;
+
+        auto init(const Header& header, const Element& element, const std::array<const Property*, N>& properties) -> bool {
+            _element_p = &element;
+            _properties = properties;
+            _format = header._format;
+            _swap = header.is_swapped();
+            if (_format == Format::eAscii) {
+                // map each property index to its output slot
+                _slots.assign(element.properties.size(), -1);
+                for (std::size_t k = 0; k < N; k++) {
+                    if (properties[k] != nullptr) _slots[properties[k] - element.properties.data()] = (int)k;
+                }
+                _cursor = {
+                    reinterpret_cast<const char*>(element.data.data()),
+                    reinterpret_cast<const char*>(element.data.data() + element.data.size())
+                };
+                _next = 0;
+            }
+            else if (!element.is_fixed()) {
+                fmt::println("list properties are not supported for element: {}", element.name);
+                return false;
+            }
+            return true;
+        }
+        // invoke fnc(i, values) for instances in [beg, end), ascii ranges have to be read in order
+        template<typename Fnc>
+        auto read(std::size_t beg, std::size_t end, Fnc&& fnc) -> bool {
+            const Element& element = *_element_p;
+            if (_format == Format::eAscii) {
+                if (beg != _next) return false;
+                std::array<float, N> values;
+                for (std::size_t i = beg; i < end; i++) {
+                    values.fill(0.0f);
+                    for (std::size_t p = 0; p < element.properties.size(); p++) {
+                        std::size_t count = 1;
+                        if (element.properties[p].is_list() && !_cursor.next(count)) return false;
+                        for (std::size_t c = 0; c < count; c++) {
+                            float value;
+                            if (!_cursor.next(value)) return false;
+                            if (_slots[p] >= 0) values[_slots[p]] = value;
+                        }
+                    }
+                    fnc(i, values);
+                }
+                _next = end;
+                return true;
+            }
+            // binary instances are independent, split range across threads
+            std::size_t batches_n = (end - beg + batch_size - 1) / batch_size;
+            parallel::for_each(batches_n, [&](std::size_t b) {
+                std::array<float, N> values;
+                std::size_t batch_end = std::min(end, beg + (b + 1) * batch_size);
+                for (std::size_t i = beg + b * batch_size; i < batch_end; i++) {
+                    const std::byte* src_p = element.data.data() + i * element.stride;
+                    for (std::size_t k = 0; k < N; k++) {
+                        if (_properties[k] == nullptr) values[k] = 0.0f;
+                        else values[k] = ply::read<float>(src_p + _properties[k]->offset, _properties[k]->type, _swap);
+                    }
+                    fnc(i, values);
+                }
+            });
+            return true;
+        }
+
+        const Element* _element_p = nullptr;
+        std::array<const Property*, N> _properties;
+        std::vector<int> _slots;
+        AsciiCursor _cursor;
+        std::size_t _next = 0;
+        Format _format = Format::eAscii;
+        bool _swap = false;
+    };
+
+    // decode a face index list into fan triangulated indices
+    // faces are grouped into chunks with known output offsets, so that any chunk range decodes in parallel
+    template<typename Index>
+    struct TriangleReader {
+        auto init(const Header& header, const Element& element, const Property& list, std::size_t vertex_n) -> bool {
+            _element_p = &element;
+            _list_p = &list;
+            _vertex_n = vertex_n;
+            _swap = header.is_swapped();
+            _ascii = header._format == Format::eAscii;
+            if (_ascii) return init_ascii();
+            else return init_binary();
+        }
+        auto get_chunk_count() const -> std::size_t {
+            return _chunk_offsets.size() - 1;
+        }
+        // number of indices produced by chunks [beg, end)
+        auto get_index_count(std::size_t chunk_beg, std::size_t chunk_end) const -> std::size_t {
+            return (_chunk_offsets[chunk_end] - _chunk_offsets[chunk_beg]) * 3;
+        }
+        // decode chunks [beg, end) in parallel into dst_p
+        auto read(std::size_t chunk_beg, std::size_t chunk_end, Index* dst_p) -> bool {
+            std::size_t base = _chunk_offsets[chunk_beg] * 3;
+            const Element& element = *_element_p;
+            const std::byte* data_p = element.data.data();
+            std::vector<std::size_t> chunk_errors(chunk_end - chunk_beg, 0);
+            if (_ascii) {
+                // each line range is one chunk, decoded straight into its place
+                parallel::for_each(chunk_end - chunk_beg, [&](std::size_t i) {
+                    std::size_t c = chunk_beg + i;
+                    AsciiCursor cursor { reinterpret_cast<const char*>(data_p + _chunk_starts[c]), reinterpret_cast<const char*>(data_p + _chunk_starts[c + 1]) };
+                    Index* chunk_dst_p = dst_p + _chunk_offsets[c] * 3 - base;
+                    std::vector<Index> face(256); // grows for larger faces, as in the binary path
+                    for (std::size_t f = 0; f < _range_faces[c]; f++) {
+                        for (auto& property: element.properties) {
+                            std::size_t count = 1;
+                            if (property.is_list() && !cursor.next(count)) { chunk_errors[i]++; return; }
+                            if (&property != _list_p) {
+                                for (std::size_t k = 0; k < count; k++) cursor.skip();
+                                continue;
+                            }
+                            if (count > face.size()) face.resize(count);
+                            for (std::size_t k = 0; k < count; k++) {
+                                if (!cursor.next(face[k])) { chunk_errors[i]++; return; }
+                            }
+                            chunk_dst_p = emit_fan(chunk_dst_p, [&](std::size_t k) { return face[k]; }, count, chunk_errors[i]);
+                        }
+                    }
+                });
+                std::size_t errors_n = 0;
+                for (auto errors: chunk_errors) errors_n += errors;
+                if (errors_n > 0) {
+                    fmt::println("{} invalid faces or indices", errors_n);
+                    return false;
+                }
+                return true;
+            }
+            parallel::for_each(chunk_end - chunk_beg, [&](std::size_t i) {
+                std::size_t c = chunk_beg + i;
+                const std::byte* src_p = data_p + _chunk_starts[c];
+                Index* chunk_dst_p = dst_p + _chunk_offsets[c] * 3 - base;
+                std::size_t end = std::min(element.count, (c + 1) * chunk_faces);
+                for (std::size_t f = c * chunk_faces; f < end; f++) {
+                    for (auto& property: element.properties) {
+                        if (!property.is_list()) {
+                            src_p += size_of(property.type);
+                            continue;
+                        }
+                        std::size_t count = ply::read<std::size_t>(src_p, property.count_type, _swap);
+                        src_p += size_of(property.count_type);
+                        if (&property == _list_p) {
+                            std::size_t item_size = size_of(property.type);
+                            auto get = [&](std::size_t k) { return ply::read<Index>(src_p + k * item_size, property.type, _swap); };
+                            chunk_dst_p = emit_fan(chunk_dst_p, get, count, chunk_errors[i]);
+                        }
+                        src_p += count * size_of(property.type);
+                    }
+                }
+            });
+            std::size_t errors_n = 0;
+            for (auto errors: chunk_errors) errors_n += errors;
+            if (errors_n > 0) {
+                fmt::println("{} face indices out of range", errors_n);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        // fan triangulation of a single face
+        template<typename Fnc>
+        auto emit_fan(Index* dst_p, Fnc&& get, std::size_t count, std::size_t& errors) const -> Index* {
+            if (count < 3) return dst_p;
+            Index first = get(0);
+            Index prev = get(1);
+            errors += (first >= _vertex_n) + (prev >= _vertex_n);
+            for (std::size_t k = 2; k < count; k++) {
+                Index cur = get(k);
+                errors += cur >= _vertex_n;
+                *dst_p++ = first;
+                *dst_p++ = prev;
+                *dst_p++ = cur;
+                prev = cur;
+            }
+            return dst_p;
+        }
+        auto init_binary() -> bool {
+            // find chunk boundaries and their triangle counts
+            const Element& element = *_element_p;
+            const Property& list = *_list_p;
+            std::size_t chunks_n = (element.count + chunk_faces - 1) / chunk_faces;
+            std::vector<std::size_t> chunk_triangles(chunks_n, 0);
+            _chunk_starts.assign(chunks_n, 0);
+            const std::byte* data_p = element.data.data();
+            const std::byte* end_p = data_p + element.data.size();
+
+            // fast path: constant sized triangle faces, validated in parallel
+            bool uniform = true;
+            std::size_t face_size = 0;
+            std::size_t count_offset = 0;
+            for (auto& property: element.properties) {
+                if (&property == &list) {
+                    count_offset = face_size;
+                    face_size += size_of(list.count_type) + 3 * size_of(list.type);
+                }
+                else if (property.is_list()) uniform = false;
+                else face_size += size_of(property.type);
+            }
+            uniform &= element.data.size() >= element.count * face_size;
+            if (uniform) {
+                std::vector<uint8_t> chunk_uniform(chunks_n, 1);
+                parallel::for_each(chunks_n, [&](std::size_t c) {
+                    std::size_t end = std::min(element.count, (c + 1) * chunk_faces);
+                    for (std::size_t i = c * chunk_faces; i < end; i++) {
+                        if (ply::read<std::size_t>(data_p + i * face_size + count_offset, list.count_type, _swap) != 3) {
+                            chunk_uniform[c] = 0;
+                            break;
+                        }
+                    }
+                    _chunk_starts[c] = c * chunk_faces * face_size;
+                    chunk_triangles[c] = end - c * chunk_faces;
+                });
+                uniform = std::all_of(chunk_uniform.cbegin(), chunk_uniform.cend(), [](uint8_t b) { return b != 0; });
+            }
+            if (!uniform && !scan_binary(chunk_triangles)) return false;
+            // prefix sum of triangles gives the output offset of each chunk
+            _chunk_offsets.assign(chunks_n + 1, 0);
+            for (std::size_t c = 0; c < chunks_n; c++) _chunk_offsets[c + 1] = _chunk_offsets[c] + chunk_triangles[c];
+            return true;
+        }
+        // one face at offset, advancing it and counting triangles, false when it runs past the element data
+        auto skip_face(std::size_t& offset, std::size_t& triangle_n) const -> bool {
+            std::span<const std::byte> data = _element_p->data;
+            for (auto& property: _element_p->properties) {
+                if (!property.is_list()) {
+                    offset += size_of(property.type);
+                    continue;
+                }
+                if (offset + size_of(property.count_type) > data.size()) return false;
+                std::size_t count = ply::read<std::size_t>(data.data() + offset, property.count_type, _swap);
+                if (count > data.size()) return false; // negative or garbage
+                if (&property == _list_p && count >= 3) triangle_n += count - 2;
+                offset += size_of(property.count_type) + count * size_of(property.type);
+            }
+            return offset <= data.size();
+        }
+        // variable sized faces have to be walked to find chunk starts, so the data is split into pieces walked in parallel
+        // from a guessed face start each. once the exact walk lands on one of the first boundaries of a guessed walk,
+        // both coincide from there on and its counts hold. pieces that do not synchronize are walked again
+        auto scan_binary(std::vector<std::size_t>& chunk_triangles) -> bool {
+            const Element& element = *_element_p;
+            std::size_t size = element.data.size();
+            std::size_t pieces_n = std::max<std::size_t>(1, std::min(size / (1 << 20), parallel::get_thread_count() * 4));
+            auto get_guess = [&](std::size_t p) { return size * p / pieces_n; };
+            struct Boundary {
+                std::size_t offset;
+                std::size_t face_n; // faces walked before it
+            };
+            struct Walk {
+                std::vector<Boundary> boundaries; // first ones
+                Boundary exit; // first boundary at or past the next piece
+                bool valid;
+            };
+            static constexpr std::size_t probe_n = 64;
+            std::vector<Walk> walks(pieces_n);
+            parallel::for_each(pieces_n, [&](std::size_t p) {
+                Walk& walk = walks[p];
+                Boundary cur { get_guess(p), 0 };
+                std::size_t triangle_n = 0;
+                walk.valid = true;
+                while (cur.offset < get_guess(p + 1) && walk.valid) {
+                    if (walk.boundaries.size() < probe_n) walk.boundaries.push_back(cur);
+                    walk.valid = skip_face(cur.offset, triangle_n);
+                    cur.face_n++;
+                }
+                walk.exit = cur;
+            });
+
+            // exact start of every piece, in order
+            std::vector<Boundary> starts(pieces_n + 1);
+            Boundary exact { 0, 0 };
+            for (std::size_t p = 0; p < pieces_n; p++) {
+                starts[p] = exact;
+                if (exact.face_n == element.count || exact.offset >= get_guess(p + 1)) continue;
+                // step the exact walk until it lands on one of the first boundaries of the guessed one
+                const Walk& walk = walks[p];
+                std::size_t triangle_n = 0;
+                bool synced = false;
+                for (std::size_t k = 0; walk.valid && exact.face_n < element.count;) {
+                    while (k < walk.boundaries.size() && walk.boundaries[k].offset < exact.offset) k++;
+                    if (k == walk.boundaries.size()) break;
+                    const Boundary& sync = walk.boundaries[k];
+                    if (sync.offset == exact.offset) {
+                        synced = exact.face_n + walk.exit.face_n - sync.face_n <= element.count;
+                        if (synced) exact = { walk.exit.offset, exact.face_n + walk.exit.face_n - sync.face_n };
+                        break;
+                    }
+                    if (!skip_face(exact.offset, triangle_n)) return false;
+                    exact.face_n++;
+                }
+                if (synced) continue;
+                while (exact.offset < get_guess(p + 1) && exact.face_n < element.count) {
+                    if (!skip_face(exact.offset, triangle_n)) return false;
+                    exact.face_n++;
+                }
+            }
+            starts[pieces_n] = exact;
+            if (exact.face_n != element.count) return false;
+
+            // chunk starts and triangle counts, chunks spanning pieces are summed up by both
+            parallel::for_each(pieces_n, [&](std::size_t p) {
+                std::size_t offset = starts[p].offset;
+                std::size_t triangle_n = 0;
+                for (std::size_t f = starts[p].face_n; f < starts[p + 1].face_n; f++) {
+                    if (f % chunk_faces == 0) {
+                        if (f > starts[p].face_n) std::atomic_ref(chunk_triangles[f / chunk_faces - 1]).fetch_add(triangle_n, std::memory_order_relaxed);
+                        triangle_n = 0;
+                        _chunk_starts[f / chunk_faces] = offset;
+                    }
+                    skip_face(offset, triangle_n);
+                }
+                if (starts[p + 1].face_n > starts[p].face_n) {
+                    std::atomic_ref(chunk_triangles[(starts[p + 1].face_n - 1) / chunk_faces]).fetch_add(triangle_n, std::memory_order_relaxed);
+                }
+            });
+            return true;
+        }
+        auto init_ascii() -> bool {
+            // split element data at line starts, count the faces and triangles of each line range
+            const Element& element = *_element_p;
+            const char* beg_p = reinterpret_cast<const char*>(element.data.data());
+            const char* end_p = beg_p + element.data.size();
+            std::size_t ranges_n = std::max<std::size_t>(1, std::min(element.data.size() / (1 << 16), parallel::get_thread_count() * 4));
+            std::vector<const char*> range_starts(ranges_n + 1, end_p);
+            for (std::size_t r = 1; r < ranges_n; r++) {
+                const char* start_p = beg_p + element.data.size() * r / ranges_n;
+                while (start_p < end_p && *(start_p - 1) != '\n') start_p++;
+                range_starts[r] = start_p;
+            }
+            range_starts[0] = beg_p;
+            _range_faces.assign(ranges_n, 0);
+            std::vector<std::size_t> range_triangles(ranges_n, 0);
+            std::vector<std::size_t> range_errors(ranges_n, 0);
+            parallel::for_each(ranges_n, [&](std::size_t r) {
+                if (range_starts[r] >= range_starts[r + 1]) return;
+                AsciiCursor cursor { range_starts[r], range_starts[r + 1] };
+                while (true) {
+                    // stop at trailing whitespace
+                    while (cursor._p < cursor._end && AsciiCursor::is_space(*cursor._p)) cursor._p++;
+                    if (cursor._p >= cursor._end) break;
+                    for (auto& property: element.properties) {
+                        std::size_t count = 1;
+                        if (property.is_list() && !cursor.next(count)) { range_errors[r]++; return; }
+                        if (&property == _list_p && count >= 3) range_triangles[r] += count - 2;
+                        for (std::size_t k = 0; k < count; k++) {
+                            if (!cursor.skip()) { range_errors[r]++; return; }
+                        }
+                    }
+                    _range_faces[r]++;
+                }
+            });
+            // each range becomes one chunk
+            std::size_t faces_n = 0;
+            _chunk_starts.assign(ranges_n + 1, 0);
+            _chunk_offsets.assign(ranges_n + 1, 0);
+            for (std::size_t r = 0; r < ranges_n; r++) {
+                faces_n += _range_faces[r];
+                if (range_errors[r] > 0) {
+                    fmt::println("{} invalid faces", range_errors[r]);
+                    return false;
+                }
+                _chunk_starts[r + 1] = (std::size_t)(range_starts[r + 1] - beg_p);
+                _chunk_offsets[r + 1] = _chunk_offsets[r] + range_triangles[r];
+            }
+            if (faces_n != element.count) {
+                fmt::println("expected {} faces, found {}", element.count, faces_n);
+                return false;
+            }
+            return true;
+        }
+
+    public:
+        static constexpr std::size_t chunk_faces = 1 << 15;
+        const Element* _element_p = nullptr;
+        const Property* _list_p = nullptr;
+        std::size_t _vertex_n = 0;
+        std::vector<std::size_t> _chunk_starts; // byte offset of each chunk, ascii ones end where the next one starts
+        std::vector<std::size_t> _chunk_offsets; // prefix summed triangle counts
+        std::vector<std::size_t> _range_faces; // faces of each ascii chunk
+        bool _swap = false;
+        bool _ascii = false;
+    };
+}
@@ -1,84 +1,192 @@
 #pragma once
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <limits>
+#include <utility>
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <SDL3/SDL_filesystem.h>
+#include <fmt/base.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include "core/queues.hpp"
+#include "core/platform.hpp"
+#include "core/staging.hpp"
+#include "core/cache.hpp"
+#include "components/mesh/chunked_mesh.hpp"
+#include "components/mesh/welder.hpp"
+#include "components/mesh/optimizer.hpp"
+#include "components/mesh/simplifier.hpp"
+#include "core/parallel.hpp"
+#include "components/extra/ply.hpp"
 
 struct Plymesh {
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::string_view path_rel, std::optional<glm::vec3> color = std::nullopt) {
-        std::ifstream file;
+    struct LoadInfo {
+        std::string_view path; // relative to the executable
+        bool packed = false; // positions quantized to the mesh bounds, octahedral normals and 8 bit colors in 16 bytes
+        float weld_epsilon = 0.0f; // weld equal positions, or positions within the same cell when > 0
+        bool optimize = false; // reorder triangles and vertices for vertex cache locality and less overdraw
+        std::size_t lod_n = 0; // simplified detail levels on top of the full resolution
+        bool meshlets = false; // bounds of small triangle clusters for gpu culling
+        std::atomic<float>* progress_p = nullptr; // loading progress in [0, 1], for background loading
+        bool cache = false; // read the final buffer contents from a cache next to the source, (re)writing it when outdated, a miss writes it while streaming
+        bool cache_verify = false; // hash all cache sections when opening it, not only its entry table
+    };
+    // returns whether the mesh was uploaded
+    auto init(vk::Device device, vma::Allocator vmalloc, Queues& queues, const LoadInfo& info) -> bool {
+        auto time_beg = std::chrono::steady_clock::now();
         std::string path_full = SDL_GetBasePath();
-        path_full.append(path_rel.data());
-		file.open(path_full, std::ifstream::binary);
-        if (file.good()) {
-            std::string line;
-
-            // validate header start
-            std::getline(file, line);
-            if (line != "ply") {
-                fmt::println("corrupted header for {}", path_full);
-            }
-            
-            // ignoring format for now
-            std::getline(file, line);
-
-            // element vertex N
-            std::getline(file, line);
-            size_t str_pos = line.find_last_of(' ');
-            std::string vert_n_str = line.substr(str_pos + 1, line.size() - str_pos);
-            size_t vert_n = std::stoi(vert_n_str);
-            
-            // skip parsing vertex contents for now
-            for (size_t i = 0; i < 6; i++) {
-                std::getline(file, line);
-            }
+        path_full.append(info.path);
+        // one cache per vertex layout, so switching layouts does not invalidate the other
+        std::string path_cache = path_full + (info.packed ? ".packed.cache" : ".full.cache");
+        cache::Stamp stamp = cache::get_stamp(path_full, cache_version, get_cache_key(info));
+        if (info.cache && load_cache(device, vmalloc, queues, info, path_cache, stamp)) return true;
 
-            // element face N
-            std::getline(file, line);
-            str_pos = line.find_last_of(' ');
-            std::string face_n_str = line.substr(str_pos + 1, line.size() - str_pos);
-            size_t face_n = std::stoi(face_n_str);
+        platform::MappedFile file;
+        if (!file.open(path_full)) {
+            fmt::println("failed to load ply file: {}", path_full);
+            return false;
+        }
 
-            // skip face properties
-            std::getline(file, line);
+        // parse header and locate element data
+        ply::Header header;
+        if (!header.parse(file.data())) {
+            fmt::println("corrupted header for {}", path_full);
+            file.close();
+            return false;
+        }
+        const ply::Element* vertex_p = header.find("vertex");
+        const ply::Element* face_p = header.find("face");
+        if (vertex_p == nullptr || face_p == nullptr) {
+            fmt::println("missing vertex or face element in {}", path_full);
+            file.close();
+            return false;
+        }
 
-            // validate header end
-            std::getline(file, line);
-            if (line != "end_header") {
-                fmt::println("missing/unexpected header end for {}", path_full);
-            }
+        // prepare vertex conversion and scan faces for the final index count
+        ply::ScalarReader<10> vertex_reader;
+        ply::TriangleReader<Index> face_reader;
+        if (!init_vertex_reader(header, *vertex_p, vertex_reader) || !init_face_reader(header, *face_p, vertex_p->count, face_reader)) {
+            fmt::println("failed to read {}", path_full);
+            file.close();
+            return false;
+        }
+        std::size_t vertex_n = vertex_p->count;
+        std::size_t index_n = face_reader.get_index_count(0, face_reader.get_chunk_count());
+        if (vertex_n == 0 || index_n == 0) {
+            fmt::println("empty mesh in {}", path_full);
+            file.close();
+            return false;
+        }
+        report(info.progress_p, 0.05f);
+        // weld duplicates and get the bounds for quantization before the first chunk is written
+        _packed = info.packed;
+        _bounds = {};
+        Welder welder;
+        welder.init(vertex_n, info.weld_epsilon);
+        std::vector<glm::vec3> positions;
+        bool in_memory = info.optimize || info.lod_n > 0 || info.meshlets;
+        if (!read_positions(header, *vertex_p, welder, in_memory ? &positions : nullptr)) {
+            fmt::println("failed to read positions of {}", path_full);
+            file.close();
+            return false;
+        }
+        welder.weld();
+        report(info.progress_p, 0.3f);
 
-            // read little endian vertices
-            typedef std::pair<glm::vec3, glm::vec3> RawVertex;
-            std::vector<RawVertex> raw_vertices(vert_n);
-            file.read(reinterpret_cast<char*>(raw_vertices.data()), sizeof(RawVertex) * raw_vertices.size());
-            // flip y and swap y with z and insert into full vertex vector
-            std::vector<Vertex> vertices;
-            vertices.reserve(vert_n);
-            for (auto& vertex: raw_vertices) {
-                glm::vec4 pos { vertex.first.x, -vertex.first.z, vertex.first.y, 1 };
-                glm::vec4 norm { vertex.second.x, vertex.second.y, vertex.second.z, 0 };
-                glm::vec4 col = color.has_value() ? glm::vec4(color.value(), 1) : norm;
-                vertices.emplace_back(pos, norm, col);
-            }
+        // stream converted chunks straight into device memory
+        Converter converter = get_converter(vertex_reader);
+        Source source {
+            .vertex_reader = vertex_reader,
+            .face_reader = face_reader,
+            .welder = welder,
+            .positions = positions,
+            .optimize = info.optimize,
+            .lod_n = info.lod_n,
+            .meshlets = info.meshlets,
+            .progress_p = info.progress_p,
+        };
+        cache::Writer writer;
+        cache::Writer* writer_p = info.cache && writer.open(path_cache, section_n) ? &writer : nullptr;
+        bool success;
+        if (_packed) {
+            success = load(device, vmalloc, queues, source, _mesh_packed, [&](const std::array<float, 10>& values) {
+                return pack(converter(values), _bounds);
+            }, writer_p);
+        }
+        else success = load(device, vmalloc, queues, source, _mesh, converter, writer_p);
+        std::size_t file_size = file._size;
+        file.close();
+        if (!success) fmt::println("failed to upload {}", path_full);
+        if (writer_p != nullptr) {
+            if (!success) writer.abort();
+            else if (_packed) write_cache(writer, stamp, _mesh_packed);
+            else write_cache(writer, stamp, _mesh);
+        }
 
-            // read little endian faces into indices
-            std::vector<uint32_t> raw_indices;
-            raw_indices.reserve(face_n * 3);
-            for (size_t i = 0; i < face_n; i++) {
-                uint8_t indices_n; // number of indices per face
-                file.read(reinterpret_cast<char*>(&indices_n), sizeof(uint8_t));
-                std::array<int, 3> indices_face;
-                file.read(reinterpret_cast<char*>(&indices_face), sizeof(int) * 3);
-                raw_indices.insert(raw_indices.end(), indices_face.cbegin(), indices_face.cend());
+        // load time report
+        auto time_end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(time_end - time_beg).count();
+        double mb = (double)file_size / (1024.0 * 1024.0);
+        double rss = (double)platform::get_peak_rss() / (1024.0 * 1024.0);
+        double vram = (double)get_memory_size() / (1024.0 * 1024.0);
+        bool direct = _packed ? _mesh_packed._vertices._mapped_p != nullptr : _mesh._vertices._mapped_p != nullptr;
+        fmt::println("loaded {}: {} vertices, {} triangles, {:.1f} MB in {:.1f} ms ({:.1f} MB/s, peak rss {:.1f} MB, {} upload)",
+            info.path, vertex_n, index_n / 3, mb, ms, mb / (ms / 1000.0), rss, direct ? "direct" : "staged");
+        fmt::println("\t{} vertex layout: {} bytes per vertex, {:.1f} MB device memory",
+            _packed ? "packed" : "full", _packed ? sizeof(VertexPacked) : sizeof(Vertex), vram);
+        // welding and index compaction report
+        auto& mesh_chunks = _packed ? _mesh_packed._chunks : _mesh._chunks;
+        std::size_t compact_n = 0;
+        for (auto& chunk: mesh_chunks) compact_n += chunk.compact;
+        double vram_unwelded = (double)(vertex_n * (_packed ? sizeof(VertexPacked) : sizeof(Vertex)) + index_n * sizeof(Index)) / (1024.0 * 1024.0);
+        fmt::println("\twelded {} -> {} vertices (-{:.1f}%), {}/{} chunks with 16 bit indices, {:.1f} -> {:.1f} MB device memory",
+            vertex_n, welder.get_unique_count(), 100.0 * (1.0 - (double)welder.get_unique_count() / (double)vertex_n),
+            compact_n, mesh_chunks.size(), vram_unwelded, vram);
+        // simplified levels report
+        std::size_t level_n = _packed ? _mesh_packed._level_n : _mesh._level_n;
+        std::size_t base_n = mesh_chunks.size() / level_n;
+        for (std::size_t l = 1; l < level_n; l++) {
+            std::size_t level_index_n = 0;
+            float error_max = 0.0f;
+            for (std::size_t c = l * base_n; c < (l + 1) * base_n; c++) {
+                level_index_n += mesh_chunks[c].index_n;
+                error_max = std::max(error_max, mesh_chunks[c].error);
             }
-            file.close();
-            
-            // create actual mesh from raw data
-            _mesh.init(vmalloc, queues, vertices, raw_indices);
-        }
-        else {
-            fmt::println("failed to load ply file: {}", path_full);
+            fmt::println("\tlod {}: {} triangles ({:.1f}%), max error {:.4f}",
+                l, level_index_n / 3, 100.0 * (double)level_index_n / (double)index_n, error_max);
         }
+        return success;
     }
     void destroy(vma::Allocator vmalloc) {
-        _mesh.destroy(vmalloc);
+        if (_packed) _mesh_packed.destroy(vmalloc);
+        else _mesh.destroy(vmalloc);
+    }
+    // device memory held by vertex and index buffers
+    auto get_memory_size() const -> std::size_t {
+        if (_packed) return _mesh_packed.get_memory_size();
+        else return _mesh.get_memory_size();
+    }
+    // pick detail levels per chunk, a level is used once its error times error_scale is below the distance to the eye
+    void select_lod(glm::vec3 eye, float error_scale) {
+        if (_packed) _mesh_packed.select_levels(eye, error_scale);
+        else _mesh.select_levels(eye, error_scale);
+    }
+    void reset_lod() {
+        if (_packed) _mesh_packed.reset_levels();
+        else _mesh.reset_levels();
+    }
+    auto get_drawn_index_count() const -> std::size_t {
+        if (_packed) return _mesh_packed.get_drawn_index_count();
+        else return _mesh.get_drawn_index_count();
     }
 
     struct Vertex {
@@ -86,6 +194,690 @@ struct Plymesh {
         glm::vec4 norm;
         glm::vec4 color;
     };
-    typedef uint32_t Index;
-    Mesh<Vertex, Index> _mesh;
-};
\ No newline at end of file
+    struct VertexPacked {
+        uint64_t pos; // R16G16B16A16Unorm, relative to bounds
+        uint32_t norm; // R16G16Snorm, octahedral
+        uint32_t color; // R8G8B8A8Unorm
+    };
+    static_assert(sizeof(VertexPacked) == 16);
+    // vertex shader push constants, identity for the full layout
+    struct Bounds {
+        glm::vec4 min = { 0, 0, 0, 0 };
+        glm::vec4 extent = { 1, 1, 1, 1 };
+    };
+    typedef uint32_t Index; // as decoded, chunks are stored with 16 or 32 bit indices
+    typedef IndexChunk Chunk;
+    static constexpr float lod_ratio = 0.25f; // target triangle ratio of each level to the previous one
+    static constexpr float lod_stall = 0.8f; // stop adding levels once a level keeps more than this ratio
+    static constexpr uint32_t cache_version = 1; // bump whenever processing or the cached layout changes
+    ChunkedMesh<Vertex> _mesh;
+    ChunkedMesh<VertexPacked> _mesh_packed;
+    Bounds _bounds;
+    bool _packed = false;
+
+private:
+    static auto init_vertex_reader(const ply::Header& header, const ply::Element& element, ply::ScalarReader<10>& reader) -> bool {
+        std::array<const ply::Property*, 10> properties {
+            element.find("x"), element.find("y"), element.find("z"),
+            element.find("nx"), element.find("ny"), element.find("nz"),
+            element.find("red"), element.find("green"), element.find("blue"), element.find("alpha"),
+        };
+        if (properties[0] == nullptr || properties[1] == nullptr || properties[2] == nullptr) {
+            fmt::println("missing vertex position properties");
+            return false;
+        }
+        return reader.init(header, element, properties);
+    }
+    static auto init_face_reader(const ply::Header& header, const ply::Element& element, std::size_t vertex_n, ply::TriangleReader<Index>& reader) -> bool {
+        const ply::Property* list_p = element.find("vertex_indices");
+        if (list_p == nullptr) list_p = element.find("vertex_index");
+        if (list_p == nullptr || !list_p->is_list()) {
+            fmt::println("missing face index list property");
+            return false;
+        }
+        return reader.init(header, element, *list_p, vertex_n);
+    }
+    // turns raw property values into the full vertex layout
+    struct Converter {
+        auto operator()(const std::array<float, 10>& values) const -> Vertex {
+            // flip y and swap y with z
+            glm::vec4 pos { values[0], -values[2], values[1], 1 };
+            glm::vec4 norm = has_normals ? glm::vec4(values[3], values[4], values[5], 0) : glm::vec4(0, 0, -1, 0);
+            glm::vec4 col;
+            if (has_colors) col = glm::vec4(values[6], values[7], values[8], has_alpha ? values[9] : 1.0f / color_scale) * color_scale;
+            else col = norm;
+            return Vertex { pos, norm, col };
+        }
+        float color_scale = 1.0f;
+        bool has_normals = false;
+        bool has_colors = false;
+        bool has_alpha = false;
+    };
+    static auto get_converter(ply::ScalarReader<10>& reader) -> Converter {
+        auto& properties = reader._properties;
+        Converter converter {
+            .has_normals = properties[3] && properties[4] && properties[5],
+            .has_colors = properties[6] && properties[7] && properties[8],
+            .has_alpha = properties[9] != nullptr,
+        };
+        // integer colors are normalized by their type range
+        if (converter.has_colors) {
+            switch (properties[6]->type) {
+                case ply::Type::eUint8: converter.color_scale = 1.0f / 255.0f; break;
+                case ply::Type::eUint16: converter.color_scale = 1.0f / 65535.0f; break;
+                default: break;
+            }
+        }
+        return converter;
+    }
+    // read positions once for welding and for the bounds used by packing, optionally keeping them
+    auto read_positions(const ply::Header& header, const ply::Element& element, Welder& welder, std::vector<glm::vec3>* positions_p) -> bool {
+        ply::ScalarReader<3> reader;
+        if (!reader.init(header, element, { element.find("x"), element.find("y"), element.find("z") })) return false;
+        // one partial result per reader batch, as each batch is processed by a single thread
+        std::size_t batches_n = (element.count + reader.batch_size - 1) / reader.batch_size;
+        std::vector<std::pair<glm::vec3, glm::vec3>> partials(batches_n, {
+            glm::vec3(std::numeric_limits<float>::max()),
+            glm::vec3(std::numeric_limits<float>::lowest())
+        });
+        if (positions_p != nullptr) positions_p->resize(element.count);
+        bool success = reader.read(0, element.count, [&](std::size_t i, const std::array<float, 3>& values) {
+            auto& [min, max] = partials[i / reader.batch_size];
+            glm::vec3 pos { values[0], values[1], values[2] };
+            min = glm::min(min, pos);
+            max = glm::max(max, pos);
+            welder.set(i, pos);
+            if (positions_p != nullptr) (*positions_p)[i] = pos;
+        });
+        if (!success) return false;
+        if (!_packed) return true;
+
+        glm::vec3 min = partials[0].first;
+        glm::vec3 max = partials[0].second;
+        for (auto& partial: partials) {
+            min = glm::min(min, partial.first);
+            max = glm::max(max, partial.second);
+        }
+        // apply the same swizzle as the vertex conversion
+        glm::vec3 swizzled_min { min.x, -max.z, min.y };
+        glm::vec3 swizzled_max { max.x, -min.z, max.y };
+        glm::vec3 extent = swizzled_max - swizzled_min;
+        // avoid division by zero for flat meshes
+        extent = glm::max(extent, glm::vec3(std::numeric_limits<float>::min()));
+        _bounds = { glm::vec4(swizzled_min, 0), glm::vec4(extent, 1) };
+        return true;
+    }
+    static auto encode_octahedral(glm::vec3 norm) -> glm::vec2 {
+        float sum = std::abs(norm.x) + std::abs(norm.y) + std::abs(norm.z);
+        if (sum == 0.0f) return { 0, 0 };
+        norm /= sum;
+        glm::vec2 enc { norm.x, norm.y };
+        if (norm.z < 0.0f) {
+            glm::vec2 sign { enc.x >= 0.0f ? 1.0f : -1.0f, enc.y >= 0.0f ? 1.0f : -1.0f };
+            enc = (1.0f - glm::abs(glm::vec2(enc.y, enc.x))) * sign;
+        }
+        return enc;
+    }
+    static auto pack(const Vertex& vertex, const Bounds& bounds) -> VertexPacked {
+        glm::vec4 pos = (vertex.pos - bounds.min) / bounds.extent;
+        return VertexPacked {
+            .pos = glm::packUnorm4x16(glm::vec4(glm::vec3(pos), 1.0f)),
+            .norm = glm::packSnorm2x16(encode_octahedral(glm::vec3(vertex.norm))),
+            .color = glm::packUnorm4x8(vertex.color),
+        };
+    }
+    // everything needed to produce the final vertices and indices
+    struct Source {
+        ply::ScalarReader<10>& vertex_reader;
+        ply::TriangleReader<Index>& face_reader;
+        const Welder& welder;
+        std::vector<glm::vec3>& positions; // source positions, only read when optimizing or simplifying
+        bool optimize;
+        std::size_t lod_n;
+        bool meshlets;
+        std::atomic<float>* progress_p;
+    };
+    static void report(std::atomic<float>* progress_p, float progress) {
+        if (progress_p != nullptr) progress_p->store(progress, std::memory_order_relaxed);
+    }
+    // cache sections, each one holds a single array
+    enum Section: uint32_t { eMeta, eChunks, eSpheres, eVertices, eIndicesCompact, eIndicesWide, eMeshlets };
+    static constexpr std::size_t section_n = 7;
+    struct CacheMeta {
+        Bounds bounds;
+        uint64_t vertex_n;
+        uint32_t level_n;
+        uint32_t packed;
+    };
+    static auto get_cache_key(const LoadInfo& info) -> uint64_t {
+        uint32_t epsilon;
+        std::memcpy(&epsilon, &info.weld_epsilon, sizeof(epsilon));
+        uint64_t key = 0;
+        key = cache::combine(key, info.packed);
+        key = cache::combine(key, epsilon);
+        key = cache::combine(key, info.optimize);
+        key = cache::combine(key, info.lod_n);
+        key = cache::combine(key, info.meshlets);
+        return key;
+    }
+    // upload straight from a valid cache
+    auto load_cache(vk::Device device, vma::Allocator vmalloc, Queues& queues, const LoadInfo& info, const std::string& path_cache, const cache::Stamp& stamp) -> bool {
+        auto time_beg = std::chrono::steady_clock::now();
+        cache::Reader reader;
+        if (!reader.open(path_cache, stamp, info.cache_verify)) {
+            fmt::println("building cache for {}", info.path);
+            return false;
+        }
+        report(info.progress_p, 0.3f);
+        auto meta = reader.get<CacheMeta>(eMeta);
+        if (meta.size() != 1 || meta[0].packed != (uint32_t)info.packed) {
+            fmt::println("corrupted cache: {}", path_cache);
+            reader.close();
+            return false;
+        }
+        _packed = info.packed;
+        _bounds = meta[0].bounds;
+        bool success;
+        if (_packed) success = load_cached(device, vmalloc, queues, reader, meta[0], _mesh_packed);
+        else success = load_cached(device, vmalloc, queues, reader, meta[0], _mesh);
+        std::size_t file_size = reader.get_size();
+        reader.close();
+        if (!success) {
+            fmt::println("corrupted cache: {}", path_cache);
+            return false;
+        }
+
+        // load time report
+        auto time_end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(time_end - time_beg).count();
+        double mb = (double)file_size / (1024.0 * 1024.0);
+        auto& chunks = _packed ? _mesh_packed._chunks : _mesh._chunks;
+        std::size_t base_n = _packed ? _mesh_packed._levels.size() : _mesh._levels.size();
+        std::size_t index_n = 0;
+        for (std::size_t c = 0; c < base_n; c++) index_n += chunks[c].index_n;
+        fmt::println("loaded {} from cache: {} vertices, {} triangles, {:.1f} MB in {:.1f} ms ({:.1f} MB/s)",
+            info.path, meta[0].vertex_n, index_n / 3, mb, ms, mb / (ms / 1000.0));
+        return true;
+    }
+    template<typename V>
+    static auto load_cached(vk::Device device, vma::Allocator vmalloc, Queues& queues, const cache::Reader& reader, const CacheMeta& meta, ChunkedMesh<V>& mesh) -> bool {
+        auto chunks = reader.get<Chunk>(eChunks);
+        auto spheres = reader.get<glm::vec4>(eSpheres);
+        auto vertices = reader.get(eVertices);
+        auto indices_compact = reader.get(eIndicesCompact);
+        auto indices_wide = reader.get(eIndicesWide);
+        auto meshlets = reader.get(eMeshlets);
+        // sections have to match the chunks they are drawn with
+        std::size_t compact_n = 0;
+        std::size_t wide_n = 0;
+        for (auto& chunk: chunks) {
+            if (chunk.compact) compact_n += chunk.index_n;
+            else wide_n += chunk.index_n;
+        }
+        bool valid = meta.level_n > 0 && chunks.size() > 0 && chunks.size() % meta.level_n == 0;
+        valid = valid && (spheres.size() == 0 || spheres.size() == chunks.size() / meta.level_n);
+        valid = valid && vertices.size() == meta.vertex_n * sizeof(V);
+        valid = valid && indices_compact.size() == compact_n * sizeof(uint16_t);
+        valid = valid && indices_wide.size() == wide_n * sizeof(uint32_t);
+        valid = valid && meshlets.size() % sizeof(Meshlet) == 0;
+        if (!valid) return false;
+
+        mesh.init(vmalloc, queues._universal_i, meta.vertex_n, std::vector<Chunk>(chunks.begin(), chunks.end()), meta.level_n);
+        mesh._spheres.assign(spheres.begin(), spheres.end());
+        if (meshlets.size() > 0) mesh.init_meshlets(vmalloc, queues._universal_i, meshlets.size() / sizeof(Meshlet));
+        StagingStream stream;
+        stream.init(device, vmalloc, queues);
+        upload_cached(stream, mesh, vertices, indices_compact, indices_wide, meshlets);
+        stream.destroy();
+        return true;
+    }
+    // upload the final buffer contents mapped from the cache
+    template<typename V>
+    static void upload_cached(StagingStream& stream, ChunkedMesh<V>& mesh, std::span<const std::byte> vertices, std::span<const std::byte> indices_compact, std::span<const std::byte> indices_wide, std::span<const std::byte> meshlets) {
+        stream.begin(mesh._vertices._buffer, mesh._vertices._allocation, mesh._vertices._mapped_p);
+        write(stream, vertices);
+        if (indices_compact.size() > 0) {
+            stream.begin(mesh._indices_compact._buffer, mesh._indices_compact._allocation, mesh._indices_compact._mapped_p);
+            write(stream, indices_compact);
+        }
+        if (indices_wide.size() > 0) {
+            stream.begin(mesh._indices_wide._buffer, mesh._indices_wide._allocation, mesh._indices_wide._mapped_p);
+            write(stream, indices_wide);
+        }
+        if (meshlets.size() > 0) {
+            stream.begin(mesh._meshlets._data, mesh._meshlets._allocation, nullptr);
+            write(stream, meshlets);
+        }
+    }
+    // buffer contents were streamed into the writer while uploading, only the small sections are left
+    template<typename V>
+    auto write_cache(cache::Writer& writer, const cache::Stamp& stamp, const ChunkedMesh<V>& mesh) const -> bool {
+        CacheMeta meta {
+            .bounds = _bounds,
+            .vertex_n = mesh._vertices._vertex_n,
+            .level_n = (uint32_t)mesh._level_n,
+            .packed = _packed,
+        };
+        writer.add(eMeta, std::span(&meta, 1));
+        writer.add(eChunks, std::span(mesh._chunks));
+        writer.add(eSpheres, std::span(mesh._spheres));
+        return writer.commit(stamp);
+    }
+    // welded indices decoded straight from the file
+    struct DecodedIndices {
+        auto get_chunk_count() const -> std::size_t {
+            return reader.get_chunk_count();
+        }
+        auto get_index_count(std::size_t chunk_beg, std::size_t chunk_end) const -> std::size_t {
+            return reader.get_index_count(chunk_beg, chunk_end);
+        }
+        auto read(std::size_t chunk_beg, std::size_t chunk_end, Index* dst_p) -> bool {
+            if (!reader.read(chunk_beg, chunk_end, dst_p)) return false;
+            std::size_t index_n = reader.get_index_count(chunk_beg, chunk_end);
+            std::size_t batch_size = 1 << 16;
+            parallel::for_each((index_n + batch_size - 1) / batch_size, [&](std::size_t b) {
+                std::size_t end = std::min(index_n, (b + 1) * batch_size);
+                for (std::size_t i = b * batch_size; i < end; i++) dst_p[i] = welder.remap(dst_p[i]);
+            });
+            return true;
+        }
+        ply::TriangleReader<Index>& reader;
+        const Welder& welder;
+    };
+    // final indices held in memory, grouped into the face chunks of the reader
+    struct StoredIndices {
+        auto get_chunk_count() const -> std::size_t {
+            return offsets.size() - 1;
+        }
+        auto get_index_count(std::size_t chunk_beg, std::size_t chunk_end) const -> std::size_t {
+            return offsets[chunk_end] - offsets[chunk_beg];
+        }
+        auto read(std::size_t chunk_beg, std::size_t chunk_end, Index* dst_p) -> bool {
+            std::copy(indices.cbegin() + offsets[chunk_beg], indices.cbegin() + offsets[chunk_end], dst_p);
+            return true;
+        }
+        std::vector<Index> indices;
+        std::vector<std::size_t> offsets;
+    };
+
+    template<typename V, typename Fnc>
+    static auto load(vk::Device device, vma::Allocator vmalloc, Queues& queues, Source& source, ChunkedMesh<V>& mesh, Fnc&& convert, cache::Writer* writer_p) -> bool {
+        StagingStream stream, stream_compact, stream_wide;
+        stream.init(device, vmalloc, queues);
+        stream_compact.init(device, vmalloc, queues);
+        stream_wide.init(device, vmalloc, queues);
+        std::size_t group_size = stream.get_chunk_size() / sizeof(Index);
+        std::vector<Index> scratch;
+        std::vector<Chunk> chunks;
+        bool success;
+        if (source.optimize || source.lod_n > 0 || source.meshlets) {
+            // optimized order, simplification and meshlets need all indices and vertices in memory
+            StoredIndices indices;
+            std::vector<uint32_t> fetch_remap;
+            std::vector<float> errors;
+            std::vector<glm::vec4> spheres;
+            std::size_t level_n = 1;
+            success = store_indices(source, indices);
+            if (success && source.lod_n > 0) {
+                spheres = get_spheres(indices, source.positions);
+                level_n = build_levels(indices, source.positions, source.lod_n + 1, errors);
+            }
+            report(source.progress_p, 0.5f);
+            if (success && source.optimize) optimize(source, indices, fetch_remap);
+            else {
+                fetch_remap.resize(source.welder.get_unique_count());
+                for (std::size_t i = 0; i < fetch_remap.size(); i++) fetch_remap[i] = (uint32_t)i;
+            }
+            success = success && get_chunks(indices, group_size, scratch, chunks);
+            if (success) {
+                for (std::size_t c = 0; c < errors.size(); c++) chunks[c].error = errors[c];
+                mesh.init(vmalloc, queues._universal_i, source.welder.get_unique_count(), std::move(chunks), level_n);
+                mesh._spheres = std::move(spheres);
+                std::vector<V> vertices(source.welder.get_unique_count());
+                success = source.vertex_reader.read(0, source.vertex_reader._element_p->count, [&](std::size_t i, const std::array<float, 10>& values) {
+                    if (source.welder.is_unique(i)) vertices[fetch_remap[source.welder.remap(i)]] = convert(values);
+                });
+                report(source.progress_p, 0.7f);
+                begin_vertices(stream, mesh, writer_p);
+                write(stream, std::as_bytes(std::span(vertices)));
+                report(source.progress_p, 0.8f);
+                begin_indices(stream_compact, stream_wide, mesh, writer_p);
+                success = success && upload_indices(stream_compact, stream_wide, mesh, indices, group_size, scratch);
+                report(source.progress_p, 0.9f);
+            }
+            if (success && source.meshlets) {
+                std::vector<Meshlet> meshlets = get_meshlets(mesh, indices, source.positions, fetch_remap);
+                mesh.init_meshlets(vmalloc, queues._universal_i, meshlets.size());
+                if (writer_p != nullptr) writer_p->add(eMeshlets, std::span(meshlets));
+                stream.begin(mesh._meshlets._data, mesh._meshlets._allocation, nullptr);
+                write(stream, std::as_bytes(std::span(meshlets)));
+                fmt::println("\t{} meshlets of up to {} triangles", meshlets.size(), meshlets::triangle_n);
+            }
+        }
+        else {
+            DecodedIndices indices { source.face_reader, source.welder };
+            success = get_chunks(indices, group_size, scratch, chunks);
+            if (success) {
+                mesh.init(vmalloc, queues._universal_i, source.welder.get_unique_count(), std::move(chunks));
+                begin_vertices(stream, mesh, writer_p);
+                success = upload_vertices<V>(stream, source.vertex_reader, source.welder, convert);
+                report(source.progress_p, 0.6f);
+                begin_indices(stream_compact, stream_wide, mesh, writer_p);
+                success = success && upload_indices(stream_compact, stream_wide, mesh, indices, group_size, scratch);
+            }
+        }
+        stream.destroy();
+        stream_compact.destroy();
+        stream_wide.destroy();
+        return success;
+    }
+    // decode all welded indices and move positions into welded order
+    static auto store_indices(Source& source, StoredIndices& dst) -> bool {
+        DecodedIndices decoded { source.face_reader, source.welder };
+        std::size_t chunks_n = decoded.get_chunk_count();
+        dst.offsets.resize(chunks_n + 1);
+        for (std::size_t c = 0; c <= chunks_n; c++) dst.offsets[c] = decoded.get_index_count(0, c);
+        dst.indices.resize(dst.offsets.back());
+        if (!decoded.read(0, chunks_n, dst.indices.data())) return false;
+
+        // unique vertices only move to lower ids
+        auto& positions = source.positions;
+        const Welder& welder = source.welder;
+        for (std::size_t i = 0; i < positions.size(); i++) {
+            if (welder.is_unique(i)) positions[welder.remap(i)] = positions[i];
+        }
+        positions.resize(welder.get_unique_count());
+        return true;
+    }
+    // bounding sphere per face chunk, in the swizzled space of the converted vertices
+    static auto get_spheres(const StoredIndices& indices, std::span<const glm::vec3> positions) -> std::vector<glm::vec4> {
+        std::vector<glm::vec4> spheres(indices.get_chunk_count());
+        parallel::for_each(spheres.size(), [&](std::size_t c) {
+            glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+            for (std::size_t i = indices.offsets[c]; i < indices.offsets[c + 1]; i++) {
+                min = glm::min(min, positions[indices.indices[i]]);
+                max = glm::max(max, positions[indices.indices[i]]);
+            }
+            glm::vec3 center = (min + max) * 0.5f;
+            float radius = 0.0f;
+            for (std::size_t i = indices.offsets[c]; i < indices.offsets[c + 1]; i++) {
+                radius = std::max(radius, glm::length(positions[indices.indices[i]] - center));
+            }
+            spheres[c] = { center.x, -center.z, center.y, radius };
+        });
+        return spheres;
+    }
+    // append simplified copies of the face chunks until level_n levels exist or simplification stalls
+    // chunk borders are locked, so neighboring chunks may use different levels without cracks
+    static auto build_levels(StoredIndices& indices, std::span<const glm::vec3> positions, std::size_t level_n, std::vector<float>& errors) -> std::size_t {
+        auto time_beg = std::chrono::steady_clock::now();
+        std::size_t base_n = indices.get_chunk_count();
+        static constexpr uint32_t unowned = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> owners(positions.size(), unowned);
+        std::vector<uint8_t> locked(positions.size(), 0);
+        for (std::size_t c = 0; c < base_n; c++) {
+            for (std::size_t i = indices.offsets[c]; i < indices.offsets[c + 1]; i++) {
+                uint32_t& owner = owners[indices.indices[i]];
+                if (owner == unowned) owner = (uint32_t)c;
+                else if (owner != c) locked[indices.indices[i]] = 1;
+            }
+        }
+        owners = {};
+
+        errors.assign(base_n, 0.0f);
+        std::vector<std::vector<uint32_t>> simplified(base_n);
+        std::size_t levels_built = 1;
+        for (; levels_built < level_n; levels_built++) {
+            // each level is simplified from the previous one, errors accumulate
+            std::size_t prev_beg = (levels_built - 1) * base_n;
+            std::vector<float> level_errors(base_n);
+            parallel::for_each(base_n, [&](std::size_t c) {
+                std::size_t beg = indices.offsets[prev_beg + c];
+                std::size_t end = indices.offsets[prev_beg + c + 1];
+                std::span<const uint32_t> src { indices.indices.data() + beg, end - beg };
+                std::size_t target_n = (std::size_t)((float)(src.size() / 3) * lod_ratio) * 3;
+                level_errors[c] = errors[prev_beg + c] + simplifier::simplify(src, positions, locked, target_n, simplified[c]);
+            });
+            std::size_t prev_n = indices.offsets[prev_beg + base_n] - indices.offsets[prev_beg];
+            std::size_t level_index_n = 0;
+            for (auto& chunk: simplified) level_index_n += chunk.size();
+            if ((float)level_index_n > (float)prev_n * lod_stall) break;
+            for (std::size_t c = 0; c < base_n; c++) {
+                indices.indices.insert(indices.indices.end(), simplified[c].cbegin(), simplified[c].cend());
+                indices.offsets.push_back(indices.indices.size());
+            }
+            errors.insert(errors.end(), level_errors.cbegin(), level_errors.cend());
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_beg).count();
+        fmt::println("\tsimplified {} levels in {:.1f} ms", levels_built - 1, ms);
+        return levels_built;
+    }
+    // vertex cache and overdraw optimization per face chunk, followed by vertex fetch reordering
+    static void optimize(Source& source, StoredIndices& dst, std::vector<uint32_t>& fetch_remap) {
+        auto time_beg = std::chrono::steady_clock::now();
+        auto& positions = source.positions;
+        const Welder& welder = source.welder;
+        std::size_t chunks_n = dst.get_chunk_count();
+        std::size_t base_n = source.face_reader.get_chunk_count();
+        glm::vec3 center { 0, 0, 0 };
+        for (auto& pos: positions) center = center + pos / (float)positions.size();
+
+        // chunks are drawn separately, so each one is optimized on its own
+        std::vector<std::size_t> transforms_before(chunks_n, 0);
+        std::vector<std::size_t> transforms_after(chunks_n, 0);
+        parallel::for_each(chunks_n, [&](std::size_t c) {
+            std::span<uint32_t> indices { dst.indices.data() + dst.offsets[c], dst.offsets[c + 1] - dst.offsets[c] };
+            std::vector<uint32_t> cluster_starts;
+            transforms_before[c] = optimizer::count_transforms(indices);
+            optimizer::tipsify(indices, cluster_starts);
+            optimizer::sort_clusters(indices, cluster_starts, positions, center);
+            transforms_after[c] = optimizer::count_transforms(indices);
+        });
+        fetch_remap = optimizer::get_fetch_remap(dst.indices, welder.get_unique_count());
+        std::size_t batch_size = 1 << 16;
+        parallel::for_each((dst.indices.size() + batch_size - 1) / batch_size, [&](std::size_t b) {
+            std::size_t end = std::min(dst.indices.size(), (b + 1) * batch_size);
+            for (std::size_t i = b * batch_size; i < end; i++) dst.indices[i] = fetch_remap[dst.indices[i]];
+        });
+
+        // report average cache miss ratio (per triangle) and average transform to vertex ratio of the full resolution
+        std::size_t before = 0;
+        std::size_t after = 0;
+        for (std::size_t c = 0; c < base_n; c++) {
+            before += transforms_before[c];
+            after += transforms_after[c];
+        }
+        double triangles = (double)(dst.offsets[base_n] / 3);
+        double vertices = (double)welder.get_unique_count();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_beg).count();
+        fmt::println("\toptimized in {:.1f} ms (fifo {}): acmr {:.3f} -> {:.3f}, atvr {:.3f} -> {:.3f}",
+            ms, optimizer::cache_size, (double)before / triangles, (double)after / triangles, (double)before / vertices, (double)after / vertices);
+    }
+    // meshlets of every chunk and level in final vertex order, carrying what the cull pass needs for level selection
+    template<typename V>
+    static auto get_meshlets(const ChunkedMesh<V>& mesh, const StoredIndices& indices, std::span<const glm::vec3> positions, std::span<const uint32_t> fetch_remap) -> std::vector<Meshlet> {
+        std::vector<glm::vec3> positions_final(positions.size());
+        for (std::size_t i = 0; i < positions.size(); i++) {
+            positions_final[fetch_remap[i]] = { positions[i].x, -positions[i].z, positions[i].y };
+        }
+        std::size_t chunks_n = mesh._chunks.size();
+        std::size_t base_n = mesh._levels.size();
+        std::vector<std::vector<Meshlet>> chunk_meshlets(chunks_n);
+        parallel::for_each(chunks_n, [&](std::size_t c) {
+            const Chunk& chunk = mesh._chunks[c];
+            std::size_t level = c / base_n;
+            std::span<const uint32_t> chunk_indices { indices.indices.data() + indices.offsets[c], chunk.index_n };
+            meshlets::build(chunk_indices, positions_final, chunk_meshlets[c]);
+            for (auto& meshlet: chunk_meshlets[c]) {
+                meshlet.index_beg += chunk.index_beg;
+                meshlet.vertex_offset = chunk.vertex_offset;
+                meshlet.compact = chunk.compact;
+                meshlet.level = (uint32_t)level;
+                meshlet.error = chunk.error;
+                if (level + 1 < mesh._level_n) meshlet.error_next = mesh._chunks[c + base_n].error;
+                if (mesh._spheres.size() > 0) meshlet.chunk_sphere = mesh._spheres[c % base_n];
+            }
+        });
+        std::vector<Meshlet> meshlets;
+        for (auto& part: chunk_meshlets) meshlets.insert(meshlets.end(), part.cbegin(), part.cend());
+        return meshlets;
+    }
+    // decode face chunks in groups of at most group_size indices into scratch, then call fnc(chunk_beg, chunk_end)
+    template<typename Indices, typename Fnc>
+    static auto for_each_group(Indices& indices, std::size_t group_size, std::vector<Index>& scratch, Fnc&& fnc) -> bool {
+        std::size_t chunks_n = indices.get_chunk_count();
+        for (std::size_t beg = 0; beg < chunks_n;) {
+            std::size_t end = beg + 1;
+            while (end < chunks_n && indices.get_index_count(beg, end + 1) <= group_size) end++;
+            scratch.resize(indices.get_index_count(beg, end));
+            if (!indices.read(beg, end, scratch.data())) return false;
+            fnc(beg, end);
+            beg = end;
+        }
+        return true;
+    }
+    // pick index width per face chunk from the span of its vertices
+    template<typename Indices>
+    static auto get_chunks(Indices& indices, std::size_t group_size, std::vector<Index>& scratch, std::vector<Chunk>& chunks) -> bool {
+        chunks.assign(indices.get_chunk_count(), {});
+        bool success = for_each_group(indices, group_size, scratch, [&](std::size_t beg, std::size_t end) {
+            parallel::for_each(end - beg, [&](std::size_t k) {
+                std::size_t c = beg + k;
+                std::size_t offset = indices.get_index_count(beg, c);
+                std::size_t index_n = indices.get_index_count(c, c + 1);
+                Index min = std::numeric_limits<Index>::max();
+                Index max = 0;
+                for (std::size_t i = offset; i < offset + index_n; i++) {
+                    min = std::min(min, scratch[i]);
+                    max = std::max(max, scratch[i]);
+                }
+                if (index_n == 0) min = max = 0;
+                chunks[c] = {
+                    .index_n = (uint32_t)index_n,
+                    .vertex_offset = (int32_t)min,
+                    .compact = max - min <= std::numeric_limits<uint16_t>::max(),
+                };
+            });
+        });
+        // place chunks within the index buffer of their width
+        uint32_t compact_n = 0;
+        uint32_t wide_n = 0;
+        for (auto& chunk: chunks) {
+            uint32_t& index_beg = chunk.compact ? compact_n : wide_n;
+            chunk.index_beg = index_beg;
+            index_beg += chunk.index_n;
+        }
+        return success;
+    }
+    // stream into the mesh buffers, teeing into a cache section of the same size when writing the cache
+    static auto get_tee(cache::Writer* writer_p, Section id, std::size_t size) -> std::function<void(std::span<const std::byte>)> {
+        if (writer_p == nullptr) return {};
+        std::size_t section_i = writer_p->reserve(id, size);
+        return [writer_p, section_i](std::span<const std::byte> data) { writer_p->append(section_i, data); };
+    }
+    template<typename V>
+    static void begin_vertices(StagingStream& stream, ChunkedMesh<V>& mesh, cache::Writer* writer_p) {
+        auto& vertices = mesh._vertices;
+        stream.begin(vertices._buffer, vertices._allocation, vertices._mapped_p, get_tee(writer_p, eVertices, vertices._vertex_n * sizeof(V)));
+    }
+    template<typename V>
+    static void begin_indices(StagingStream& stream_compact, StagingStream& stream_wide, ChunkedMesh<V>& mesh, cache::Writer* writer_p) {
+        auto& compact = mesh._indices_compact;
+        auto& wide = mesh._indices_wide;
+        stream_compact.begin(compact._buffer, compact._allocation, compact._mapped_p, get_tee(writer_p, eIndicesCompact, compact._index_n * sizeof(uint16_t)));
+        stream_wide.begin(wide._buffer, wide._allocation, wide._mapped_p, get_tee(writer_p, eIndicesWide, wide._index_n * sizeof(uint32_t)));
+    }
+    template<typename V, typename Fnc>
+    static auto upload_vertices(StagingStream& stream, ply::ScalarReader<10>& reader, const Welder& welder, Fnc&& convert) -> bool {
+        // convert one streaming chunk of source vertices at a time, only the first occurrence of each position is kept
+        std::size_t vertex_n = reader._element_p->count;
+        std::size_t batch = std::max<std::size_t>(1, stream.get_chunk_size() / sizeof(V));
+        std::size_t unique_beg = 0;
+        for (std::size_t beg = 0; beg < vertex_n; beg += batch) {
+            std::size_t end = std::min(vertex_n, beg + batch);
+            std::size_t unique_n = 0;
+            for (std::size_t i = beg; i < end; i++) unique_n += welder.is_unique(i);
+            V* dst_p = reinterpret_cast<V*>(stream.acquire(unique_n * sizeof(V)));
+            bool success = reader.read(beg, end, [&](std::size_t i, const std::array<float, 10>& values) {
+                if (welder.is_unique(i)) dst_p[welder.remap(i) - unique_beg] = convert(values);
+            });
+            if (!success) return false;
+            stream.commit(unique_n * sizeof(V));
+            unique_beg += unique_n;
+        }
+        return true;
+    }
+    // copy src in streaming chunk sized pieces
+    static void write(StagingStream& stream, std::span<const std::byte> src) {
+        std::size_t batch = stream.get_chunk_size();
+        for (std::size_t beg = 0; beg < src.size(); beg += batch) {
+            std::size_t size = std::min(src.size(), beg + batch) - beg;
+            std::memcpy(stream.acquire(size), src.data() + beg, size);
+            stream.commit(size);
+        }
+    }
+    // sequential writes into a stream, committing whenever the next write does not fit
+    struct StreamWriter {
+        auto reserve(std::size_t size) -> std::byte* {
+            if (_fill + size > _capacity) {
+                flush();
+                _capacity = std::max<std::size_t>(size, _stream_p->get_chunk_size());
+                _dst_p = _stream_p->acquire(_capacity);
+            }
+            std::byte* dst_p = _dst_p + _fill;
+            _fill += size;
+            return dst_p;
+        }
+        void flush() {
+            if (_fill > 0) _stream_p->commit(_fill);
+            _fill = 0;
+            _capacity = 0;
+        }
+        StagingStream* _stream_p;
+        std::byte* _dst_p = nullptr;
+        std::size_t _fill = 0;
+        std::size_t _capacity = 0;
+    };
+    // streams have to be started with begin_indices
+    template<typename V, typename Indices>
+    static auto upload_indices(StagingStream& stream_compact, StagingStream& stream_wide, ChunkedMesh<V>& mesh, Indices& indices, std::size_t group_size, std::vector<Index>& scratch) -> bool {
+        StreamWriter writer_compact { ._stream_p = &stream_compact };
+        StreamWriter writer_wide { ._stream_p = &stream_wide };
+        std::vector<std::byte*> dst_ps;
+        bool success = for_each_group(indices, group_size, scratch, [&](std::size_t beg, std::size_t end) {
+            // reserve once per width, as the reserved memory may only be committed after the group is written
+            std::size_t compact_n = 0;
+            std::size_t wide_n = 0;
+            for (std::size_t c = beg; c < end; c++) {
+                if (mesh._chunks[c].compact) compact_n += mesh._chunks[c].index_n;
+                else wide_n += mesh._chunks[c].index_n;
+            }
+            std::byte* compact_p = compact_n > 0 ? writer_compact.reserve(compact_n * sizeof(uint16_t)) : nullptr;
+            std::byte* wide_p = wide_n > 0 ? writer_wide.reserve(wide_n * sizeof(uint32_t)) : nullptr;
+            dst_ps.resize(end - beg);
+            for (std::size_t c = beg; c < end; c++) {
+                auto& chunk = mesh._chunks[c];
+                std::byte*& dst_p = chunk.compact ? compact_p : wide_p;
+                dst_ps[c - beg] = dst_p;
+                dst_p += chunk.index_n * (chunk.compact ? sizeof(uint16_t) : sizeof(uint32_t));
+            }
+            // rebase onto chunk vertex offsets
+            parallel::for_each(end - beg, [&](std::size_t k) {
+                auto& chunk = mesh._chunks[beg + k];
+                const Index* src_p = scratch.data() + indices.get_index_count(beg, beg + k);
+                if (chunk.compact) {
+                    uint16_t* dst_p = reinterpret_cast<uint16_t*>(dst_ps[k]);
+                    for (std::size_t i = 0; i < chunk.index_n; i++) dst_p[i] = (uint16_t)(src_p[i] - chunk.vertex_offset);
+                }
+                else {
+                    uint32_t* dst_p = reinterpret_cast<uint32_t*>(dst_ps[k]);
+                    for (std::size_t i = 0; i < chunk.index_n; i++) dst_p[i] = src_p[i] - chunk.vertex_offset;
+                }
+            });
+        });
+        writer_compact.flush();
+        writer_wide.flush();
+        return success;
+    }
+};
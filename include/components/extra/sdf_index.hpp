@@ -0,0 +1,320 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+//
+#include <fmt/base.h>
+#include <glm/glm.hpp>
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#endif
+#include "core/parallel.hpp"
+
+// cpu side spatial hash over the grid query points, for picking, error analysis and export
+// voxels are grouped into 4³ blocks, found by open addressing (linear probing) on their packed coordinates,
+// so most trilinear lookups touch a single block. read only after init, so it can be sampled from any thread
+struct SdfIndex {
+    typedef std::pair<glm::vec3, float> QueryPoint;
+
+    // query points have to lie on a lattice with the given spacing, starting at origin
+    auto init(std::span<const QueryPoint> query_points, glm::vec3 origin, float voxelsize) -> bool {
+        auto time_beg = std::chrono::steady_clock::now();
+        _origin = origin;
+        _voxelsize = voxelsize;
+        std::size_t batch_size = 1 << 16;
+        std::size_t batch_n = (query_points.size() + batch_size - 1) / batch_size;
+        auto get_voxel = [&](const QueryPoint& point) -> glm::ivec3 {
+            return glm::ivec3(glm::round((point.first - origin) / voxelsize));
+        };
+
+        // insert block keys, the table grows whenever it exceeds half its capacity
+        std::size_t capacity = 1024;
+        while (capacity < query_points.size() / 16) capacity *= 2;
+        while (true) {
+            _slots.assign(capacity, Slot { empty_key, 0, 0 });
+            _slot_mask = capacity - 1;
+            std::atomic<uint32_t> block_n = 0;
+            std::atomic<bool> overflow = false;
+            parallel::for_each(batch_n, [&](std::size_t b) {
+                for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size) && !overflow; i++) {
+                    glm::ivec3 voxel = get_voxel(query_points[i]);
+                    if (!is_valid(voxel)) continue;
+                    if (insert(get_key(voxel >> block_bits), block_n) > capacity / 2) overflow = true;
+                }
+            });
+            if (!overflow) {
+                _block_n = block_n;
+                break;
+            }
+            capacity *= 2;
+        }
+
+        // scatter the distances into their blocks, missing voxels stay NaN
+        _blocks.assign(_block_n, Block {});
+        parallel::for_each(batch_n, [&](std::size_t b) {
+            for (std::size_t i = b * batch_size; i < std::min(query_points.size(), (b + 1) * batch_size); i++) {
+                glm::ivec3 voxel = get_voxel(query_points[i]);
+                if (!is_valid(voxel)) continue;
+                const Slot* slot_p = find(get_key(voxel >> block_bits));
+                _blocks[slot_p->block][get_local(voxel & block_mask)] = query_points[i].second;
+            }
+        });
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_beg).count();
+        fmt::println("sdf index: {} blocks in {} slots ({:.1f} MB), built in {:.1f} ms",
+            _block_n, _slots.size(), (double)get_memory_size() / (1024.0 * 1024.0), ms);
+        return true;
+    }
+    // restore the tables of an earlier index over the same query points, e.g. from a cache
+    auto init(std::span<const std::byte> slots, std::span<const std::byte> blocks, glm::vec3 origin, float voxelsize) -> bool {
+        std::size_t slot_n = slots.size() / sizeof(Slot);
+        std::size_t block_n = blocks.size() / sizeof(Block);
+        bool valid = slot_n >= 1024 && std::has_single_bit(slot_n) && slots.size() % sizeof(Slot) == 0 && blocks.size() % sizeof(Block) == 0;
+        valid = valid && block_n <= slot_n / 2;
+        if (!valid) return false;
+        _origin = origin;
+        _voxelsize = voxelsize;
+        _slots.resize(slot_n);
+        _blocks.resize(block_n);
+        std::memcpy(_slots.data(), slots.data(), slots.size());
+        std::memcpy(static_cast<void*>(_blocks.data()), blocks.data(), blocks.size());
+        _slot_mask = slot_n - 1;
+        _block_n = (uint32_t)block_n;
+        // lookups index blocks through the slots without bounds checks
+        for (const Slot& slot: _slots) valid = valid && (slot.key == empty_key || slot.block < block_n);
+        if (!valid) destroy();
+        return valid;
+    }
+    // tables for restoring the index later
+    auto get_slots() const -> std::span<const std::byte> {
+        return std::as_bytes(std::span(_slots));
+    }
+    auto get_blocks() const -> std::span<const std::byte> {
+        return std::as_bytes(std::span(_blocks));
+    }
+    void destroy() {
+        _slots = {};
+        _blocks = {};
+        _block_n = 0;
+    }
+
+    // distance at a lattice voxel, NaN when missing
+    auto find(glm::ivec3 voxel) const -> float {
+        if (!is_valid(voxel)) return std::numeric_limits<float>::quiet_NaN();
+        const Slot* slot_p = find(get_key(voxel >> block_bits));
+        if (slot_p == nullptr) return std::numeric_limits<float>::quiet_NaN();
+        return _blocks[slot_p->block][get_local(voxel & block_mask)];
+    }
+    // trilinear distances in voxels and their gradients with respect to lattice units, NaN where a corner is missing
+    void sample(std::span<const glm::vec3> positions, std::span<float> distances, std::span<glm::vec3> gradients) const {
+        std::array<std::array<float, lanes>, 8> corners;
+        std::array<std::array<float, lanes>, 3> fractions;
+        for (std::size_t beg = 0; beg < positions.size(); beg += lanes) {
+            std::size_t n = std::min(lanes, positions.size() - beg);
+            std::array<glm::ivec3, lanes> voxels;
+            get_fractions(positions.subspan(beg, n), voxels, fractions);
+            for (std::size_t l = 0; l < lanes; l++) {
+                if (l < n) get_corners(voxels[l], corners, l);
+                else for (auto& corner: corners) corner[l] = 0.0f;
+            }
+            blend(corners, fractions, distances.subspan(beg, n), gradients.subspan(beg, n));
+        }
+    }
+    // queries per second of batched samples near the query points on all threads
+    auto benchmark(std::size_t query_n) const -> double {
+        if (_block_n == 0) return 0.0;
+        // positions within random occupied blocks, so most lookups hit
+        std::vector<glm::vec3> positions(query_n);
+        std::mt19937 gen(0);
+        std::uniform_real_distribution<float> offset(0.0f, (float)block_size);
+        std::vector<glm::ivec3> block_voxels;
+        block_voxels.reserve(_block_n);
+        for (const Slot& slot: _slots) {
+            if (slot.key == empty_key) continue;
+            block_voxels.push_back(glm::ivec3(slot.key & 0x1fffff, slot.key >> 21 & 0x1fffff, slot.key >> 42) * (int)block_size);
+        }
+        for (glm::vec3& position: positions) {
+            glm::vec3 voxel = glm::vec3(block_voxels[gen() % block_voxels.size()]) + glm::vec3(offset(gen), offset(gen), offset(gen));
+            position = _origin + voxel * _voxelsize;
+        }
+        std::vector<float> distances(query_n);
+        std::vector<glm::vec3> gradients(query_n);
+        std::size_t batch_size = 1 << 12;
+        auto time_beg = std::chrono::steady_clock::now();
+        parallel::for_each((query_n + batch_size - 1) / batch_size, [&](std::size_t b) {
+            std::size_t beg = b * batch_size;
+            std::size_t n = std::min(batch_size, query_n - beg);
+            sample(std::span(positions).subspan(beg, n), std::span(distances).subspan(beg, n), std::span(gradients).subspan(beg, n));
+        });
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_beg).count();
+        std::size_t hit_n = 0;
+        for (float distance: distances) hit_n += !std::isnan(distance);
+        double rate = (double)query_n / s;
+        fmt::println("sdf index: {} queries on {} threads in {:.1f} ms, {:.1f} M queries/s ({:.1f}% complete cells, {})",
+            query_n, parallel::get_thread_count(), s * 1000.0, rate / 1'000'000.0, 100.0 * (double)hit_n / (double)query_n, simd_name);
+        return rate;
+    }
+    auto get_memory_size() const -> std::size_t {
+        return _slots.size() * sizeof(Slot) + _blocks.size() * sizeof(Block);
+    }
+
+    static constexpr int block_bits = 2;
+    static constexpr int block_size = 1 << block_bits; // voxels along each block axis
+    static constexpr int block_mask = block_size - 1;
+    static constexpr std::size_t lanes = 8; // positions per batch
+#if defined(__AVX2__)
+    static constexpr const char* simd_name = "avx2";
+#else
+    static constexpr const char* simd_name = "scalar";
+#endif
+    glm::vec3 _origin = glm::vec3(0);
+    float _voxelsize = 1.0f;
+    uint32_t _block_n = 0;
+
+private:
+    struct Slot {
+        uint64_t key; // packed block coordinates, 21 bits each
+        uint32_t block;
+        uint32_t _pad;
+    };
+    // distances of 4³ voxels, x fastest, one cache line per 4 rows
+    struct alignas(64) Block {
+        Block() { values.fill(std::numeric_limits<float>::quiet_NaN()); }
+        auto operator[](std::size_t i) -> float& { return values[i]; }
+        auto operator[](std::size_t i) const -> float { return values[i]; }
+        std::array<float, block_size * block_size * block_size> values;
+    };
+    static constexpr uint64_t empty_key = std::numeric_limits<uint64_t>::max();
+
+    static auto is_valid(glm::ivec3 voxel) -> bool {
+        return glm::all(glm::greaterThanEqual(voxel, glm::ivec3(0))) && glm::all(glm::lessThan(voxel, glm::ivec3(1 << 21)));
+    }
+    static auto get_key(glm::ivec3 block) -> uint64_t {
+        return (uint64_t)block.x | (uint64_t)block.y << 21 | (uint64_t)block.z << 42;
+    }
+    static auto get_local(glm::ivec3 local) -> std::size_t {
+        return (local.z * block_size + local.y) * block_size + local.x;
+    }
+    auto get_slot_i(uint64_t key) const -> std::size_t {
+        return ((key * 0x9e3779b97f4a7c15ull) >> 32) & _slot_mask;
+    }
+    // claim a slot for the key unless present, returns the number of blocks so far
+    auto insert(uint64_t key, std::atomic<uint32_t>& block_n) -> uint32_t {
+        for (std::size_t i = get_slot_i(key);; i = (i + 1) & _slot_mask) {
+            std::atomic_ref<uint64_t> slot_key(_slots[i].key);
+            uint64_t current = slot_key.load(std::memory_order_relaxed);
+            if (current == key) return 0;
+            if (current != empty_key) continue;
+            if (slot_key.compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+                uint32_t block = block_n++;
+                _slots[i].block = block;
+                return block + 1;
+            }
+            if (current == key) return 0;
+        }
+    }
+    auto find(uint64_t key) const -> const Slot* {
+        for (std::size_t i = get_slot_i(key);; i = (i + 1) & _slot_mask) {
+            if (_slots[i].key == key) return &_slots[i];
+            if (_slots[i].key == empty_key) return nullptr;
+        }
+    }
+    // lattice voxels of the positions and the fractions within them
+    void get_fractions(std::span<const glm::vec3> positions, std::array<glm::ivec3, lanes>& voxels, std::array<std::array<float, lanes>, 3>& fractions) const {
+        std::array<std::array<float, lanes>, 3> coords;
+        for (std::size_t l = 0; l < lanes; l++) {
+            glm::vec3 position = l < positions.size() ? positions[l] : _origin;
+            for (int a = 0; a < 3; a++) coords[a][l] = position[a];
+        }
+        std::array<std::array<int32_t, lanes>, 3> floors;
+#if defined(__AVX2__)
+        __m256 scale = _mm256_set1_ps(1.0f / _voxelsize);
+        for (int a = 0; a < 3; a++) {
+            __m256 p = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(coords[a].data()), _mm256_set1_ps(_origin[a])), scale);
+            __m256 p_floor = _mm256_floor_ps(p);
+            _mm256_storeu_ps(fractions[a].data(), _mm256_sub_ps(p, p_floor));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(floors[a].data()), _mm256_cvttps_epi32(p_floor));
+        }
+#else
+        for (int a = 0; a < 3; a++) {
+            for (std::size_t l = 0; l < lanes; l++) {
+                float p = (coords[a][l] - _origin[a]) / _voxelsize;
+                float p_floor = std::floor(p);
+                fractions[a][l] = p - p_floor;
+                floors[a][l] = (int32_t)p_floor;
+            }
+        }
+#endif
+        for (std::size_t l = 0; l < lanes; l++) voxels[l] = { floors[0][l], floors[1][l], floors[2][l] };
+    }
+    // distances at the 8 corners of the voxel, with a single lookup when they share a block
+    void get_corners(glm::ivec3 voxel, std::array<std::array<float, lanes>, 8>& corners, std::size_t l) const {
+        glm::ivec3 local = voxel & block_mask;
+        if (glm::all(glm::lessThan(local, glm::ivec3(block_mask))) && is_valid(voxel)) {
+            const Slot* slot_p = find(get_key(voxel >> block_bits));
+            for (int c = 0; c < 8; c++) {
+                glm::ivec3 offset = { c & 1, c >> 1 & 1, c >> 2 & 1 };
+                corners[c][l] = slot_p != nullptr ? _blocks[slot_p->block][get_local(local + offset)] : std::numeric_limits<float>::quiet_NaN();
+            }
+            return;
+        }
+        for (int c = 0; c < 8; c++) corners[c][l] = find(voxel + glm::ivec3(c & 1, c >> 1 & 1, c >> 2 & 1));
+    }
+    // trilinear interpolation and its partial derivatives, corner c offset by (c & 1, c >> 1 & 1, c >> 2 & 1)
+    static void blend(const std::array<std::array<float, lanes>, 8>& corners, const std::array<std::array<float, lanes>, 3>& fractions,
+        std::span<float> distances, std::span<glm::vec3> gradients)
+    {
+        std::array<float, lanes> d, gx, gy, gz;
+#if defined(__AVX2__)
+        std::array<__m256, 8> c;
+        for (int i = 0; i < 8; i++) c[i] = _mm256_loadu_ps(corners[i].data());
+        __m256 fx = _mm256_loadu_ps(fractions[0].data());
+        __m256 fy = _mm256_loadu_ps(fractions[1].data());
+        __m256 fz = _mm256_loadu_ps(fractions[2].data());
+        auto lerp = [](__m256 a, __m256 b, __m256 t) { return _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(b, a), t), a); };
+        // along x, then the x differences for the gradient
+        std::array<__m256, 4> x, dx;
+        for (int i = 0; i < 4; i++) {
+            x[i] = lerp(c[i * 2], c[i * 2 + 1], fx);
+            dx[i] = _mm256_sub_ps(c[i * 2 + 1], c[i * 2]);
+        }
+        __m256 y0 = lerp(x[0], x[1], fy), y1 = lerp(x[2], x[3], fy);
+        _mm256_storeu_ps(d.data(), lerp(y0, y1, fz));
+        _mm256_storeu_ps(gx.data(), lerp(lerp(dx[0], dx[1], fy), lerp(dx[2], dx[3], fy), fz));
+        _mm256_storeu_ps(gy.data(), lerp(_mm256_sub_ps(x[1], x[0]), _mm256_sub_ps(x[3], x[2]), fz));
+        _mm256_storeu_ps(gz.data(), _mm256_sub_ps(y1, y0));
+#else
+        auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+        for (std::size_t l = 0; l < lanes; l++) {
+            float fx = fractions[0][l], fy = fractions[1][l], fz = fractions[2][l];
+            std::array<float, 4> x, dx;
+            for (int i = 0; i < 4; i++) {
+                x[i] = lerp(corners[i * 2][l], corners[i * 2 + 1][l], fx);
+                dx[i] = corners[i * 2 + 1][l] - corners[i * 2][l];
+            }
+            float y0 = lerp(x[0], x[1], fy), y1 = lerp(x[2], x[3], fy);
+            d[l] = lerp(y0, y1, fz);
+            gx[l] = lerp(lerp(dx[0], dx[1], fy), lerp(dx[2], dx[3], fy), fz);
+            gy[l] = lerp(x[1] - x[0], x[3] - x[2], fz);
+            gz[l] = y1 - y0;
+        }
+#endif
+        for (std::size_t l = 0; l < distances.size(); l++) {
+            distances[l] = d[l];
+            gradients[l] = { gx[l], gy[l], gz[l] };
+        }
+    }
+
+    std::vector<Slot> _slots;
+    std::size_t _slot_mask = 0;
+    std::vector<Block> _blocks;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <optional>
+//
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <glm/glm.hpp>
+#include "core/image.hpp"
+
+// signed distances of the grid on a plane, sampled from the brick map by extra/slice.comp
+// and drawn as a textured quad, only resampled when the plane moves
+struct Slice {
+    // plane through the grid bounds
+    struct Settings {
+        int axis = 2; // normal along x, y or z, or 3 for a free orientation
+        float offset = 0.5f; // along the normal, relative to the bounds
+        float yaw = 0.0f; // free orientation in degrees
+        float pitch = 0.0f;
+        auto operator==(const Settings& other) const -> bool = default;
+    };
+
+    auto init(vk::Device device, vma::Allocator vmalloc) -> bool {
+        _image.init({
+            .device = device, .vmalloc = vmalloc,
+            .format = vk::Format::eR8G8B8A8Unorm,
+            .extent { resolution, resolution, 1 },
+            .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+        });
+        _settings_applied.reset();
+        return true;
+    }
+    void destroy(vk::Device device, vma::Allocator vmalloc) {
+        if (!_image._image) return;
+        _image.destroy(device, vmalloc);
+        _image._image = nullptr;
+    }
+    void draw(vk::CommandBuffer cmd) {
+        cmd.draw(6, 1, 0, 0);
+    }
+    // corner and edge vectors of the plane, covering the bounds
+    void set_plane(const Settings& settings, glm::vec3 bounds_min, glm::vec3 bounds_max) {
+        glm::vec3 extent = bounds_max - bounds_min;
+        if (settings.axis < 3) {
+            int a = settings.axis, b = (a + 1) % 3, c = (a + 2) % 3;
+            _corner = bounds_min;
+            _corner[a] += settings.offset * extent[a];
+            _u = glm::vec3(0);
+            _v = glm::vec3(0);
+            _u[b] = extent[b];
+            _v[c] = extent[c];
+            return;
+        }
+        // square spanning the bounding sphere, centered on the normal through the bounds center
+        float yaw = glm::radians(settings.yaw);
+        float pitch = glm::radians(settings.pitch);
+        glm::vec3 normal = { std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw) };
+        glm::vec3 up = std::abs(normal.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+        float diagonal = glm::length(extent);
+        _u = glm::normalize(glm::cross(up, normal)) * diagonal;
+        _v = glm::normalize(glm::cross(normal, _u)) * diagonal;
+        glm::vec3 center = (bounds_min + bounds_max) * 0.5f + normal * (settings.offset - 0.5f) * diagonal;
+        _corner = center - (_u + _v) * 0.5f;
+    }
+
+    static constexpr uint32_t resolution = 1024; // texels along each edge
+    Image _image; // colored distances, transparent outside of the brick map
+    glm::vec3 _corner = glm::vec3(0);
+    glm::vec3 _u = glm::vec3(0);
+    glm::vec3 _v = glm::vec3(0);
+    std::optional<Settings> _settings_applied; // of the current image
+    double _slice_ms = 0.0; // of the last resample, as read back by the renderer
+};
@@ -0,0 +1,173 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "components/mesh/vertices.hpp"
+#include "components/mesh/indices.hpp"
+#include "components/mesh/meshlets.hpp"
+#include "core/buffer.hpp"
+
+// range of a ChunkedMesh, compact chunks use 16 bit indices
+struct IndexChunk {
+    uint32_t index_beg = 0; // within the index buffer of matching width
+    uint32_t index_n = 0;
+    int32_t vertex_offset = 0;
+    bool compact = false;
+    float error = 0.0f; // distance to the full resolution surface
+};
+
+// mesh drawn in chunks, each chunk uses 16 bit indices relative to its vertex offset when its vertices span less than 65536
+// chunks may come in several detail levels (level major), which are selected per chunk before drawing
+// with meshlets, culling and level selection can instead happen on the gpu, drawing the compacted indirect commands
+template<typename Vertex>
+struct ChunkedMesh {
+    typedef IndexChunk Chunk;
+    // allocate only, contents are streamed in afterwards
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::size_t vertex_n, std::vector<Chunk>&& chunks, std::size_t level_n = 1) {
+        _chunks = std::move(chunks);
+        _level_n = level_n;
+        _levels.assign(_chunks.size() / level_n, 0);
+        std::size_t compact_n = 0;
+        std::size_t wide_n = 0;
+        for (auto& chunk: _chunks) {
+            if (chunk.compact) compact_n += chunk.index_n;
+            else wide_n += chunk.index_n;
+        }
+        _vertices.init(vmalloc, queues, vertex_n);
+        if (compact_n > 0) _indices_compact.init(vmalloc, queues, compact_n);
+        if (wide_n > 0) _indices_wide.init(vmalloc, queues, wide_n);
+    }
+    // allocate meshlet bounds (streamed in afterwards) and indirect draws, compact draws come first, then wide ones
+    void init_meshlets(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::size_t meshlet_n) {
+        _meshlet_n = (uint32_t)meshlet_n;
+        vma::AllocationCreateInfo info_allocation {
+            .usage = vma::MemoryUsage::eAutoPreferDevice,
+            .requiredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal,
+        };
+        _meshlets.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = meshlet_n * sizeof(Meshlet),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            info_allocation);
+        _draws.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = 2 * meshlet_n * sizeof(vk::DrawIndexedIndirectCommand),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            info_allocation);
+        _draw_counts.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = 2 * sizeof(uint32_t),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            info_allocation);
+    }
+    void destroy(vma::Allocator vmalloc) {
+        _vertices.destroy(vmalloc);
+        if (_indices_compact._index_n > 0) _indices_compact.destroy(vmalloc);
+        if (_indices_wide._index_n > 0) _indices_wide.destroy(vmalloc);
+        if (_meshlet_n > 0) {
+            _meshlets.destroy(vmalloc);
+            _draws.destroy(vmalloc);
+            _draw_counts.destroy(vmalloc);
+            _meshlet_n = 0;
+        }
+        _chunks.clear();
+        _levels.clear();
+        _spheres.clear();
+        _level_n = 1;
+    }
+    // coarsest level per chunk whose error stays below one unit after scaling by error_scale / distance
+    void select_levels(glm::vec3 eye, float error_scale) {
+        if (_spheres.size() != _levels.size()) return;
+        std::size_t base_n = _levels.size();
+        for (std::size_t c = 0; c < base_n; c++) {
+            glm::vec3 center { _spheres[c].x, _spheres[c].y, _spheres[c].z };
+            float distance = std::max(glm::length(eye - center) - _spheres[c].w, 0.0f);
+            uint8_t level = 0;
+            while (level + 1u < _level_n && _chunks[(level + 1) * base_n + c].error * error_scale <= distance) level++;
+            _levels[c] = level;
+        }
+    }
+    void reset_levels() {
+        std::fill(_levels.begin(), _levels.end(), 0);
+    }
+    // indices drawn with the current level selection
+    auto get_drawn_index_count() const -> std::size_t {
+        std::size_t index_n = 0;
+        for (std::size_t c = 0; c < _levels.size(); c++) index_n += get_chunk(c).index_n;
+        return index_n;
+    }
+    void draw(vk::CommandBuffer cmd) {
+        if (_chunks.size() == 0) return;
+        cmd.bindVertexBuffers(0, _vertices._buffer, { 0 });
+        if (_indirect && _meshlet_n > 0) {
+            draw_indirect(cmd);
+            return;
+        }
+        // one index buffer bind per width
+        if (_indices_compact._index_n > 0) {
+            cmd.bindIndexBuffer(_indices_compact._buffer, 0, _indices_compact.get_type());
+            for (std::size_t c = 0; c < _levels.size(); c++) {
+                const Chunk& chunk = get_chunk(c);
+                if (chunk.compact) cmd.drawIndexed(chunk.index_n, 1, chunk.index_beg, chunk.vertex_offset, 0);
+            }
+        }
+        if (_indices_wide._index_n > 0) {
+            cmd.bindIndexBuffer(_indices_wide._buffer, 0, _indices_wide.get_type());
+            for (std::size_t c = 0; c < _levels.size(); c++) {
+                const Chunk& chunk = get_chunk(c);
+                if (!chunk.compact) cmd.drawIndexed(chunk.index_n, 1, chunk.index_beg, chunk.vertex_offset, 0);
+            }
+        }
+    }
+    // draws written by the meshlet cull pass
+    void draw_indirect(vk::CommandBuffer cmd) {
+        vk::DeviceSize stride = sizeof(vk::DrawIndexedIndirectCommand);
+        if (_indices_compact._index_n > 0) {
+            cmd.bindIndexBuffer(_indices_compact._buffer, 0, _indices_compact.get_type());
+            cmd.drawIndexedIndirectCount(_draws._data, 0, _draw_counts._data, 0, _meshlet_n, stride);
+        }
+        if (_indices_wide._index_n > 0) {
+            cmd.bindIndexBuffer(_indices_wide._buffer, 0, _indices_wide.get_type());
+            cmd.drawIndexedIndirectCount(_draws._data, _meshlet_n * stride, _draw_counts._data, sizeof(uint32_t), _meshlet_n, stride);
+        }
+    }
+    // device memory held by vertex, index and meshlet buffers
+    auto get_memory_size() const -> std::size_t {
+        return (std::size_t)_vertices._vertex_n * sizeof(Vertex)
+            + (std::size_t)_indices_compact._index_n * sizeof(uint16_t)
+            + (std::size_t)_indices_wide._index_n * sizeof(uint32_t)
+            + (std::size_t)_meshlet_n * (sizeof(Meshlet) + 2 * sizeof(vk::DrawIndexedIndirectCommand));
+    }
+
+    // chunk c at its selected level
+    auto get_chunk(std::size_t c) const -> const Chunk& {
+        return _chunks[_levels[c] * _levels.size() + c];
+    }
+
+    Vertices<Vertex> _vertices;
+    Indices<uint16_t> _indices_compact;
+    Indices<uint32_t> _indices_wide;
+    std::vector<Chunk> _chunks;
+    std::vector<uint8_t> _levels; // selected level per chunk
+    std::vector<glm::vec4> _spheres; // bounding sphere per chunk, required for level selection
+    std::size_t _level_n = 1;
+    // gpu culled meshlets
+    DeviceBuffer<Meshlet> _meshlets;
+    DeviceBuffer<vk::DrawIndexedIndirectCommand> _draws;
+    DeviceBuffer<uint32_t> _draw_counts; // compact and wide
+    uint32_t _meshlet_n = 0;
+    bool _indirect = false; // draw the culled meshlets instead of the selected chunk levels
+};
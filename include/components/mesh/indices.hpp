@@ -7,7 +7,7 @@
 
 template<typename Index>
 struct Indices {
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<Index> index_data) {
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<const Index> index_data) {
         // create index buffer
 		vk::BufferCreateInfo info_buffer {
 			.size = sizeof(Index) * index_data.size(),	
@@ -47,6 +47,35 @@ struct Indices {
         vmalloc.unmapMemory(_allocation);
         _index_n = (uint32_t)index_data.size();
     }
+    // allocate without uploading, to be filled through a StagingStream
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::size_t index_n) {
+		vk::BufferCreateInfo info_buffer {
+			.size = sizeof(Index) * index_n,
+			.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			.sharingMode = vk::SharingMode::eExclusive,
+			.queueFamilyIndexCount = queues.size(),
+			.pQueueFamilyIndices = queues.data(),
+		};
+		vma::AllocationCreateInfo info_allocation {
+			.flags = 
+				vma::AllocationCreateFlagBits::eHostAccessSequentialWrite |
+				vma::AllocationCreateFlagBits::eHostAccessAllowTransferInstead |
+				vma::AllocationCreateFlagBits::eMapped |
+				vma::AllocationCreateFlagBits::eDedicatedMemory,
+			.usage = 
+                vma::MemoryUsage::eAutoPreferDevice,
+			.requiredFlags = 
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+			.preferredFlags = 
+				vk::MemoryPropertyFlagBits::eHostCoherent |
+				vk::MemoryPropertyFlagBits::eHostVisible // ReBAR
+		};
+		vma::AllocationInfo info;
+		std::tie(_buffer, _allocation) = vmalloc.createBuffer(info_buffer, info_allocation, &info);
+		// only mapped when host visible, staging is used otherwise
+		_mapped_p = info.pMappedData;
+        _index_n = (uint32_t)index_n;
+    }
     void destroy(vma::Allocator vmalloc) {
 		vmalloc.destroyBuffer(_buffer, _allocation);
     }
@@ -56,5 +85,6 @@ struct Indices {
 
     uint32_t _index_n = 0;
     vk::Buffer _buffer;
+	void* _mapped_p = nullptr;
 	vma::Allocation _allocation;
 };
\ No newline at end of file
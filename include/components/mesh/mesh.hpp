@@ -4,17 +4,30 @@
 
 template<typename Vertex, typename Index = uint16_t> 
 struct Mesh {
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<Vertex> vertices, std::span<Index> indices) {
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<const Vertex> vertices, std::span<const Index> indices) {
         _vertices.init(vmalloc, queues, vertices);
         _indices.init(vmalloc, queues, indices);
     }
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<Vertex> vertices) {
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<const Vertex> vertices) {
         _vertices.init(vmalloc, queues, vertices);
     }
+    // allocate only, contents are streamed in afterwards
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::size_t vertex_n, std::size_t index_n) {
+        _vertices.init(vmalloc, queues, vertex_n);
+        _indices.init(vmalloc, queues, index_n);
+    }
     void destroy(vma::Allocator vmalloc) {
         _vertices.destroy(vmalloc);
         if (_indices._index_n > 0) _indices.destroy(vmalloc);
     }
+    void draw(vk::CommandBuffer cmd) {
+        cmd.bindVertexBuffers(0, _vertices._buffer, { 0 });
+        if (_indices._index_n > 0) {
+            cmd.bindIndexBuffer(_indices._buffer, 0, _indices.get_type());
+            cmd.drawIndexed(_indices._index_n, 1, 0, 0, 0);
+        }
+        else cmd.draw(_vertices._vertex_n, 1, 0, 0);
+    }
 
     Vertices<Vertex> _vertices;
     Indices<Index> _indices;
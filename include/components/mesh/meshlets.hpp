@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+// cluster of consecutive triangles within a chunk, laid out as in defaults/cull.comp (std430)
+struct Meshlet {
+    glm::vec4 sphere = { 0, 0, 0, 0 }; // center and radius
+    glm::vec4 cone = { 0, 0, 1, 2 }; // normal axis and sine of the normal spread, never backfacing when > 1
+    glm::vec4 chunk_sphere = { 0, 0, 0, 0 }; // bounds of the chunk, for level selection
+    float error = 0.0f; // of the chunk level
+    float error_next = std::numeric_limits<float>::max(); // of the next coarser chunk level
+    uint32_t index_beg = 0; // within the index buffer of matching width
+    uint32_t index_n = 0;
+    int32_t vertex_offset = 0;
+    uint32_t compact = 0;
+    uint32_t level = 0;
+    uint32_t _pad = 0;
+};
+static_assert(sizeof(Meshlet) == 80);
+
+namespace meshlets {
+    static constexpr std::size_t triangle_n = 128; // triangles per meshlet
+
+    // split indices into runs of triangle_n triangles with bounding sphere and normal cone
+    // index_beg is relative to indices, all other chunk dependent members are left to the caller
+    inline void build(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, std::vector<Meshlet>& dst) {
+        std::size_t tri_n = indices.size() / 3;
+        for (std::size_t beg = 0; beg < tri_n; beg += triangle_n) {
+            std::size_t end = std::min(tri_n, beg + triangle_n);
+            glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+            glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+            glm::vec3 axis { 0, 0, 0 };
+            for (std::size_t t = beg; t < end; t++) {
+                glm::vec3 a = positions[indices[t * 3 + 0]];
+                glm::vec3 b = positions[indices[t * 3 + 1]];
+                glm::vec3 c = positions[indices[t * 3 + 2]];
+                min = glm::min(min, glm::min(a, glm::min(b, c)));
+                max = glm::max(max, glm::max(a, glm::max(b, c)));
+                glm::vec3 n = glm::cross(b - a, c - a);
+                float length = glm::length(n);
+                if (length > 0.0f) axis = axis + n / length;
+            }
+            glm::vec3 center = (min + max) * 0.5f;
+            float radius = 0.0f;
+            for (std::size_t i = beg * 3; i < end * 3; i++) {
+                radius = std::max(radius, glm::length(positions[indices[i]] - center));
+            }
+
+            // widest angle between the average normal and any triangle normal
+            Meshlet meshlet {
+                .sphere = { center.x, center.y, center.z, radius },
+                .index_beg = (uint32_t)(beg * 3),
+                .index_n = (uint32_t)((end - beg) * 3),
+            };
+            float axis_length = glm::length(axis);
+            if (axis_length > 0.0f) {
+                axis = axis / axis_length;
+                float spread_cos = 1.0f;
+                for (std::size_t t = beg; t < end; t++) {
+                    glm::vec3 a = positions[indices[t * 3 + 0]];
+                    glm::vec3 n = glm::cross(positions[indices[t * 3 + 1]] - a, positions[indices[t * 3 + 2]] - a);
+                    float length = glm::length(n);
+                    if (length > 0.0f) spread_cos = std::min(spread_cos, glm::dot(axis, n / length));
+                }
+                // cones of 90 degrees or more can always be seen from the front
+                if (spread_cos > 0.0f) meshlet.cone = { axis.x, axis.y, axis.z, std::sqrt(1.0f - spread_cos * spread_cos) };
+            }
+            dst.push_back(meshlet);
+        }
+    }
+}
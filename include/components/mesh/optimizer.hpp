@@ -0,0 +1,167 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+// triangle and vertex order optimizations for indexed triangle lists
+// following Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+namespace optimizer {
+    static constexpr std::size_t cache_size = 16; // simulated post-transform FIFO entries
+    static constexpr std::size_t cluster_min = 128; // triangles before a dead end may start a new cluster
+
+    // vertex shader invocations of indices on a FIFO post-transform cache
+    inline auto count_transforms(std::span<const uint32_t> indices) -> std::size_t {
+        std::array<uint32_t, cache_size> fifo;
+        fifo.fill(std::numeric_limits<uint32_t>::max());
+        std::size_t head = 0;
+        std::size_t misses = 0;
+        for (uint32_t index: indices) {
+            if (std::find(fifo.cbegin(), fifo.cend(), index) != fifo.cend()) continue;
+            fifo[head] = index;
+            head = (head + 1) % cache_size;
+            misses++;
+        }
+        return misses;
+    }
+
+    // reorder triangles for vertex cache locality (tipsify), cluster_starts receives the first triangle of each cluster
+    inline void tipsify(std::span<uint32_t> indices, std::vector<uint32_t>& cluster_starts) {
+        cluster_starts.clear();
+        std::size_t tri_n = indices.size() / 3;
+        if (tri_n == 0) return;
+
+        // compact vertex ids local to these triangles
+        std::vector<uint32_t> verts(indices.begin(), indices.end());
+        std::sort(verts.begin(), verts.end());
+        verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+        std::size_t vert_n = verts.size();
+        std::vector<uint32_t> local(indices.size());
+        for (std::size_t k = 0; k < indices.size(); k++) {
+            local[k] = (uint32_t)(std::lower_bound(verts.cbegin(), verts.cend(), indices[k]) - verts.cbegin());
+        }
+
+        // vertex to triangle adjacency
+        std::vector<uint32_t> live(vert_n, 0);
+        for (uint32_t v: local) live[v]++;
+        std::vector<uint32_t> adj_offsets(vert_n + 1, 0);
+        for (std::size_t v = 0; v < vert_n; v++) adj_offsets[v + 1] = adj_offsets[v] + live[v];
+        std::vector<uint32_t> adj(local.size());
+        std::vector<uint32_t> adj_fill(adj_offsets.cbegin(), adj_offsets.cend() - 1);
+        for (std::size_t k = 0; k < local.size(); k++) adj[adj_fill[local[k]]++] = (uint32_t)(k / 3);
+
+        std::vector<uint32_t> cache_time(vert_n, 0);
+        std::vector<uint8_t> emitted(tri_n, 0);
+        std::vector<uint32_t> dead_end;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        uint32_t time = cache_size + 1;
+        std::size_t cursor = 0;
+        std::size_t cluster_beg = 0;
+        cluster_starts.push_back(0);
+        auto skip_dead_end = [&]() -> int64_t {
+            while (dead_end.size() > 0) {
+                uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0) return v;
+            }
+            for (; cursor < vert_n; cursor++) {
+                if (live[cursor] > 0) return (int64_t)cursor;
+            }
+            return -1;
+        };
+
+        int64_t fanning = 0;
+        while (fanning >= 0) {
+            // emit all remaining triangles around the fanning vertex
+            candidates.clear();
+            for (uint32_t a = adj_offsets[fanning]; a < adj_offsets[fanning + 1]; a++) {
+                uint32_t t = adj[a];
+                if (emitted[t]) continue;
+                for (std::size_t c = 0; c < 3; c++) {
+                    uint32_t v = local[t * 3 + c];
+                    output.push_back(v);
+                    dead_end.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cache_time[v] > cache_size) cache_time[v] = time++;
+                }
+                emitted[t] = 1;
+            }
+            // prefer candidates that are still going to be in cache after their remaining triangles
+            int64_t next = -1;
+            int64_t best = -1;
+            for (uint32_t v: candidates) {
+                if (live[v] == 0) continue;
+                int64_t priority = 0;
+                if (time - cache_time[v] + 2 * live[v] <= cache_size) priority = time - cache_time[v];
+                if (priority > best) {
+                    best = priority;
+                    next = v;
+                }
+            }
+            if (next < 0) {
+                // dead end, cache is effectively restarted
+                next = skip_dead_end();
+                std::size_t tri_emitted = output.size() / 3;
+                if (next >= 0 && tri_emitted - cluster_beg >= cluster_min) {
+                    cluster_starts.push_back((uint32_t)tri_emitted);
+                    cluster_beg = tri_emitted;
+                }
+            }
+            fanning = next;
+        }
+        for (std::size_t k = 0; k < output.size(); k++) indices[k] = verts[output[k]];
+    }
+
+    // draw clusters facing away from the center first, so they occlude more of the clusters behind them
+    inline void sort_clusters(std::span<uint32_t> indices, const std::vector<uint32_t>& cluster_starts, std::span<const glm::vec3> positions, glm::vec3 center) {
+        std::size_t tri_n = indices.size() / 3;
+        std::size_t cluster_n = cluster_starts.size();
+        if (cluster_n <= 1) return;
+        std::vector<std::pair<float, uint32_t>> keys(cluster_n);
+        for (std::size_t c = 0; c < cluster_n; c++) {
+            std::size_t end = c + 1 < cluster_n ? cluster_starts[c + 1] : tri_n;
+            glm::vec3 centroid { 0, 0, 0 };
+            glm::vec3 normal { 0, 0, 0 };
+            for (std::size_t t = cluster_starts[c]; t < end; t++) {
+                glm::vec3 a = positions[indices[t * 3 + 0]];
+                glm::vec3 b = positions[indices[t * 3 + 1]];
+                glm::vec3 d = positions[indices[t * 3 + 2]];
+                centroid = centroid + (a + b + d);
+                normal = normal + glm::cross(b - a, d - a); // area weighted
+            }
+            centroid = centroid / (3.0f * (float)(end - cluster_starts[c]));
+            float length = glm::length(normal);
+            float key = length > 0.0f ? glm::dot(centroid - center, normal) / length : 0.0f;
+            keys[c] = { key, (uint32_t)c };
+        }
+        std::stable_sort(keys.begin(), keys.end(), [](auto& a, auto& b) { return a.first > b.first; });
+        std::vector<uint32_t> sorted;
+        sorted.reserve(indices.size());
+        for (auto& [_, c]: keys) {
+            std::size_t end = c + 1 < cluster_n ? cluster_starts[c + 1] : tri_n;
+            sorted.insert(sorted.end(), indices.begin() + cluster_starts[c] * 3, indices.begin() + end * 3);
+        }
+        std::copy(sorted.cbegin(), sorted.cend(), indices.begin());
+    }
+
+    // vertex ids in order of first use, unreferenced vertices are moved to the end
+    inline auto get_fetch_remap(std::span<const uint32_t> indices, std::size_t vertex_n) -> std::vector<uint32_t> {
+        static constexpr uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(vertex_n, unused);
+        uint32_t next = 0;
+        for (uint32_t index: indices) {
+            if (remap[index] == unused) remap[index] = next++;
+        }
+        for (auto& id: remap) {
+            if (id == unused) id = next++;
+        }
+        return remap;
+    }
+}
@@ -0,0 +1,224 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+// quadric error edge collapse following Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics"
+// vertices only collapse onto existing vertices, so simplified indices keep referencing the original vertex buffer
+namespace simplifier {
+    // sum of squared distances to a set of planes
+    struct Quadric {
+        void add_plane(glm::vec3 n, float d) {
+            double a = n.x, b = n.y, c = n.z, e = d;
+            _q[0] += a * a; _q[1] += a * b; _q[2] += a * c; _q[3] += a * e;
+            _q[4] += b * b; _q[5] += b * c; _q[6] += b * e;
+            _q[7] += c * c; _q[8] += c * e;
+            _q[9] += e * e;
+        }
+        void operator+=(const Quadric& other) {
+            for (std::size_t i = 0; i < _q.size(); i++) _q[i] += other._q[i];
+        }
+        auto evaluate(glm::vec3 p) const -> double {
+            double x = p.x, y = p.y, z = p.z;
+            double error =
+                _q[0] * x * x + 2 * _q[1] * x * y + 2 * _q[2] * x * z + 2 * _q[3] * x +
+                _q[4] * y * y + 2 * _q[5] * y * z + 2 * _q[6] * y +
+                _q[7] * z * z + 2 * _q[8] * z +
+                _q[9];
+            return std::max(error, 0.0);
+        }
+        std::array<double, 10> _q = {};
+    };
+
+    // collapse edges until at most target_n indices remain or no valid collapse is left
+    // locked vertices (by global id) and vertices on open edges never move, so borders to other index ranges stay intact
+    // returns the distance error of the most expensive collapse
+    inline auto simplify(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, std::span<const uint8_t> locked, std::size_t target_n, std::vector<uint32_t>& dst) -> float {
+        dst.clear();
+        std::size_t tri_n = indices.size() / 3;
+        if (tri_n == 0) return 0.0f;
+
+        // compact vertex ids local to these triangles
+        std::vector<uint32_t> verts(indices.begin(), indices.end());
+        std::sort(verts.begin(), verts.end());
+        verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+        std::size_t vert_n = verts.size();
+        std::vector<uint32_t> tris(indices.size());
+        for (std::size_t k = 0; k < indices.size(); k++) {
+            tris[k] = (uint32_t)(std::lower_bound(verts.cbegin(), verts.cend(), indices[k]) - verts.cbegin());
+        }
+        std::vector<glm::vec3> pos(vert_n);
+        std::vector<uint8_t> fixed(vert_n);
+        for (std::size_t v = 0; v < vert_n; v++) {
+            pos[v] = positions[verts[v]];
+            fixed[v] = locked[verts[v]];
+        }
+
+        // plane quadrics, vertex to triangle adjacency and the initial orientation of each triangle
+        std::vector<Quadric> quadrics(vert_n);
+        std::vector<glm::vec3> tri_normals(tri_n, glm::vec3(0.0f));
+        std::vector<std::vector<uint32_t>> vert_tris(vert_n);
+        std::vector<uint8_t> alive(tri_n, 1);
+        std::size_t alive_n = tri_n;
+        for (std::size_t t = 0; t < tri_n; t++) {
+            uint32_t* tri = &tris[t * 3];
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]) {
+                alive[t] = 0;
+                alive_n--;
+                continue;
+            }
+            glm::vec3 n = glm::cross(pos[tri[1]] - pos[tri[0]], pos[tri[2]] - pos[tri[0]]);
+            float length = glm::length(n);
+            if (length > 0.0f) tri_normals[t] = n / length;
+            for (std::size_t c = 0; c < 3; c++) {
+                if (length > 0.0f) quadrics[tri[c]].add_plane(n / length, -glm::dot(n / length, pos[tri[0]]));
+                vert_tris[tri[c]].push_back((uint32_t)t);
+            }
+        }
+        // edges used by a single triangle are borders
+        std::vector<uint64_t> edges;
+        edges.reserve(alive_n * 3);
+        for (std::size_t t = 0; t < tri_n; t++) {
+            if (!alive[t]) continue;
+            for (std::size_t c = 0; c < 3; c++) {
+                uint64_t a = tris[t * 3 + c];
+                uint64_t b = tris[t * 3 + (c + 1) % 3];
+                edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (std::size_t e = 0; e < edges.size();) {
+            std::size_t end = e + 1;
+            while (end < edges.size() && edges[end] == edges[e]) end++;
+            if (end - e == 1) {
+                fixed[edges[e] >> 32] = 1;
+                fixed[edges[e] & 0xffffffff] = 1;
+            }
+            e = end;
+        }
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        // cheapest direction of each edge, entries go stale when either vertex changes
+        struct Collapse {
+            double cost;
+            uint32_t from, to;
+            uint32_t version_from, version_to;
+            auto operator>(const Collapse& other) const -> bool {
+                return cost > other.cost;
+            }
+        };
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+        std::vector<uint32_t> versions(vert_n, 0);
+        std::vector<uint8_t> collapsed(vert_n, 0);
+        auto push_edge = [&](uint32_t a, uint32_t b) {
+            if (fixed[a] && fixed[b]) return;
+            Quadric q = quadrics[a];
+            q += quadrics[b];
+            double cost_ab = fixed[a] ? std::numeric_limits<double>::max() : q.evaluate(pos[b]);
+            double cost_ba = fixed[b] ? std::numeric_limits<double>::max() : q.evaluate(pos[a]);
+            if (cost_ab <= cost_ba) heap.push({ cost_ab, a, b, versions[a], versions[b] });
+            else heap.push({ cost_ba, b, a, versions[b], versions[a] });
+        };
+        for (uint64_t edge: edges) push_edge((uint32_t)(edge >> 32), (uint32_t)(edge & 0xffffffff));
+        edges = {};
+
+        // collapses must keep the surface manifold, must not flip or fold any triangle and must not leave slivers
+        // normals may turn by at most ~75 degrees per collapse and never against the triangle's original orientation
+        constexpr float normal_cos_min = 0.25f;
+        constexpr float sliver_ratio_min = 1e-2f; // twice the area over the squared longest edge
+        std::vector<uint32_t> neighbors_from, neighbors_to, common;
+        auto gather_neighbors = [&](uint32_t v, std::vector<uint32_t>& neighbors) {
+            neighbors.clear();
+            for (uint32_t t: vert_tris[v]) {
+                if (!alive[t]) continue;
+                for (std::size_t c = 0; c < 3; c++) {
+                    if (tris[t * 3 + c] != v) neighbors.push_back(tris[t * 3 + c]);
+                }
+            }
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        };
+        auto is_valid = [&](uint32_t from, uint32_t to) -> bool {
+            std::size_t shared_n = 0;
+            for (uint32_t t: vert_tris[from]) {
+                if (!alive[t]) continue;
+                const uint32_t* tri = &tris[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                    shared_n++;
+                    continue;
+                }
+                glm::vec3 p0 = pos[tri[0]], p1 = pos[tri[1]], p2 = pos[tri[2]];
+                glm::vec3 n_old = glm::cross(p1 - p0, p2 - p0);
+                if (tri[0] == from) p0 = pos[to];
+                if (tri[1] == from) p1 = pos[to];
+                if (tri[2] == from) p2 = pos[to];
+                glm::vec3 n_new = glm::cross(p1 - p0, p2 - p0);
+                float length_new = glm::length(n_new);
+                float edge_max = std::max({ glm::dot(p1 - p0, p1 - p0), glm::dot(p2 - p1, p2 - p1), glm::dot(p0 - p2, p0 - p2) });
+                if (length_new <= sliver_ratio_min * edge_max) return false;
+                glm::vec3 dir_new = n_new / length_new;
+                float length_old = glm::length(n_old);
+                if (length_old > 0.0f && glm::dot(n_old / length_old, dir_new) < normal_cos_min) return false;
+                if (glm::dot(tri_normals[t], dir_new) < normal_cos_min) return false;
+            }
+            if (shared_n == 0) return false;
+            // link condition, the only common neighbors are the opposite corners of the shared triangles
+            gather_neighbors(from, neighbors_from);
+            gather_neighbors(to, neighbors_to);
+            common.clear();
+            std::set_intersection(neighbors_from.cbegin(), neighbors_from.cend(), neighbors_to.cbegin(), neighbors_to.cend(), std::back_inserter(common));
+            return common.size() == shared_n;
+        };
+
+        double cost_max = 0.0;
+        while (alive_n * 3 > target_n && heap.size() > 0) {
+            Collapse collapse = heap.top();
+            heap.pop();
+            uint32_t from = collapse.from;
+            uint32_t to = collapse.to;
+            if (collapsed[from] || collapsed[to]) continue;
+            if (versions[from] != collapse.version_from || versions[to] != collapse.version_to) continue;
+            if (!is_valid(from, to)) continue;
+
+            // move triangles of from over to to, dropping the ones that degenerate
+            for (uint32_t t: vert_tris[from]) {
+                if (!alive[t]) continue;
+                uint32_t* tri = &tris[t * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                    alive[t] = 0;
+                    alive_n--;
+                    continue;
+                }
+                for (std::size_t c = 0; c < 3; c++) {
+                    if (tri[c] == from) tri[c] = to;
+                }
+                vert_tris[to].push_back(t);
+            }
+            vert_tris[from] = {};
+            std::erase_if(vert_tris[to], [&](uint32_t t) { return !alive[t]; });
+            quadrics[to] += quadrics[from];
+            collapsed[from] = 1;
+            versions[to]++;
+            cost_max = std::max(cost_max, collapse.cost);
+
+            // requeue edges around to with its new quadric
+            gather_neighbors(to, neighbors_to);
+            for (uint32_t w: neighbors_to) push_edge(to, w);
+        }
+
+        dst.reserve(alive_n * 3);
+        for (std::size_t t = 0; t < tri_n; t++) {
+            if (!alive[t]) continue;
+            for (std::size_t c = 0; c < 3; c++) dst.push_back(verts[tris[t * 3 + c]]);
+        }
+        return (float)std::sqrt(cost_max);
+    }
+}
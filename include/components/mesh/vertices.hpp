@@ -5,7 +5,7 @@
 
 template<typename Vertex>
 struct Vertices {
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<Vertex> vertex_data) {
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::span<const Vertex> vertex_data) {
         // create vertex buffer
 		vk::BufferCreateInfo info_buffer {
 			.size = sizeof(Vertex) * vertex_data.size(),	
@@ -45,11 +45,41 @@ struct Vertices {
         vmalloc.unmapMemory(_allocation);
         _vertex_n = (uint32_t)vertex_data.size();
     }
+    // allocate without uploading, to be filled through a StagingStream
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, std::size_t vertex_n) {
+		vk::BufferCreateInfo info_buffer {
+			.size = sizeof(Vertex) * vertex_n,
+			.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			.sharingMode = vk::SharingMode::eExclusive,
+			.queueFamilyIndexCount = queues.size(),
+			.pQueueFamilyIndices = queues.data(),
+		};
+		vma::AllocationCreateInfo info_allocation {
+			.flags = 
+				vma::AllocationCreateFlagBits::eHostAccessSequentialWrite |
+				vma::AllocationCreateFlagBits::eHostAccessAllowTransferInstead |
+				vma::AllocationCreateFlagBits::eMapped |
+				vma::AllocationCreateFlagBits::eDedicatedMemory,
+			.usage = 
+                vma::MemoryUsage::eAutoPreferDevice,
+			.requiredFlags = 
+				vk::MemoryPropertyFlagBits::eDeviceLocal,
+			.preferredFlags = 
+				vk::MemoryPropertyFlagBits::eHostCoherent |
+				vk::MemoryPropertyFlagBits::eHostVisible // ReBAR
+		};
+		vma::AllocationInfo info;
+		std::tie(_buffer, _allocation) = vmalloc.createBuffer(info_buffer, info_allocation, &info);
+		// only mapped when host visible, staging is used otherwise
+		_mapped_p = info.pMappedData;
+        _vertex_n = (uint32_t)vertex_n;
+    }
     void destroy(vma::Allocator vmalloc) {
 		vmalloc.destroyBuffer(_buffer, _allocation);
     }
 
     uint32_t _vertex_n = 0;
     vk::Buffer _buffer;
+	void* _mapped_p = nullptr;
 	vma::Allocation _allocation;
 };
\ No newline at end of file
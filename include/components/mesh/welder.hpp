@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/parallel.hpp"
+
+// merges vertices with bitwise equal positions, or with positions in the same epsilon sized cell
+// epsilon welds also merge across cell borders, into the first vertex of a neighbouring cell within epsilon
+// unique vertices keep the order of their first occurrence, so welded ids grow with source ids
+struct Welder {
+    void init(std::size_t vertex_n, float epsilon) {
+        _keys.assign(vertex_n, {});
+        _positions.assign(epsilon > 0.0f ? vertex_n : 0, glm::vec3(0.0f));
+        _remap.assign(vertex_n, 0);
+        _unique.assign(vertex_n, 0);
+        _epsilon = epsilon;
+        _unique_n = 0;
+    }
+    // set position of vertex i, safe to call concurrently for different i
+    void set(std::size_t i, glm::vec3 pos) {
+        Key& key = _keys[i];
+        if (_epsilon > 0.0f) {
+            _positions[i] = pos;
+            for (int k = 0; k < 3; k++) {
+                // symmetric and exactly representable, leaving room for the neighbouring cells
+                float cell = std::clamp(std::floor(pos[k] / _epsilon), -cell_max, cell_max);
+                key[k] = (uint32_t)(int32_t)cell;
+            }
+        }
+        else {
+            // +0.0 folds -0.0 into the same key
+            for (int k = 0; k < 3; k++) key[k] = std::bit_cast<uint32_t>(pos[k] + 0.0f);
+        }
+    }
+    // resolve duplicates once all positions are set
+    void weld() {
+        std::size_t vertex_n = _keys.size();
+        std::size_t table_n = std::bit_ceil(std::max<std::size_t>(vertex_n * 2, 16));
+        std::vector<std::atomic<uint32_t>> table(table_n);
+        std::size_t batch_size = 1 << 16;
+        std::size_t batches_n = (table_n + batch_size - 1) / batch_size;
+        parallel::for_each(batches_n, [&](std::size_t b) {
+            std::size_t end = std::min(table_n, (b + 1) * batch_size);
+            for (std::size_t s = b * batch_size; s < end; s++) table[s].store(empty, std::memory_order_relaxed);
+        });
+
+        // open addressing, each slot converges to the smallest vertex id of its key
+        batches_n = (vertex_n + batch_size - 1) / batch_size;
+        parallel::for_each(batches_n, [&](std::size_t b) {
+            std::size_t end = std::min(vertex_n, (b + 1) * batch_size);
+            for (std::size_t i = b * batch_size; i < end; i++) {
+                uint32_t id = (uint32_t)i;
+                std::size_t slot = hash(_keys[i]) & (table_n - 1);
+                while (true) {
+                    uint32_t cur = table[slot].load(std::memory_order_relaxed);
+                    if (cur == empty) {
+                        if (table[slot].compare_exchange_weak(cur, id, std::memory_order_relaxed)) break;
+                        if (cur == empty) continue;
+                    }
+                    if (_keys[cur] == _keys[i]) {
+                        while (id < cur && !table[slot].compare_exchange_weak(cur, id, std::memory_order_relaxed));
+                        break;
+                    }
+                    slot = (slot + 1) & (table_n - 1);
+                }
+            }
+        });
+        // look up representatives, which are never larger than the vertex itself
+        auto find = [&](const Key& key) -> uint32_t {
+            std::size_t slot = hash(key) & (table_n - 1);
+            while (true) {
+                uint32_t cur = table[slot].load(std::memory_order_relaxed);
+                if (cur == empty || _keys[cur] == key) return cur;
+                slot = (slot + 1) & (table_n - 1);
+            }
+        };
+        float epsilon_sq = _epsilon * _epsilon;
+        parallel::for_each(batches_n, [&](std::size_t b) {
+            std::size_t end = std::min(vertex_n, (b + 1) * batch_size);
+            for (std::size_t i = b * batch_size; i < end; i++) {
+                uint32_t rep = find(_keys[i]);
+                // positions within epsilon may fall into any of the 26 neighbouring cells, take their smallest close representative
+                for (int n = 0; _epsilon > 0.0f && n < 27; n++) {
+                    if (n == 13) continue;
+                    Key key = _keys[i];
+                    for (int k = 0; k < 3; k++) key[k] = (uint32_t)((int32_t)key[k] + (n / offsets[k]) % 3 - 1);
+                    uint32_t other = find(key);
+                    if (other == empty || other >= rep) continue;
+                    glm::vec3 diff = _positions[other] - _positions[i];
+                    if (glm::dot(diff, diff) <= epsilon_sq) rep = other;
+                }
+                _remap[i] = rep;
+            }
+        });
+        // number unique vertices in order, duplicates always follow their representative
+        uint32_t unique_n = 0;
+        for (std::size_t i = 0; i < vertex_n; i++) {
+            if (_remap[i] == i) {
+                _unique[i] = 1;
+                _remap[i] = unique_n++;
+            }
+            else _remap[i] = _remap[_remap[i]];
+        }
+        _unique_n = unique_n;
+        _keys = {};
+        _positions = {};
+    }
+
+    // welded id of source vertex i
+    auto remap(std::size_t i) const -> uint32_t {
+        return _remap[i];
+    }
+    // whether source vertex i is the first occurrence of its position
+    auto is_unique(std::size_t i) const -> bool {
+        return _unique[i] != 0;
+    }
+    auto get_unique_count() const -> std::size_t {
+        return _unique_n;
+    }
+
+private:
+    typedef std::array<uint32_t, 3> Key;
+    static constexpr uint32_t empty = std::numeric_limits<uint32_t>::max();
+    static constexpr float cell_max = (float)(1 << 30); // cell coordinate bound in either direction
+    static constexpr std::array<int, 3> offsets = { 1, 3, 9 }; // of each axis within the 3x3x3 neighbourhood
+    static auto hash(const Key& key) -> std::size_t {
+        uint64_t h = key[0];
+        h = h * 0x9E3779B97F4A7C15ull ^ key[1];
+        h = h * 0x9E3779B97F4A7C15ull ^ key[2];
+        h *= 0xFF51AFD7ED558CCDull;
+        return (std::size_t)(h ^ (h >> 32));
+    }
+
+    std::vector<Key> _keys;
+    std::vector<glm::vec3> _positions; // only kept for epsilon welds
+    std::vector<uint32_t> _remap;
+    std::vector<uint8_t> _unique;
+    std::size_t _unique_n = 0;
+    float _epsilon = 0.0f;
+};
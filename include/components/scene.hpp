@@ -1,45 +1,77 @@
 #pragma once
-// #include <random>
+#include <format>
 #include <fmt/format.h>
+#include <imgui.h>
+#include "core/queues.hpp"
+#include "core/loader.hpp"
+#include "core/ring_buffer.hpp"
+#include "core/trace.hpp"
 #include "components/transform/camera.hpp"
 #include "components/extra/grid.hpp"
 #include "components/extra/plymesh.hpp"
+#include "components/extra/isosurface.hpp"
+#include "components/extra/cell_filter.hpp"
+#include "components/extra/slice.hpp"
 
 struct Scene {
     struct SceneData {
         Grid _grid;
+        Isosurface _surface;
+        CellFilter _cell_filter;
+        Slice _slice;
         Plymesh _mesh_main;
-        Plymesh _mesh_main_grey;
         std::vector<Plymesh> _mesh_subs;
     };
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues) {
-        _camera.init(vmalloc, queues);
-        
-        _data._grid.init(vmalloc, queues, "data/hsfd23/hashgrid.grid");
-        _data._mesh_main.init(vmalloc, queues, "data/hsfd23/mesh.ply");
-        // _data._mesh_main_grey.init(vmalloc, queues, "data/hsfd23/mesh.ply", glm::vec3(0.5, 0.5, 0.5));
+    // queue all assets for background loading, each is drawn once its upload has finished
+    void init(vk::Device device, vma::Allocator vmalloc, Queues& queues) {
+        trace::Zone zone { "scene init" };
+        _uniforms.init(vmalloc, queues._universal_i, uniform_frame_size, frames_max);
+        _loader.init();
 
-        // std::random_device rd;
-        // std::mt19937 gen(rd());
-        // std::uniform_real_distribution<float> dis(0.0, 1.0);
-        // static constexpr std::size_t subs_n = 30;
-        // _data._mesh_subs.resize(subs_n);
-        // for (size_t i = 0; i < subs_n; i++) {
-        //     // glm::vec3 color = { dis(gen), dis(gen), dis(gen) };
-        //     glm::vec3 color = { 1.0, 0.1, 0.1 };
-        //     _data._mesh_subs[i].init(vmalloc, queues, std::format("data/hsfd23/mesh_{}.ply", i), color);
-        // }
+        _asset_grid = _loader.enqueue("hashgrid.grid", get_grid_task(device, vmalloc, queues));
+        _asset_main = _loader.enqueue("mesh.ply", get_main_task(device, vmalloc, queues));
+
+        static constexpr std::size_t subs_n = 30;
+        _data._mesh_subs.resize(subs_n);
+        for (size_t i = 0; i < subs_n; i++) {
+            _asset_subs.push_back(_loader.enqueue(std::format("mesh_{}.ply", i), [this, device, vmalloc, &queues, i, packed = _packed_vertices](std::atomic<float>& progress) {
+                std::string path = std::format("data/hsfd23/mesh_{}.ply", i);
+                return _data._mesh_subs[i].init(device, vmalloc, queues, { .path = path, .packed = packed, .progress_p = &progress, .cache = true });
+            }));
+        }
     }
-    void destroy(vma::Allocator vmalloc) {
-        _camera.destroy(vmalloc);
-        _data._grid.destroy(vmalloc);
+    void destroy(vk::Device device, vma::Allocator vmalloc) {
+        // finish running loads first, queued ones are skipped
+        _loader.destroy();
+        _uniforms.destroy(vmalloc);
+        _data._surface.destroy(vmalloc);
+        _data._cell_filter.destroy(vmalloc);
+        _data._slice.destroy(device, vmalloc);
+        _data._grid.destroy(device, vmalloc);
         _data._mesh_main.destroy(vmalloc);
-        _data._mesh_main_grey.destroy(vmalloc);
         for (auto& mesh: _data._mesh_subs) {
             mesh.destroy(vmalloc);
         }
     }
 
+    // reload meshes whose layout changed and the grid whose order changed, device has to be idle
+    void reload(vk::Device device, vma::Allocator vmalloc, Queues& queues) {
+        _reload_requested = false;
+        // assets still loading are being written by a worker, their layout and order are only known once ready
+        if (_asset_main->is_ready() && _packed_vertices != _data._mesh_main._packed) {
+            _data._mesh_main.destroy(vmalloc);
+            _data._mesh_main = {};
+            _loader.requeue(_asset_main, get_main_task(device, vmalloc, queues));
+        }
+        if (_asset_grid->is_ready() && (_reorder_grid != _grid_reordered || _measure_traversal != _grid_measured)) {
+            _data._surface.destroy(vmalloc);
+            _data._cell_filter.destroy(vmalloc);
+            _data._slice.destroy(device, vmalloc);
+            _data._grid.destroy(device, vmalloc);
+            _loader.requeue(_asset_grid, get_grid_task(device, vmalloc, queues));
+        }
+    }
+
     void static SDLCALL folder_callback(void* userdata_p, const char* const* filelist_pp, int /*filter*/) {
         if (!filelist_pp) {
             fmt::println("An error occured: {}", SDL_GetError());
@@ -62,12 +94,20 @@ struct Scene {
             SDL_ShowOpenFolderDialog(folder_callback, this, nullptr, SDL_GetBasePath(), false);
         }
 
+        _loader.display();
+        if (_asset_grid->is_ready()) {
+            display_cells();
+            display_surface();
+            display_bricks();
+            display_slice();
+        }
+
         // go to next subtree
-        if (Keys::pressed(SDLK_RIGHT)) {
+        if (Keys::pressed(SDLK_RIGHT) && _data._mesh_subs.size() > 0) {
             _mesh_sub_i = (_mesh_sub_i + 1) % (uint32_t)_data._mesh_subs.size();
         }
         // go to previous subtree
-        if (Keys::pressed(SDLK_LEFT)) {
+        if (Keys::pressed(SDLK_LEFT) && _data._mesh_subs.size() > 0) {
             if (_mesh_sub_i == 0) _mesh_sub_i = (uint32_t)_data._mesh_subs.size();
             _mesh_sub_i = _mesh_sub_i - 1;
         }
@@ -81,17 +121,183 @@ struct Scene {
         if (Keys::pressed(SDLK_SPACE)) {
             _render_grid = !_render_grid;
         }
+        // switch between distance based detail levels and full resolution
+        if (Keys::pressed('l')) {
+            _render_lod = !_render_lod;
+        }
+        // switch between gpu culled meshlets and cpu selected chunks
+        if (Keys::pressed('c')) {
+            _cull_meshlets = !_cull_meshlets;
+        }
+        // cull meshlets facing away from the camera
+        if (Keys::pressed('n')) {
+            _cull_backfacing = !_cull_backfacing;
+        }
+        // switch between full and packed vertex layout, once the main mesh is no longer being loaded
+        if (Keys::pressed('v') && _asset_main->is_finished()) {
+            _packed_vertices = !_packed_vertices;
+            _reload_requested = true;
+        }
+    }
+    // update after the buffers of this frame slot are no longer being read
+    void update(vma::Allocator vmalloc, uint32_t frame_slot, uint64_t finished_frame_n) {
+        _uniforms.begin_frame(frame_slot);
+        _camera.update(_uniforms);
+        // brick map copies were part of a finished frame
+        Bricks& bricks = _data._grid._bricks;
+        if (_asset_grid->is_ready() && bricks._uploaded && bricks._upload_frame < finished_frame_n) bricks.release_staging(vmalloc);
+        // isosurface buffers are allocated once it is first drawn and grow with the extracted triangles
+        if (_asset_grid->is_ready() && _render_surface) _data._surface.update(vmalloc, finished_frame_n);
     }
-    // update after buffers are no longer being read
-    void update(vma::Allocator vmalloc) {
-        _camera.update(vmalloc);
+    // whether the currently selected sub mesh can be drawn
+    auto is_sub_ready() const -> bool {
+        return _mesh_sub_i < _asset_subs.size() && _asset_subs[_mesh_sub_i]->is_ready();
     }
 
+    static constexpr uint32_t frames_max = 3; // frames in flight the renderer may use
+    static_assert(Isosurface::frames_max >= frames_max);
+    static constexpr vk::DeviceSize uniform_frame_size = 1 << 16; // uniform bytes per frame
+    RingBuffer _uniforms;
     Camera _camera;
     SceneData _data;
+    // background loading
+    Loader _loader;
+    Loader::Asset* _asset_grid = nullptr;
+    Loader::Asset* _asset_main = nullptr;
+    std::vector<Loader::Asset*> _asset_subs;
     uint32_t _mesh_sub_i = 0;
+    // per draw color overrides
+    glm::vec3 _color_grey = { 0.5, 0.5, 0.5 };
+    glm::vec3 _color_subs = { 1.0, 0.1, 0.1 };
+    glm::vec3 _color_surface = { 0.9, 0.8, 0.5 };
+    glm::vec3 _color_bricks = { 0.5, 0.8, 0.9 };
+    // signed distance of the extracted isosurface and the traced brick map, in voxels
+    float _iso_value = 0.0f;
+    // cells drawn by the grid toggle, unless every cell is drawn
+    CellFilter::Settings _cell_filter;
+    // plane the signed distances are sampled on
+    Slice::Settings _slice;
+    // of the last cpu query benchmark
+    double _index_queries_per_s = 0.0;
+    // largest projected error of a detail level in pixels
+    float _lod_error_px = 1.0f;
     // toggle flags
     bool _render_grid = false;
+    bool _filter_cells = true;
     bool _render_grey = false;
     bool _render_subs = false;
+    bool _render_surface = false;
+    bool _render_bricks = false;
+    bool _render_slice = false;
+    bool _render_lod = true;
+    bool _cull_meshlets = true;
+    bool _cull_backfacing = false; // meshes are drawn double sided, so only enabled on request
+    bool _packed_vertices = true;
+    bool _reorder_grid = true; // z-order of query points and cells
+    bool _grid_reordered = true; // of the loaded grid
+    bool _measure_traversal = false; // convert the grid without its cache, timing single threaded passes over the cells
+    bool _grid_measured = false; // of the loaded grid
+    bool _reload_requested = false;
+
+private:
+    // cell wireframe, filtered again by the renderer whenever the settings change
+    void display_cells() {
+        CellFilter& filter = _data._cell_filter;
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Cells", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+        ImGui::Checkbox("draw", &_render_grid);
+        ImGui::Checkbox("filter", &_filter_cells);
+        if (_filter_cells) {
+            ImGui::Checkbox("zero crossing", &_cell_filter.zero_crossing);
+            ImGui::Checkbox("near surface", &_cell_filter.near_surface);
+            ImGui::SameLine();
+            ImGui::SliderFloat("threshold", &_cell_filter.threshold, 0.0f, 2.0f);
+            ImGui::Checkbox("clip box", &_cell_filter.box);
+            ImGui::SliderFloat3("box min", &_cell_filter.box_min.x, 0.0f, 1.0f);
+            ImGui::SliderFloat3("box max", &_cell_filter.box_max.x, 0.0f, 1.0f);
+            ImGui::Text("%u of %u cells, filtered in %.3f ms", filter._selected_n, filter._cell_n, filter._filter_ms);
+        }
+        // reload in the other order to compare draw times, traversal rates are only measured on request
+        Grid& grid = _data._grid;
+        if (ImGui::Checkbox("z-order", &_reorder_grid)) _reload_requested = true;
+        ImGui::SameLine();
+        if (ImGui::Checkbox("measure traversal", &_measure_traversal)) _reload_requested = true;
+        ImGui::Text("drawn in %.3f ms", grid._draw_ms);
+        if (grid._traversal_rate > 0.0) {
+            ImGui::Text("traversed at %.1f M cells/s", grid._traversal_rate / 1'000'000.0);
+            if (grid._traversal_rate_unordered > 0.0) {
+                ImGui::SameLine();
+                ImGui::Text("(%.1f M before reordering)", grid._traversal_rate_unordered / 1'000'000.0);
+            }
+        }
+        // throughput of the cpu side distance queries, blocks this frame
+        if (ImGui::Button("benchmark cpu queries")) _index_queries_per_s = grid._index.benchmark(1 << 22);
+        if (_index_queries_per_s > 0.0) {
+            ImGui::SameLine();
+            ImGui::Text("%.1f M queries/s", _index_queries_per_s / 1'000'000.0);
+        }
+        ImGui::End();
+    }
+    // marching cubes over the grid, extracted again by the renderer whenever the iso value changes
+    void display_surface() {
+        Isosurface& surface = _data._surface;
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Isosurface", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+        ImGui::Checkbox("draw", &_render_surface);
+        ImGui::SliderFloat("iso value", &_iso_value, -1.0f, 1.0f);
+        ImGui::Text("%u triangles from %u cells, extracted in %.3f ms", surface._vertex_total / 3, surface._cell_n, surface._extract_ms);
+        if (surface._vertex_total > surface._vertex_capacity) ImGui::Text("growing the vertex buffer");
+        ImGui::End();
+    }
+    // sphere traced signed distances, with the frame time against how much of the volume is occupied
+    void display_bricks() {
+        Bricks& bricks = _data._grid._bricks;
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Brick map", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+        if (bricks._brick_n == 0) {
+            ImGui::Text("grid does not fit into a brick map");
+            ImGui::End();
+            return;
+        }
+        ImGui::Checkbox("draw", &_render_bricks);
+        ImGui::Text("%u of %u bricks occupied (%.1f%%)", bricks._brick_n, bricks._dims.x * bricks._dims.y * bricks._dims.z, 100.0 * bricks.get_occupancy());
+        ImGui::Text("%.1f MB, traced in %.3f ms", (double)bricks.get_memory_size() / (1024.0 * 1024.0), bricks._trace_ms);
+        ImGui::End();
+    }
+    // signed distance plane, resampled by the renderer whenever it moves
+    void display_slice() {
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Slice", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+        if (_data._grid._bricks._brick_n == 0) {
+            ImGui::Text("slices are sampled from the brick map");
+            ImGui::End();
+            return;
+        }
+        ImGui::Checkbox("draw", &_render_slice);
+        ImGui::Combo("normal", &_slice.axis, "x\0y\0z\0free\0");
+        ImGui::SliderFloat("offset", &_slice.offset, 0.0f, 1.0f);
+        if (_slice.axis == 3) {
+            ImGui::SliderFloat("yaw", &_slice.yaw, -180.0f, 180.0f);
+            ImGui::SliderFloat("pitch", &_slice.pitch, -90.0f, 90.0f);
+        }
+        ImGui::Text("%ux%u texels, sampled in %.3f ms", Slice::resolution, Slice::resolution, _data._slice._slice_ms);
+        ImGui::End();
+    }
+    // order is captured on the calling thread, as the flag may be toggled while loading
+    auto get_grid_task(vk::Device device, vma::Allocator vmalloc, Queues& queues) -> Loader::Task {
+        _grid_reordered = _reorder_grid;
+        _grid_measured = _measure_traversal;
+        return [this, device, vmalloc, &queues, reorder = _reorder_grid, measure = _measure_traversal](std::atomic<float>&) {
+            return _data._grid.init(device, vmalloc, queues, "data/hsfd23/hashgrid.grid", true, reorder, measure)
+                && _data._surface.init(queues._universal_i, _data._grid)
+                && _data._cell_filter.init(vmalloc, queues._universal_i, _data._grid)
+                && _data._slice.init(device, vmalloc);
+        };
+    }
+    // layout is captured on the calling thread, as the flag may be toggled while loading
+    auto get_main_task(vk::Device device, vma::Allocator vmalloc, Queues& queues) -> Loader::Task {
+        return [this, device, vmalloc, &queues, packed = _packed_vertices](std::atomic<float>& progress) {
+            return _data._mesh_main.init(device, vmalloc, queues, { .path = "data/hsfd23/mesh.ply", .packed = packed, .optimize = true, .lod_n = 4, .meshlets = true, .progress_p = &progress, .cache = true });
+        };
+    }
 };
\ No newline at end of file
@@ -3,43 +3,16 @@
 #include <glm/gtc/type_aligned.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vulkan/vulkan.hpp>
-#include <vk_mem_alloc.hpp>
 #include <fmt/base.h>
 #include "core/input.hpp"
-#include "core/buffer.hpp"
+#include "core/ring_buffer.hpp"
 
 struct Camera {
-    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues) {
-        // create camera matrix buffer
-		_buffer.init(vmalloc,
-			vk::BufferCreateInfo {
-				.size = _buffer.size(),	
-				.usage = vk::BufferUsageFlagBits::eUniformBuffer,
-				.sharingMode = vk::SharingMode::eExclusive,
-				.queueFamilyIndexCount = queues.size(),
-				.pQueueFamilyIndices = queues.data(),
-			},
-			vma::AllocationCreateInfo {
-				.flags = 
-					vma::AllocationCreateFlagBits::eHostAccessSequentialWrite |
-					vma::AllocationCreateFlagBits::eMapped,
-				.usage = vma::MemoryUsage::eAutoPreferDevice,
-				.requiredFlags = 
-					vk::MemoryPropertyFlagBits::eDeviceLocal,
-				.preferredFlags = 
-					vk::MemoryPropertyFlagBits::eHostCoherent |
-					vk::MemoryPropertyFlagBits::eHostVisible, // ReBAR
-			}
-		);
-    }
-    void destroy(vma::Allocator vmalloc) {
-		_buffer.destroy(vmalloc);
-    }
-    
     void resize(vk::Extent2D extent) {
 		_extent = extent;
     }
-	void update(vma::Allocator vmalloc) {
+	// push the matrix into the current frame's region of the uniform ring
+	void update(RingBuffer& uniforms) {
 		// read input for movement and rotation
 		float speed = 0.05;
 		if (Keys::down(SDLK_LCTRL)) speed /= 8.0;
@@ -66,13 +39,15 @@ struct Camera {
 		matrix = glm::rotate(matrix, -_rot.y, glm::aligned_vec3(0, 1, 0));
 		matrix = glm::translate(matrix, -_pos);
 		
-		// upload data
-		_buffer.write(vmalloc, matrix);
+		// upload data, kept for passes reconstructing view rays
+		_matrix = matrix;
+		_uniform_offset = uniforms.push(matrix);
 	}
 
 	glm::aligned_vec3 _pos = { 0, 0, 0 };
 	glm::aligned_vec3 _rot = { 0, 0, 0 };
-	DeviceBuffer<glm::aligned_mat4x4> _buffer;
+	glm::aligned_mat4x4 _matrix = glm::aligned_mat4x4(1);
+	uint32_t _uniform_offset = 0; // dynamic offset of the matrix within the ring
 	vk::Extent2D _extent;
 	float _fov = 60;
 	float _near = 0.01;
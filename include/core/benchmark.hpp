@@ -0,0 +1,219 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <fmt/base.h>
+#include <fmt/format.h>
+#include "core/queues.hpp"
+#include "core/renderer.hpp"
+#include "components/scene.hpp"
+
+// camera poses recorded once per frame, replayed at an even pace over any number of frames
+struct CameraPath {
+    struct Pose {
+        glm::vec3 pos;
+        glm::vec3 rot;
+    };
+    // one pose per line: position and rotation in radians, lines starting with # are skipped
+    auto load(std::string_view path) -> bool {
+        std::ifstream file { std::string(path) };
+        if (!file.good()) return false;
+        _poses.clear();
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream stream { line };
+            Pose pose;
+            if (stream >> pose.pos.x >> pose.pos.y >> pose.pos.z >> pose.rot.x >> pose.rot.y >> pose.rot.z) _poses.push_back(pose);
+        }
+        return _poses.size() > 0;
+    }
+    auto save(std::string_view path) const -> bool {
+        std::ofstream file { std::string(path), std::ofstream::trunc };
+        if (!file.good()) return false;
+        file << "# x y z pitch yaw roll\n";
+        for (const Pose& pose: _poses) {
+            file << fmt::format("{} {} {} {} {} {}\n", pose.pos.x, pose.pos.y, pose.pos.z, pose.rot.x, pose.rot.y, pose.rot.z);
+        }
+        return file.good();
+    }
+    // pose at t in [0, 1], interpolated linearly between recorded poses
+    auto sample(float t) const -> Pose {
+        if (_poses.size() == 1) return _poses.front();
+        float f = std::clamp(t, 0.0f, 1.0f) * (float)(_poses.size() - 1);
+        std::size_t i = std::min((std::size_t)f, _poses.size() - 2);
+        float a = f - (float)i;
+        return {
+            glm::mix(_poses[i].pos, _poses[i + 1].pos, a),
+            glm::mix(_poses[i].rot, _poses[i + 1].rot, a),
+        };
+    }
+
+    std::vector<Pose> _poses;
+};
+
+// headless run over a camera path, repeated for every combination of the grid, SMAA and sub mesh toggles
+// reports cpu frame times and gpu frame spans per combination as a repeatable regression signal
+struct Benchmark {
+    static constexpr std::string_view path_default = "camera_path.txt"; // also where recorded paths are written
+    struct Options {
+        bool headless = false;
+        std::string path = std::string(path_default);
+        std::string report = "benchmark.csv";
+        uint32_t frames = 600; // measured per configuration
+        uint32_t warmup = 60; // frames before measuring
+        vk::Extent2D extent = { 1280, 720 };
+    };
+    struct Config {
+        bool grid;
+        bool smaa;
+        bool subs;
+    };
+    struct Result {
+        Config config;
+        std::vector<double> cpu_ms;
+        std::vector<double> gpu_ms;
+    };
+
+    // --headless [--path file] [--frames n] [--report file]
+    static auto parse(int argc, char** argv) -> Options {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--headless") options.headless = true;
+            else if (arg == "--path" && has_value) options.path = argv[++i];
+            else if (arg == "--report" && has_value) options.report = argv[++i];
+            else if (arg == "--frames" && has_value) options.frames = std::max(1, std::atoi(argv[++i]));
+        }
+        return options;
+    }
+    void init(const Options& options, Camera& camera) {
+        _options = options;
+        if (!_path.load(_options.path)) {
+            fmt::println("unable to load camera path {}, benchmarking from the initial pose", _options.path);
+            _path._poses = { { glm::vec3(camera._pos), glm::vec3(camera._rot) } };
+        }
+        _phase = Phase::eLoading;
+        _time_beg = std::chrono::steady_clock::now();
+        _results.clear();
+    }
+    // advance by one frame before the scene is updated, returns false once the report was written
+    auto update(vk::Device device, Queues& queues, Scene& scene, Renderer& renderer) -> bool {
+        auto time = std::chrono::steady_clock::now();
+        double frame_ms = std::chrono::duration<double, std::milli>(time - _time_frame).count();
+        _time_frame = time;
+        switch (_phase) {
+            case Phase::eLoading: {
+                if (!scene._loader.is_idle()) return true;
+                fmt::println("assets loaded after {:.2f} s", std::chrono::duration<double>(time - _time_beg).count());
+                begin_config(scene, renderer, 0);
+                break;
+            }
+            case Phase::eWarmup: {
+                if (++_frame_i < _options.warmup) break;
+                _phase = Phase::eMeasure;
+                _frame_i = 0;
+                // gpu timings arrive frames late, so finish the warmup frames before recording spans
+                GpuProfiler& profiler = renderer.get_profiler();
+                queues.wait_idle(device);
+                profiler.drain(device);
+                profiler._frame_spans.clear();
+                profiler._record_spans = true;
+                // the first measured frame should not include the wait
+                _time_frame = std::chrono::steady_clock::now();
+                break;
+            }
+            case Phase::eMeasure: {
+                Result& result = _results.back();
+                result.cpu_ms.push_back(frame_ms);
+                if (++_frame_i < _options.frames) break;
+                // collect the spans of the measured frames still in flight before switching configuration
+                GpuProfiler& profiler = renderer.get_profiler();
+                queues.wait_idle(device);
+                profiler.drain(device);
+                result.gpu_ms = profiler._frame_spans;
+                profiler._record_spans = false;
+                if (_config_i + 1 < configs.size()) begin_config(scene, renderer, _config_i + 1);
+                else {
+                    report();
+                    return false;
+                }
+                break;
+            }
+        }
+        // warmup stays at the start of the path
+        float t = _phase == Phase::eMeasure ? (float)_frame_i / (float)std::max(1u, _options.frames - 1) : 0.0f;
+        CameraPath::Pose pose = _path.sample(t);
+        scene._camera._pos = glm::aligned_vec3(pose.pos);
+        scene._camera._rot = glm::aligned_vec3(pose.rot);
+        return true;
+    }
+
+    // every combination of the benchmarked toggles
+    static constexpr std::array<Config, 8> configs = {{
+        { false, false, false }, { false, false, true }, { false, true, false }, { false, true, true },
+        { true, false, false }, { true, false, true }, { true, true, false }, { true, true, true },
+    }};
+
+private:
+    enum class Phase { eLoading, eWarmup, eMeasure };
+    void begin_config(Scene& scene, Renderer& renderer, std::size_t config_i) {
+        const Config& config = configs[config_i];
+        scene._render_grid = config.grid;
+        scene._render_subs = config.subs;
+        renderer._smaa_enabled = config.smaa;
+        _results.push_back({ .config = config });
+        _config_i = config_i;
+        _frame_i = 0;
+        _phase = Phase::eWarmup;
+    }
+    static auto get_name(const Config& config) -> std::string {
+        return fmt::format("grid {:3} smaa {:3} subs {:3}", config.grid ? "on" : "off", config.smaa ? "on" : "off", config.subs ? "on" : "off");
+    }
+    // average and percentiles of the samples in ms
+    static auto get_stats(std::vector<double> samples) -> std::array<double, 4> {
+        if (samples.size() == 0) return {};
+        std::sort(samples.begin(), samples.end());
+        double avg = 0.0;
+        for (double sample: samples) avg += sample;
+        avg /= (double)samples.size();
+        return { avg, samples[samples.size() / 2], samples[samples.size() * 95 / 100], samples[samples.size() * 99 / 100] };
+    }
+    void report() {
+        std::ofstream file { _options.report, std::ofstream::trunc };
+        if (file.good()) file << "grid,smaa,subs,cpu_avg,cpu_p50,cpu_p95,cpu_p99,gpu_avg,gpu_p50,gpu_p95,gpu_p99,gpu_frames\n";
+        else fmt::println("unable to write benchmark report: {}", _options.report);
+        fmt::println("{} frames per configuration at {}x{}, times in ms (avg/p50/p95/p99)", _options.frames, _options.extent.width, _options.extent.height);
+        for (const Result& result: _results) {
+            auto cpu = get_stats(result.cpu_ms);
+            auto gpu = get_stats(result.gpu_ms);
+            fmt::println("{}: cpu {:7.3f} {:7.3f} {:7.3f} {:7.3f} | gpu {:7.3f} {:7.3f} {:7.3f} {:7.3f}",
+                get_name(result.config), cpu[0], cpu[1], cpu[2], cpu[3], gpu[0], gpu[1], gpu[2], gpu[3]);
+            if (!file.good()) continue;
+            file << fmt::format("{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{:.4f},{}\n",
+                (int)result.config.grid, (int)result.config.smaa, (int)result.config.subs,
+                cpu[0], cpu[1], cpu[2], cpu[3], gpu[0], gpu[1], gpu[2], gpu[3], result.gpu_ms.size());
+        }
+        if (file.good()) fmt::println("benchmark report written to {}", _options.report);
+    }
+
+    Options _options;
+    CameraPath _path;
+    Phase _phase = Phase::eLoading;
+    std::size_t _config_i = 0;
+    uint32_t _frame_i = 0;
+    std::vector<Result> _results;
+    std::chrono::steady_clock::time_point _time_beg;
+    std::chrono::steady_clock::time_point _time_frame;
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/platform.hpp"
+
+// versioned binary cache of preprocessed assets, stored next to their source file
+// sections are page aligned and checksummed, so they can be uploaded straight from the mapping
+namespace cache {
+    // source file and processing options, any change invalidates the cache
+    struct Stamp {
+        uint64_t source_size = 0;
+        int64_t source_mtime = 0;
+        uint64_t key = 0; // options the source was processed with
+        uint32_t version = 0; // section layout of the asset type
+        uint32_t _pad = 0;
+        auto operator==(const Stamp& other) const -> bool = default;
+    };
+    // table entry of a section within the file
+    struct Entry {
+        uint32_t id;
+        uint32_t _pad;
+        uint64_t offset; // page aligned
+        uint64_t size;
+        uint64_t checksum;
+    };
+    // stamp of the source file at path
+    auto get_stamp(std::string_view path, uint32_t version, uint64_t key) -> Stamp;
+    // 64 bit hash, blocks are hashed in parallel
+    auto get_checksum(std::span<const std::byte> data) -> uint64_t;
+    // mix value into a running key
+    constexpr auto combine(uint64_t key, uint64_t value) -> uint64_t {
+        return (key ^ value) * 0x100000001b3ull + 0x9e3779b97f4a7c15ull;
+    }
+
+    // sections are written into a temporary file as they are produced, the header and entry table follow last
+    struct Writer {
+        // start a cache of at most section_n sections next to path
+        auto open(std::string_view path, std::size_t section_n) -> bool;
+        // place a section of size bytes, returns its index for append()
+        auto reserve(uint32_t id, std::size_t size) -> std::size_t;
+        // write the next bytes of a section, reserved sections may be filled in any interleaving
+        void append(std::size_t section_i, std::span<const std::byte> data);
+        template<typename T>
+        void add(uint32_t id, std::span<T> data) {
+            append(reserve(id, data.size_bytes()), std::as_bytes(data));
+        }
+        // write header and table, then replace path, fails when a section is incomplete or a write failed
+        auto commit(const Stamp& stamp) -> bool;
+        // drop the temporary file
+        void abort();
+
+        struct Section {
+            Entry entry;
+            std::size_t written = 0;
+            std::vector<uint64_t> hashes; // of all complete blocks
+            std::vector<std::byte> partial; // trailing block until it is complete
+        };
+        std::string _path;
+        std::string _path_tmp;
+        std::ofstream _file;
+        std::vector<Section> _sections;
+        std::size_t _section_n = 0;
+        std::size_t _offset = 0; // of the next section
+        bool _failed = false;
+    };
+
+    struct Reader {
+        // map file and validate stamp and entry table, section checksums are only hashed when verify is set
+        // skipping them keeps a trusted cache at a single pass over its sections, the upload itself
+        auto open(std::string_view path, const Stamp& stamp, bool verify = false) -> bool;
+        void close();
+        // section contents, empty when missing
+        auto get(uint32_t id) const -> std::span<const std::byte>;
+        template<typename T>
+        auto get(uint32_t id) const -> std::span<const T> {
+            std::span<const std::byte> data = get(id);
+            return { reinterpret_cast<const T*>(data.data()), data.size() / sizeof(T) };
+        }
+        auto get_size() const -> std::size_t {
+            return _file._size;
+        }
+
+        platform::MappedFile _file;
+        std::span<const Entry> _entries;
+    };
+}
@@ -9,16 +9,23 @@
 #include "core/renderer.hpp"
 #include "core/imgui.hpp"
 #include "core/input.hpp"
+#include "core/trace.hpp"
+#include "core/benchmark.hpp"
 #include "components/scene.hpp"
 
 class Engine {
 public:
-    void init() {
+    // headless runs render offscreen without window, swapchain or imgui backends
+    void init(const Benchmark::Options& options = {}) {
+        trace::set_thread_name("main");
+        trace::Zone zone { "engine init" };
+        _headless = options.headless;
         // Vulkan: dynamic dispatcher init 1/3
         VULKAN_HPP_DEFAULT_DISPATCHER.init();
         
         // SDL: create window and query required instance extensions
-        _instance = _window.init(1280, 720, "TSDF Visualizer");
+        if (_headless) _instance = Window::create_instance("TSDF Visualizer", {});
+        else _instance = _window.init(1280, 720, "TSDF Visualizer");
         
         // Vulkan: dynamic dispatcher init 2/3
         VULKAN_HPP_DEFAULT_DISPATCHER.init(_instance);
@@ -29,7 +36,6 @@ public:
             ._required_minor = 3,
             ._preferred_device_type = vk::PhysicalDeviceType::eDiscreteGpu,
             ._required_extensions {
-                vk::KHRSwapchainExtensionName,
                 // vk::KHRDynamicRenderingLocalReadExtensionName,
             },
             ._optional_extensions {
@@ -37,12 +43,14 @@ public:
                 vk::EXTPageableDeviceLocalMemoryExtensionName,
             },
             ._required_features {
+                .multiDrawIndirect = true,
                 .fillModeNonSolid = true,
                 .wideLines = true,
             },
             ._required_vk11_features {
             },
             ._required_vk12_features {
+                .drawIndirectCount = true,
                 // .bufferDeviceAddress = true,
             },
             ._required_vk13_features {
@@ -57,11 +65,15 @@ public:
                 vk::QueueFlagBits::eTransfer,
             }
         };
-        _phys_device = device_selector.select_physical_device(_instance, _window._surface);
-
-        // Vulkan: create device
         std::vector<uint32_t> queue_mappings;
-        std::tie(_device, queue_mappings) = device_selector.create_logical_device(_phys_device);
+        {
+            trace::Zone zone_device { "create device" };
+            if (!_headless) device_selector._required_extensions.push_back(vk::KHRSwapchainExtensionName);
+            _phys_device = device_selector.select_physical_device(_instance, _headless ? nullptr : _window._surface);
+
+            // Vulkan: create device
+            std::tie(_device, queue_mappings) = device_selector.create_logical_device(_phys_device);
+        }
         
         // Vulkan: dynamic dispatcher init 3/3
         VULKAN_HPP_DEFAULT_DISPATCHER.init(_device);
@@ -84,34 +96,46 @@ public:
         // create renderer components
         DepthStencil::set_format(_phys_device);
         _queues.init(_device, queue_mappings);
+        _rendering = true;
+        if (_headless) {
+            // renderer is created right away, as there is no swapchain to request a resize
+            ImGui::impl::init_headless(options.extent);
+            _scene.init(_device, _vmalloc, _queues);
+            _scene._camera.resize(options.extent);
+            _renderer.init(_phys_device, _device, _vmalloc, _queues, options.extent, _scene);
+            _benchmark.init(options, _scene._camera);
+            return;
+        }
         _swapchain.set_target_framerate(_fps_foreground);
         _swapchain._resize_requested = true;
         
         // initialize imgui backend
         ImGui::impl::init_sdl(_window._window_p);
         ImGui::impl::init_vulkan(_instance, _device, _phys_device, _queues._universal, vk::Format::eR16G16B16A16Sfloat);
-        _rendering = true;
         
         // begin constructing scenes
-        _scene.init(_vmalloc, _queues._universal_i);
+        _scene.init(_device, _vmalloc, _queues);
     }
     void destroy() {
-        _device.waitIdle();
+        _queues.wait_idle(_device);
         // destroy scenes
-        _scene.destroy(_vmalloc);
+        _scene.destroy(_device, _vmalloc);
         //
-        ImGui::impl::shutdown(_device);
+        if (_headless) ImGui::impl::shutdown_headless();
+        else ImGui::impl::shutdown(_device);
         _renderer.destroy(_device, _vmalloc);
-        _swapchain.destroy(_device);
+        if (!_headless) _swapchain.destroy(_device);
         _queues.destroy(_device);
         _vmalloc.destroy();
         _device.destroy();
-        _window.destroy(_instance);
+        if (!_headless) _window.destroy(_instance);
         _instance.destroy();
+        // a capture started via --trace covers the whole run
+        if (trace::capturing) trace::end_capture(trace_path);
     }
     
     auto execute_event(const SDL_Event* event_p) -> SDL_AppResult {
-        ImGui::impl::process_event(event_p);
+        if (!_headless) ImGui::impl::process_event(event_p);
         switch (event_p->type) {
             // window handling
             case SDL_EventType::SDL_EVENT_QUIT: return SDL_AppResult::SDL_APP_SUCCESS;
@@ -142,39 +166,87 @@ public:
         }
         return SDL_AppResult::SDL_APP_CONTINUE;
     }
-    void execute_frame() {
+    auto execute_frame() -> SDL_AppResult {
+        if (_headless) return execute_benchmark_frame();
         if (!_rendering) {
             SDL_Delay(50);
-            return;
+            return SDL_AppResult::SDL_APP_CONTINUE;
         }
-        if (_swapchain._resize_requested) {
+        // frames in flight are changed by recreating the renderer
+        if (_swapchain._resize_requested || _renderer._reinit_requested) {
             resize();
-            return;
+            return SDL_AppResult::SDL_APP_CONTINUE;
+        }
+        trace::Zone zone { "frame" };
+        {
+            trace::Zone zone_input { "input" };
+            handle_inputs();
+        }
+        {
+            trace::Zone zone_imgui { "imgui new frame" };
+            ImGui::impl::new_frame();
+            ImGui::utils::display_fps();
+        }
+        {
+            trace::Zone zone_update { "scene update safe" };
+            _scene.update_safe();
+        }
+        if (_scene._reload_requested) {
+            trace::Zone zone_reload { "scene reload" };
+            _queues.wait_idle(_device);
+            _scene.reload(_device, _vmalloc, _queues);
         }
-        handle_inputs();
-        ImGui::impl::new_frame();
-        ImGui::utils::display_fps();
-
-        _scene.update_safe();
         _renderer.wait(_device);
-        _scene.update(_vmalloc);
-        _renderer.render(_device, _swapchain, _queues, _scene);
+        {
+            trace::Zone zone_update { "scene update" };
+            _scene.update(_vmalloc, _renderer.get_frame_slot(), _renderer.get_finished_frame_count());
+        }
+        _renderer.render(_device, &_swapchain, _queues, _scene);
         Input::flush();
+        return SDL_AppResult::SDL_APP_CONTINUE;
     }
     
 private:
+    // one offscreen frame of the benchmark, quits once its report is written
+    auto execute_benchmark_frame() -> SDL_AppResult {
+        trace::Zone zone { "frame" };
+        auto time = std::chrono::steady_clock::now();
+        ImGui::impl::new_frame_headless(std::chrono::duration<float>(time - _time_frame).count());
+        _time_frame = time;
+        _scene.update_safe();
+        bool running = _benchmark.update(_device, _queues, _scene, _renderer);
+        if (running) {
+            _renderer.wait(_device);
+            _scene.update(_vmalloc, _renderer.get_frame_slot(), _renderer.get_finished_frame_count());
+            _renderer.render(_device, nullptr, _queues, _scene);
+        }
+        ImGui::impl::end_frame_headless();
+        return running ? SDL_AppResult::SDL_APP_CONTINUE : SDL_AppResult::SDL_APP_SUCCESS;
+    }
     void resize() {
-        _device.waitIdle();
+        _queues.wait_idle(_device);
         if (!SDL_SyncWindow(_window._window_p)) {
             fmt::println("Failed to sync window");
             return;
         }
         
         _scene._camera.resize(_window.size());
-        _renderer.resize(_device, _vmalloc, _queues, _window.size(), _scene._camera);
+        _renderer.resize(_phys_device, _device, _vmalloc, _queues, _window.size(), _scene);
         _swapchain.resize(_phys_device, _device, _window, _queues);
     }
     void handle_inputs() {
+        // start or stop a cpu trace via T
+        if (Keys::pressed('t')) {
+            if (trace::capturing) trace::end_capture(trace_path);
+            else trace::begin_capture();
+        }
+        // record the camera path replayed by headless benchmarks via R
+        if (Keys::pressed('r')) {
+            _path_recording = !_path_recording;
+            if (_path_recording) _path._poses.clear();
+            else if (_path.save(Benchmark::path_default)) fmt::println("camera path of {} poses written to {}", _path._poses.size(), Benchmark::path_default);
+        }
+        if (_path_recording) _path._poses.push_back({ glm::vec3(_scene._camera._pos), glm::vec3(_scene._camera._rot) });
         // fullscreen toggle via F11
         if (Keys::pressed(SDLK_F11)) {
             _window.toggle_fullscreen();
@@ -201,4 +273,12 @@ private:
     uint32_t _fps_foreground = 0;
     uint32_t _fps_background = 5;
     bool _rendering;
+    // offscreen benchmark
+    Benchmark _benchmark;
+    CameraPath _path; // being recorded
+    bool _path_recording = false;
+    std::chrono::steady_clock::time_point _time_frame;
+    bool _headless = false;
+public:
+    static constexpr std::string_view trace_path = "trace.json";
 };
\ No newline at end of file
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <fmt/base.h>
+#include <fmt/format.h>
+#include <imgui.h>
+#include "core/queues.hpp"
+
+// gpu time of named passes, measured by timestamp queries around them
+// every frame writes into its own query pool, which is only read back and reset once the frame is known to have finished,
+// so the results are a few frames late but never stall the cpu
+struct GpuProfiler {
+    // writes the end timestamp of a zone when leaving its scope
+    struct Zone {
+        Zone(GpuProfiler* profiler_p, vk::CommandBuffer cmd, uint32_t zone_i): _profiler_p(profiler_p), _cmd(cmd), _zone_i(zone_i) {}
+        Zone(const Zone&) = delete;
+        ~Zone() {
+            if (_profiler_p != nullptr) _profiler_p->end(_cmd, _zone_i);
+        }
+        GpuProfiler* _profiler_p;
+        vk::CommandBuffer _cmd;
+        uint32_t _zone_i;
+    };
+
+    // slots should exceed the frames in flight by one, as the swapchain records its passes after the frame's fence
+    void init(vk::PhysicalDevice phys_device, vk::Device device, Queues& queues, uint32_t slot_n) {
+        _timestamp_period = phys_device.getProperties().limits.timestampPeriod;
+        uint32_t valid_bits = phys_device.getQueueFamilyProperties()[queues._universal_i].timestampValidBits;
+        _timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (uint64_t(1) << valid_bits) - 1;
+        _enabled = valid_bits > 0;
+        _slots.resize(slot_n);
+        for (Slot& slot: _slots) {
+            slot._query_pool = device.createQueryPool({
+                .queryType = vk::QueryType::eTimestamp,
+                .queryCount = zones_max * 2,
+            });
+        }
+        _slot_i = 0;
+        _skipped = false;
+    }
+    void destroy(vk::Device device) {
+        for (Slot& slot: _slots) device.destroyQueryPool(slot._query_pool);
+        _slots.clear();
+    }
+    // collect the zones of the frame that last used this frame's slot, then reset it for a new frame
+    // the swapchain's passes of a frame only finish before the next frame does, so a slot is reused once that has finished
+    void begin_frame(vk::Device device, vk::CommandBuffer cmd, uint64_t frame_i, uint64_t finished_frame_n) {
+        _slot_i = frame_i;
+        Slot& slot = get_slot();
+        // still pending, skip timing this frame rather than resetting queries the gpu may write
+        _skipped = slot._used && slot._frame_i + 1 >= finished_frame_n;
+        if (_skipped) return;
+        if (slot._zones.size() > 0) collect(device, slot);
+        slot._zones.clear();
+        slot._frame_i = frame_i;
+        slot._used = true;
+        cmd.resetQueryPool(slot._query_pool, 0, zones_max * 2);
+    }
+    // collect every pending slot in the order its frames were recorded, the device has to be idle
+    void drain(vk::Device device) {
+        std::vector<Slot*> pending;
+        for (Slot& slot: _slots) if (slot._used && slot._zones.size() > 0) pending.push_back(&slot);
+        std::sort(pending.begin(), pending.end(), [](const Slot* a_p, const Slot* b_p) { return a_p->_frame_i < b_p->_frame_i; });
+        for (Slot* slot_p: pending) {
+            collect(device, *slot_p);
+            slot_p->_zones.clear();
+        }
+    }
+    // time the commands recorded until the returned zone leaves its scope, the name has to outlive the profiler
+    [[nodiscard]] auto zone(vk::CommandBuffer cmd, std::string_view name) -> Zone {
+        Slot& slot = get_slot();
+        if (!_enabled || _skipped || _slots.size() == 0 || slot._zones.size() >= zones_max) return { nullptr, cmd, 0 };
+        uint32_t zone_i = (uint32_t)slot._zones.size();
+        slot._zones.push_back(name);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, slot._query_pool, zone_i * 2 + 0);
+        return { this, cmd, zone_i };
+    }
+
+    // latest time of a pass in ms and how many of its samples were collected so far, both zero if it never was
+    auto get_latest(std::string_view name) const -> std::pair<double, std::size_t> {
+        auto it = std::find_if(_stats.cbegin(), _stats.cend(), [name](const Stat& stat) { return stat._name == name; });
+        if (it == _stats.cend() || it->_sample_i == 0) return { 0.0, 0 };
+        return { it->_samples[(it->_sample_i - 1) % it->_samples.size()], it->_sample_i };
+    }
+
+    // rolling average and percentiles of every pass, in the order they were first seen
+    void display() {
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("GPU passes", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+        if (!_enabled) ImGui::Text("timestamps are not supported by this queue");
+        ImGui::Text("%-16s %8s %8s %8s %8s", "pass", "avg", "p50", "p95", "p99");
+        std::vector<double> sorted;
+        double total_avg = 0.0;
+        for (const Stat& stat: _stats) {
+            std::size_t sample_n = std::min(stat._sample_i, stat._samples.size());
+            if (sample_n == 0) continue;
+            sorted.assign(stat._samples.cbegin(), stat._samples.cbegin() + sample_n);
+            std::sort(sorted.begin(), sorted.end());
+            double avg = 0.0;
+            for (double sample: sorted) avg += sample;
+            avg /= (double)sample_n;
+            total_avg += avg;
+            ImGui::Text("%-16s %8.3f %8.3f %8.3f %8.3f", stat._name.c_str(), avg,
+                sorted[sample_n / 2],
+                sorted[sample_n * 95 / 100],
+                sorted[sample_n * 99 / 100]);
+        }
+        ImGui::Text("%-16s %8.3f ms", "sum", total_avg);
+        if (ImGui::Checkbox("write csv", &_write_csv)) {
+            if (_write_csv) {
+                _csv.open(csv_path, std::ofstream::trunc);
+                if (_csv.good()) _csv << "frame,pass,ms\n";
+                else {
+                    fmt::println("unable to write gpu profile: {}", csv_path);
+                    _write_csv = false;
+                }
+            }
+            else _csv.close();
+        }
+        if (ImGui::Button("reset")) _stats.clear();
+        ImGui::End();
+    }
+
+private:
+    struct Slot {
+        vk::QueryPool _query_pool;
+        std::vector<std::string_view> _zones; // names of the zones written in this frame
+        uint64_t _frame_i = 0; // frame that last wrote the queries
+        bool _used = false;
+    };
+    struct Stat {
+        std::string _name;
+        std::array<double, 256> _samples = {}; // ms
+        std::size_t _sample_i = 0;
+    };
+
+    void end(vk::CommandBuffer cmd, uint32_t zone_i) {
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, get_slot()._query_pool, zone_i * 2 + 1);
+    }
+    auto get_slot() -> Slot& {
+        return _slots[_slot_i % _slots.size()];
+    }
+    void collect(vk::Device device, Slot& slot) {
+        // value and availability of each query, zones of aborted presents are simply never available
+        std::array<uint64_t, zones_max * 4> results;
+        uint32_t query_n = (uint32_t)slot._zones.size() * 2;
+        vk::Result result = device.getQueryPoolResults(slot._query_pool, 0, query_n, query_n * 2 * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) return;
+        uint64_t span_beg = UINT64_MAX;
+        uint64_t span_end = 0;
+        for (std::size_t i = 0; i < slot._zones.size(); i++) {
+            const uint64_t* zone_p = &results[i * 4];
+            if (zone_p[1] == 0 || zone_p[3] == 0) continue;
+            span_beg = std::min(span_beg, zone_p[0]);
+            span_end = std::max(span_end, zone_p[2]);
+            double ms = (double)((zone_p[2] - zone_p[0]) & _timestamp_mask) * _timestamp_period / 1'000'000.0;
+            Stat& stat = get_stat(slot._zones[i]);
+            stat._samples[stat._sample_i++ % stat._samples.size()] = ms;
+            if (_write_csv) _csv << fmt::format("{},{},{:.4f}\n", _frame_n, slot._zones[i], ms);
+        }
+        if (_record_spans && span_end > 0) _frame_spans.push_back((double)((span_end - span_beg) & _timestamp_mask) * _timestamp_period / 1'000'000.0);
+        _frame_n++;
+    }
+    auto get_stat(std::string_view name) -> Stat& {
+        auto it = std::find_if(_stats.begin(), _stats.end(), [name](const Stat& stat) { return stat._name == name; });
+        if (it != _stats.end()) return *it;
+        return _stats.emplace_back(Stat { ._name = std::string(name) });
+    }
+
+public:
+    static constexpr uint32_t zones_max = 32; // per frame
+    static constexpr const char* csv_path = "gpu_profile.csv";
+    // gpu time from the first zone's begin to the last zone's end of each collected frame, in ms
+    std::vector<double> _frame_spans;
+    bool _record_spans = false;
+private:
+    std::vector<Slot> _slots;
+    uint64_t _slot_i = 0; // frame being recorded
+    bool _skipped = false; // its slot was still pending
+    uint64_t _frame_n = 0; // frames collected so far
+    std::vector<Stat> _stats;
+    float _timestamp_period = 1.0f; // ns per tick
+    uint64_t _timestamp_mask = UINT64_MAX;
+    bool _enabled = false;
+    // per pass timings of every collected frame
+    std::ofstream _csv;
+    bool _write_csv = false;
+};
@@ -11,6 +11,7 @@ struct Image {
         vk::Extent3D extent;
         vk::ImageUsageFlags usage;
         vk::ImageAspectFlags aspects = vk::ImageAspectFlagBits::eColor;
+        vk::ImageType type = vk::ImageType::e2D;
         float priority = 0.5f;
     };
     struct WrapInfo {
@@ -36,7 +37,7 @@ struct Image {
         _last_stage = vk::PipelineStageFlagBits2::eTopOfPipe;
         // create image
         vk::ImageCreateInfo info_image {
-            .imageType = vk::ImageType::e2D,
+            .imageType = info.type,
             .format = _format,
             .extent = _extent,
             .mipLevels = 1,
@@ -55,7 +56,7 @@ struct Image {
         // create image view
         vk::ImageViewCreateInfo info_view {
             .image = _image,
-            .viewType = vk::ImageViewType::e2D,
+            .viewType = info.type == vk::ImageType::e3D ? vk::ImageViewType::e3D : vk::ImageViewType::e2D,
             .format = _format,
             .components {
                 .r = vk::ComponentSwizzle::eIdentity,
@@ -29,5 +29,10 @@ namespace ImGui {
         void new_frame();
         void draw(vk::CommandBuffer cmd, vk::ImageView& image_view, vk::ImageLayout layout, vk::Extent2D extent);
         void shutdown(vk::Device device);
+        // context without platform and renderer backends, windows are built but never drawn
+        void init_headless(vk::Extent2D extent);
+        void new_frame_headless(float delta_s);
+        void end_frame_headless();
+        void shutdown_headless();
     }
 }
\ No newline at end of file
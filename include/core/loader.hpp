@@ -0,0 +1,148 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <imgui.h>
+#include "core/parallel.hpp"
+#include "core/trace.hpp"
+
+// worker pool for loading assets in the background while frames keep being rendered
+// an asset may only be touched by the render thread once it is ready
+struct Loader {
+    enum class State: uint8_t { eQueued, eLoading, eReady, eFailed };
+    struct Asset {
+        auto is_ready() const -> bool {
+            return _state.load(std::memory_order_acquire) == State::eReady;
+        }
+        auto is_finished() const -> bool {
+            State state = _state.load(std::memory_order_acquire);
+            return state == State::eReady || state == State::eFailed;
+        }
+        std::string _name;
+        std::atomic<State> _state = State::eQueued;
+        std::atomic<float> _progress = 0.0f; // [0, 1], written by the loading task
+    };
+    // loading function, reports progress through the reference and returns whether the asset is usable
+    typedef std::function<bool(std::atomic<float>&)> Task;
+
+    void init(std::size_t workers_n = std::max<std::size_t>(1, parallel::get_thread_count() / 2)) {
+        _stopping = false;
+        _workers.reserve(workers_n);
+        for (std::size_t i = 0; i < workers_n; i++) _workers.emplace_back([this]() { work(); });
+    }
+    // skips queued tasks and waits for running ones
+    void destroy() {
+        {
+            std::scoped_lock lock { _mutex };
+            _stopping = true;
+        }
+        _condition.notify_all();
+        _workers.clear();
+        _tasks.clear();
+        _assets.clear();
+    }
+
+    // queue task, the returned asset stays valid until destroy
+    auto enqueue(std::string_view name, Task&& task) -> Asset* {
+        _assets.push_back(std::make_unique<Asset>());
+        Asset* asset_p = _assets.back().get();
+        asset_p->_name = name;
+        {
+            std::scoped_lock lock { _mutex };
+            _tasks.push_back({ asset_p, std::move(task) });
+        }
+        _condition.notify_one();
+        return asset_p;
+    }
+    // queue task again for a finished asset
+    void requeue(Asset* asset_p, Task&& task) {
+        asset_p->_progress.store(0.0f, std::memory_order_relaxed);
+        asset_p->_state.store(State::eQueued, std::memory_order_release);
+        {
+            std::scoped_lock lock { _mutex };
+            _tasks.push_back({ asset_p, std::move(task) });
+        }
+        _condition.notify_one();
+    }
+    // whether every queued asset has either loaded or failed
+    auto is_idle() const -> bool {
+        return std::all_of(_assets.cbegin(), _assets.cend(), [](const auto& asset_p) { return asset_p->is_finished(); });
+    }
+    // window with the progress of all unfinished assets, hidden once everything has loaded
+    void display() {
+        bool loading = false;
+        for (auto& asset_p: _assets) loading |= !asset_p->is_finished();
+        if (!loading && !_failures_shown) return;
+
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDocking
+            | ImGuiWindowFlags_NoSavedSettings
+            | ImGuiWindowFlags_NoFocusOnAppearing
+            | ImGuiWindowFlags_AlwaysAutoResize
+            | ImGuiWindowFlags_NoNav);
+        std::size_t ready_n = 0;
+        std::size_t failed_n = 0;
+        for (auto& asset_p: _assets) {
+            switch (asset_p->_state.load(std::memory_order_acquire)) {
+                case State::eReady: ready_n++; break;
+                case State::eFailed: failed_n++; break;
+                case State::eQueued: ImGui::Text("%s (queued)", asset_p->_name.c_str()); break;
+                case State::eLoading: {
+                    ImGui::ProgressBar(asset_p->_progress.load(std::memory_order_relaxed), ImVec2(200.0f, 0.0f));
+                    ImGui::SameLine();
+                    ImGui::Text("%s", asset_p->_name.c_str());
+                    break;
+                }
+            }
+        }
+        ImGui::Text("%zu/%zu ready, %zu failed", ready_n, _assets.size(), failed_n);
+        if (failed_n > 0 && !loading) _failures_shown = !ImGui::Button("Dismiss");
+        else _failures_shown = failed_n > 0;
+        ImGui::End();
+    }
+
+private:
+    struct Entry {
+        Asset* _asset_p;
+        Task _task;
+    };
+    void work() {
+        trace::set_thread_name("loader");
+        while (true) {
+            Entry entry;
+            {
+                std::unique_lock lock { _mutex };
+                _condition.wait(lock, [this]() { return _stopping || _tasks.size() > 0; });
+                if (_stopping) return;
+                entry = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            entry._asset_p->_state.store(State::eLoading, std::memory_order_release);
+            bool success;
+            {
+                trace::Zone zone { "load", entry._asset_p->_name };
+                success = entry._task(entry._asset_p->_progress);
+            }
+            entry._asset_p->_progress.store(1.0f, std::memory_order_relaxed);
+            entry._asset_p->_state.store(success ? State::eReady : State::eFailed, std::memory_order_release);
+        }
+    }
+
+    std::vector<std::unique_ptr<Asset>> _assets;
+    std::deque<Entry> _tasks;
+    std::vector<std::jthread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopping = false;
+    bool _failures_shown = false;
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace parallel {
+    inline auto get_thread_count() -> std::size_t {
+        return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    // workers shared by every for_each, started on first use and joined at exit
+    // callers work on their own job too, so jobs complete even while every worker is busy, e.g. when nested
+    class Pool {
+    public:
+        struct Job {
+            void (*invoke_p)(void*, std::size_t);
+            void* fnc_p;
+            std::size_t n;
+            std::atomic<std::size_t> next = 0;
+            std::size_t helper_n = 0; // workers currently taking items, guarded by the pool's mutex
+        };
+        Pool() {
+            std::size_t worker_n = get_thread_count() - 1;
+            _threads.reserve(worker_n);
+            for (std::size_t i = 0; i < worker_n; i++) _threads.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+        // returns once every item has been processed
+        void run(Job& job) {
+            {
+                std::scoped_lock lock { _mutex };
+                _jobs.push_back(&job);
+            }
+            _wake.notify_all();
+            execute(job);
+            std::unique_lock lock { _mutex };
+            std::erase(_jobs, &job);
+            _done.wait(lock, [&] { return job.helper_n == 0; });
+        }
+        auto get_worker_count() const -> std::size_t {
+            return _threads.size();
+        }
+
+    private:
+        static void execute(Job& job) {
+            for (std::size_t i = job.next++; i < job.n; i = job.next++) job.invoke_p(job.fnc_p, i);
+        }
+        void work(std::stop_token stop) {
+            std::unique_lock lock { _mutex };
+            while (_wake.wait(lock, stop, [&] { return !_jobs.empty(); })) {
+                // exhausted jobs leave the queue, their callers only wait for the workers still inside
+                Job* job_p = _jobs.front();
+                if (job_p->next >= job_p->n) {
+                    _jobs.erase(_jobs.begin());
+                    continue;
+                }
+                job_p->helper_n++;
+                lock.unlock();
+                execute(*job_p);
+                lock.lock();
+                if (--job_p->helper_n == 0) _done.notify_all();
+            }
+        }
+
+        std::mutex _mutex;
+        std::condition_variable_any _wake;
+        std::condition_variable_any _done;
+        std::vector<Job*> _jobs; // oldest first
+        std::vector<std::jthread> _threads; // last, so they are joined before the rest is destroyed
+    };
+    inline auto get_pool() -> Pool& {
+        static Pool pool;
+        return pool;
+    }
+    // invoke fnc(i) for every i in [0, n), distributed dynamically across the calling thread and the pool's workers
+    template<typename Fnc>
+    void for_each(std::size_t n, Fnc&& fnc) {
+        if (n <= 1 || get_thread_count() <= 1) {
+            for (std::size_t i = 0; i < n; i++) fnc(i);
+            return;
+        }
+        using F = std::remove_reference_t<Fnc>;
+        Pool::Job job {
+            .invoke_p = [](void* fnc_p, std::size_t i) { (*static_cast<F*>(fnc_p))(i); },
+            .fnc_p = const_cast<void*>(static_cast<const void*>(std::addressof(fnc))),
+            .n = n,
+        };
+        get_pool().run(job);
+    }
+    // stable lsd radix sort by the lowest key_bits bits of get_key(item), one 8 bit digit per pass
+    // each pass counts digits per batch, then every batch scatters into its own ranges of the digit buckets
+    template<typename T, typename Key>
+    void radix_sort(std::vector<T>& items, Key&& get_key, std::size_t key_bits) {
+        constexpr std::size_t digit_bits = 8;
+        constexpr std::size_t digit_n = 1 << digit_bits;
+        std::size_t batch_size = 1 << 16;
+        std::size_t batch_n = (items.size() + batch_size - 1) / batch_size;
+        std::vector<T> sorted(items.size());
+        std::vector<std::size_t> offsets(batch_n * digit_n);
+        for (std::size_t shift = 0; shift < key_bits; shift += digit_bits) {
+            auto get_digit = [&](const T& item) -> std::size_t {
+                return (std::size_t)(get_key(item) >> shift) & (digit_n - 1);
+            };
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for_each(batch_n, [&](std::size_t b) {
+                std::size_t* counts_p = offsets.data() + b * digit_n;
+                for (std::size_t i = b * batch_size; i < std::min(items.size(), (b + 1) * batch_size); i++) counts_p[get_digit(items[i])]++;
+            });
+            // batches keep their order within each digit, which keeps the sort stable
+            for (std::size_t d = 0, offset = 0; d < digit_n; d++) {
+                for (std::size_t b = 0; b < batch_n; b++) {
+                    std::size_t count = offsets[b * digit_n + d];
+                    offsets[b * digit_n + d] = offset;
+                    offset += count;
+                }
+            }
+            for_each(batch_n, [&](std::size_t b) {
+                std::size_t* offsets_p = offsets.data() + b * digit_n;
+                for (std::size_t i = b * batch_size; i < std::min(items.size(), (b + 1) * batch_size); i++) sorted[offsets_p[get_digit(items[i])]++] = items[i];
+            });
+            items.swap(sorted);
+        }
+    }
+}
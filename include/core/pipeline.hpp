@@ -1,10 +1,16 @@
 #pragma once
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <span>
 #include <string_view>
 #include <vulkan/vulkan.hpp>
 #include <fmt/base.h>
 #include "components/mesh/mesh.hpp"
 #include "core/image.hpp"
 #include "core/buffer.hpp"
+#include "core/trace.hpp"
 
 namespace Pipeline
 {
@@ -19,8 +25,17 @@ namespace Pipeline
 			_desc_sets.clear();
 			_desc_set_layouts.clear();
 			_immutable_samplers.clear();
+			_push_constant_range = vk::PushConstantRange {};
+			_push_constants.clear();
+			_dynamic_bindings.clear();
+			_dynamic_offsets.clear();
+			_frame_i = 0;
 		}
-		void write_descriptor(vk::Device device, uint32_t set, uint32_t binding, Image& image) {
+		// descriptor sets written and bound from now on, one group of sets per frame in flight
+		void set_frame(uint32_t frame_i) {
+			_frame_i = frame_i % _frame_n;
+		}
+		void write_descriptor(vk::Device device, uint32_t set, uint32_t binding, Image& image, vk::DescriptorType type = vk::DescriptorType::eCombinedImageSampler) {
 			// vk::DescriptorImageInfo info_image {
 			// 	.imageView = image._view,
 			// 	.imageLayout = vk::ImageLayout::eGeneral,
@@ -33,22 +48,22 @@ namespace Pipeline
 			// 	.pImageInfo = &info_image,
 			// };
 
-			// set should have an immutable sampler
+			// set should have an immutable sampler, unless the image is only fetched from or stored to
 			vk::DescriptorImageInfo info_image {
 				.imageView = image._view,
-				.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+				.imageLayout = type == vk::DescriptorType::eStorageImage ? vk::ImageLayout::eGeneral : vk::ImageLayout::eShaderReadOnlyOptimal,
 			};
 			vk::WriteDescriptorSet write_image {
-				.dstSet = _desc_sets[set],
+				.dstSet = get_desc_set(set),
 				.dstBinding = binding,
 				.descriptorCount = 1,
-				.descriptorType = vk::DescriptorType::eCombinedImageSampler,
+				.descriptorType = type,
 				.pImageInfo = &info_image,
 			};
 			device.updateDescriptorSets(write_image, {});
 		}
-		void write_descriptor(vk::Device device, uint32_t set, uint32_t binding, vk::Buffer buffer, vk::DeviceSize size) {
-			if (_desc_sets.size() <= set) {
+		void write_descriptor(vk::Device device, uint32_t set, uint32_t binding, vk::Buffer buffer, vk::DeviceSize size, vk::DescriptorType type = vk::DescriptorType::eUniformBufferDynamic) {
+			if (_desc_set_layouts.size() <= set) {
 				fmt::println("Attempted to bind invalid set"); 
 				return;
 			}
@@ -58,18 +73,18 @@ namespace Pipeline
 				.range = size
 			};
 			vk::WriteDescriptorSet write_buffer {
-				.dstSet = _desc_sets[set],
+				.dstSet = get_desc_set(set),
 				.dstBinding = binding,
 				.dstArrayElement = 0,
 				.descriptorCount = 1,
-				.descriptorType = vk::DescriptorType::eUniformBuffer,
+				.descriptorType = type,
 				.pBufferInfo = &info_buffer
 			};
 			device.updateDescriptorSets(write_buffer, {});
 		}
 		template<typename T>
 		void write_descriptor(vk::Device device, uint32_t set, uint32_t binding, DeviceBuffer<T>& buffer) {
-			if (_desc_sets.size() <= set) {
+			if (_desc_set_layouts.size() <= set) {
 				fmt::println("Attempted to bind invalid set"); 
 				return;
 			}
@@ -79,18 +94,52 @@ namespace Pipeline
 				.range = buffer.size()
 			};
 			vk::WriteDescriptorSet write_buffer {
-				.dstSet = _desc_sets[set],
+				.dstSet = get_desc_set(set),
 				.dstBinding = binding,
 				.dstArrayElement = 0,
 				.descriptorCount = 1,
-				.descriptorType = vk::DescriptorType::eUniformBuffer,
+				.descriptorType = vk::DescriptorType::eUniformBufferDynamic,
 				.pBufferInfo = &info_buffer
 			};
 			device.updateDescriptorSets(write_buffer, {});
 		}
+		// offset into the dynamic uniform buffer of a binding, used by subsequent executes
+		void set_dynamic_offset(uint32_t set, uint32_t binding, uint32_t offset) {
+			auto it = std::find(_dynamic_bindings.cbegin(), _dynamic_bindings.cend(), std::make_pair(set, binding));
+			if (it == _dynamic_bindings.cend()) {
+				fmt::println("Attempted to offset non-dynamic binding");
+				return;
+			}
+			_dynamic_offsets[it - _dynamic_bindings.cbegin()] = offset;
+		}
+		// push constant data used by subsequent executes
+		template<typename T>
+		void set_push_constants(const T& data) {
+			if (sizeof(T) != _push_constant_range.size) {
+				fmt::println("push constant size mismatch: {} != {}", sizeof(T), _push_constant_range.size);
+				return;
+			}
+			_push_constants.resize(sizeof(T));
+			std::memcpy(_push_constants.data(), &data, sizeof(T));
+		}
         
 	protected:
-		auto reflect(vk::Device device, const vk::ArrayProxy<std::string_view>& shaderPaths)
+		void push_constants(vk::CommandBuffer cmd) {
+			if (_push_constants.size() == 0) return;
+			cmd.pushConstants(_pipeline_layout, _push_constant_range.stageFlags, 0, (uint32_t)_push_constants.size(), _push_constants.data());
+		}
+		auto get_desc_set(uint32_t set) -> vk::DescriptorSet {
+			return _desc_sets[_frame_i * _desc_set_layouts.size() + set];
+		}
+		// sets of the current frame
+		auto get_frame_desc_sets() -> vk::ArrayProxy<const vk::DescriptorSet> {
+			return { (uint32_t)_desc_set_layouts.size(), _desc_sets.data() + _frame_i * _desc_set_layouts.size() };
+		}
+		auto get_push_constant_ranges() -> vk::ArrayProxy<const vk::PushConstantRange> {
+			if (_push_constant_range.size == 0) return {};
+			return _push_constant_range;
+		}
+		auto reflect(vk::Device device, const vk::ArrayProxy<std::string_view>& shaderPaths, std::span<const vk::Format> vertex_formats = {})
             -> std::pair<vk::VertexInputBindingDescription, std::vector<vk::VertexInputAttributeDescription>>;
 		auto compile(vk::Device device, std::string_view path)
             -> vk::ShaderModule;
@@ -99,19 +148,30 @@ namespace Pipeline
 		vk::Pipeline _pipeline;
 		vk::PipelineLayout _pipeline_layout;
 		vk::DescriptorPool _pool;
-		std::vector<vk::DescriptorSet> _desc_sets;
+		std::vector<vk::DescriptorSet> _desc_sets; // all sets of frame 0, then all sets of frame 1, ...
 		std::vector<vk::DescriptorSetLayout> _desc_set_layouts;
 		std::vector<vk::Sampler> _immutable_samplers;
+		vk::PushConstantRange _push_constant_range;
+		std::vector<std::byte> _push_constants;
+		std::vector<std::pair<uint32_t, uint32_t>> _dynamic_bindings; // set and binding, sorted
+		std::vector<uint32_t> _dynamic_offsets; // one per dynamic binding
+		uint32_t _frame_n = 1;
+		uint32_t _frame_i = 0;
     };
 	struct Compute: Base {
-		void init(vk::Device device, std::string_view cs_path) {
+		void init(vk::Device device, std::string_view cs_path, uint32_t frame_n = 1) {
+			trace::Zone zone { "compute pipeline", cs_path };
 			// reflect shader contents
+			_frame_n = frame_n;
 			reflect(device, cs_path);
 
 			// create pipeline layout
+			auto push_constant_ranges = get_push_constant_ranges();
 			vk::PipelineLayoutCreateInfo info_layout {
 				.setLayoutCount = (uint32_t)_desc_set_layouts.size(),
 				.pSetLayouts = _desc_set_layouts.data(),
+				.pushConstantRangeCount = push_constant_ranges.size(),
+				.pPushConstantRanges = push_constant_ranges.data(),
 			};
 			_pipeline_layout = device.createPipelineLayout(info_layout);
 
@@ -134,7 +194,8 @@ namespace Pipeline
 		}
 		void execute(vk::CommandBuffer cmd, uint32_t x, uint32_t y, uint32_t z) {
 			cmd.bindPipeline(vk::PipelineBindPoint::eCompute, _pipeline);
-			cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _pipeline_layout, 0, _desc_sets, {});
+			cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, _pipeline_layout, 0, get_frame_desc_sets(), _dynamic_offsets);
+			push_constants(cmd);
 			cmd.dispatch(x, y, z);
 		}
 	};
@@ -157,19 +218,28 @@ namespace Pipeline
 			vk::Bool32 primitive_restart = false;
 			vk::CullModeFlags cull_mode = vk::CullModeFlagBits::eBack;
 			//
+			std::vector<vk::Format> vertex_formats; // per location overrides of reflected formats, for packed attributes
+			//
 			std::string_view vs_path;
 			vk::SpecializationInfo* vs_spec = nullptr;
 			std::string_view fs_path;
 			vk::SpecializationInfo* fs_spec = nullptr;
+			//
+			uint32_t frame_n = 1; // frames in flight, each writing its own descriptor sets
 		};
 		void init(const CreateInfo& info) {
+			trace::Zone zone { "graphics pipeline", info.fs_path };
 			// reflect shader contents
-			auto [bind_desc, attr_descs] = reflect(info.device, { info.vs_path, info.fs_path });
+			_frame_n = info.frame_n;
+			auto [bind_desc, attr_descs] = reflect(info.device, { info.vs_path, info.fs_path }, info.vertex_formats);
 
 			// create pipeline layout
+			auto push_constant_ranges = get_push_constant_ranges();
 			vk::PipelineLayoutCreateInfo layoutInfo {
 				.setLayoutCount = (uint32_t)_desc_set_layouts.size(),
-				.pSetLayouts = _desc_set_layouts.data()
+				.pSetLayouts = _desc_set_layouts.data(),
+				.pushConstantRangeCount = push_constant_ranges.size(),
+				.pPushConstantRanges = push_constant_ranges.data(),
 			};
 			_pipeline_layout = info.device.createPipelineLayout(layoutInfo);
 
@@ -298,9 +368,9 @@ namespace Pipeline
 			_stencil_ops = info.stencil_ops;
 		}
 		
-		// draw mesh with color and depth attachments
-		template<typename Vertex, typename Index>
-		void execute(vk::CommandBuffer cmd, Mesh<Vertex, Index>& mesh, 
+		// draw mesh (anything with draw(cmd)) with color and depth attachments
+		template<typename Drawable>
+		void execute(vk::CommandBuffer cmd, Drawable& mesh, 
 			Image& color_dst, vk::AttachmentLoadOp color_load, 
 			DepthStencil& depth_stencil_dst, vk::AttachmentLoadOp depth_stencil_load)
 		{
@@ -331,25 +401,18 @@ namespace Pipeline
 			cmd.beginRendering(info_render);
 			cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, _pipeline);
 			if (_desc_sets.size() > 0) {
-				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, _desc_sets, {});
+				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, get_frame_desc_sets(), _dynamic_offsets);
 			}
+			push_constants(cmd);
 			// draw beg //
-			if (mesh._indices._index_n > 0) {
-				cmd.bindVertexBuffers(0, mesh._vertices._buffer, { 0 });
-				cmd.bindIndexBuffer(mesh._indices._buffer, 0, mesh._indices.get_type());
-				cmd.drawIndexed(mesh._indices._index_n, 1, 0, 0, 0);
-			}
-			else {
-				cmd.bindVertexBuffers(0, mesh._vertices._buffer, { 0 });
-				cmd.draw(mesh._vertices._vertex_n, 1, 0, 0);
-			}
+			mesh.draw(cmd);
 			// draw end //
 			cmd.endRendering();
 		}
 		
 		// draw mesh with only color attachment
-		template<typename Vertex, typename Index>
-		void execute(vk::CommandBuffer cmd, Mesh<Vertex, Index>& mesh, 
+		template<typename Drawable>
+		void execute(vk::CommandBuffer cmd, Drawable& mesh, 
 			Image& color_dst,  vk::AttachmentLoadOp color_load)
 		{
 			vk::RenderingAttachmentInfo info_color_attach {
@@ -371,18 +434,11 @@ namespace Pipeline
 			cmd.beginRendering(info_render);
 			cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, _pipeline);
 			if (_desc_sets.size() > 0) {
-				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, _desc_sets, {});
+				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, get_frame_desc_sets(), _dynamic_offsets);
 			}
+			push_constants(cmd);
 			// draw beg //
-			if (mesh._indices._index_n > 0) {
-				cmd.bindVertexBuffers(0, mesh._vertices._buffer, { 0 });
-				cmd.bindIndexBuffer(mesh._indices._buffer, 0, mesh._indices.get_type());
-				cmd.drawIndexed(mesh._indices._index_n, 1, 0, 0, 0);
-			}
-			else {
-				cmd.bindVertexBuffers(0, mesh._vertices._buffer, { 0 });
-				cmd.draw(mesh._vertices._vertex_n, 1, 0, 0);
-			}
+			mesh.draw(cmd);
 			// draw end //
 			cmd.endRendering();
 		}
@@ -419,8 +475,9 @@ namespace Pipeline
 			cmd.beginRendering(info_render);
 			cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, _pipeline);
 			if (_desc_sets.size() > 0) {
-				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, _desc_sets, {});
+				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, get_frame_desc_sets(), _dynamic_offsets);
 			}
+			push_constants(cmd);
 			cmd.draw(3, 1, 0, 0);
 			cmd.endRendering();
 		}
@@ -448,8 +505,9 @@ namespace Pipeline
 			cmd.beginRendering(info_render);
 			cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, _pipeline);
 			if (_desc_sets.size() > 0) {
-				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, _desc_sets, {});
+				cmd.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipeline_layout, 0, get_frame_desc_sets(), _dynamic_offsets);
 			}
+			push_constants(cmd);
 			cmd.draw(3, 1, 0, 0);
 			cmd.endRendering();
 		}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace platform {
+    // read-only memory mapping of an entire file
+    struct MappedFile {
+        auto open(std::string_view path) -> bool;
+        void close();
+        auto data() const -> std::span<const std::byte> {
+            return { _data_p, _size };
+        }
+
+        const std::byte* _data_p = nullptr;
+        std::size_t _size = 0;
+    };
+
+    // peak resident set size of the current process in bytes
+    auto get_peak_rss() -> std::size_t;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include <vulkan/vulkan.hpp>
 
 struct Queues {
@@ -41,14 +42,22 @@ struct Queues {
             .signalSemaphoreCount = (uint32_t)sign_semaphores.size(),
             .pSignalSemaphores = sign_semaphores.data(),
         };
+        std::scoped_lock lock { _universal_mutex };
         _universal.submit(info);
         _universal.waitIdle();
         device.freeCommandBuffers(_universal_pool, cmd);
     }
+    // wait for the device while no other thread submits
+    void wait_idle(vk::Device device) {
+        std::scoped_lock lock { _universal_mutex };
+        device.waitIdle();
+    }
     // queue handle
     vk::Queue _universal, _graphics, _compute, _transfer;
     // queue family index
     uint32_t _universal_i, _graphics_i, _compute_i, _transfer_i;
+    // guards submissions to the universal queue, which is shared with background loading
+    std::mutex _universal_mutex;
 private:
     // oneshot command pool
     vk::CommandPool _universal_pool;
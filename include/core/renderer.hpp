@@ -1,10 +1,19 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 #include <fmt/base.h>
+#include <imgui.h>
 #include "core/queues.hpp"
 #include "core/swapchain.hpp"
+#include "core/gpu_profiler.hpp"
+#include "core/trace.hpp"
 #include "core/pipeline.hpp"
 #include "core/smaa.hpp"
 #include "core/image.hpp"
@@ -12,18 +21,16 @@
 
 class Renderer {
 public:
-    void init(vk::Device device, vma::Allocator vmalloc, Queues& queues, vk::Extent2D extent, Camera& camera) {
-        // allocate single command pool and buffer pair
-        _command_pool = device.createCommandPool({ .queueFamilyIndex = queues._universal_i });
-        vk::CommandBufferAllocateInfo bufferInfo {
-            .commandPool = _command_pool,
-            .level = vk::CommandBufferLevel::ePrimary,
-            .commandBufferCount = 1,
-        };
-        _command_buffer = device.allocateCommandBuffers(bufferInfo).front();
+    void init(vk::PhysicalDevice phys_device, vk::Device device, vma::Allocator vmalloc, Queues& queues, vk::Extent2D extent, Scene& scene) {
+        trace::Zone zone { "renderer init" };
+        // allocate command pools and fences for each frame in flight
+        _frames.resize(std::clamp<uint32_t>(_frames_in_flight, 1, Scene::frames_max));
+        for (Frame& frame: _frames) frame.init(device, queues);
+        _profiler.init(phys_device, device, queues, (uint32_t)_frames.size() + 1);
+        _wait_sample_i = 0;
+        _reinit_requested = false;
 
-        // allocate semaphores and fences
-        _ready_to_record = device.createFence({ .flags = vk::FenceCreateFlagBits::eSignaled });
+        // allocate semaphores
         _ready_to_write = device.createSemaphore({});
         _ready_to_read = device.createSemaphore({});
         // create dummy submission to initialize _ready_to_write
@@ -32,7 +39,7 @@ public:
         
         // create images and pipelines
         init_images(device, vmalloc, queues, extent);
-        init_pipelines(device, extent, camera);
+        init_pipelines(device, extent, scene);
     }
     void destroy(vk::Device device, vma::Allocator vmalloc) {
         // destroy images
@@ -45,41 +52,82 @@ public:
         _smaa_output.destroy(device, vmalloc);
         // destroy pipelines
         _pipe_default.destroy(device);
+        _pipe_default_packed.destroy(device);
         _pipe_cells.destroy(device);
+        _pipe_cells_filtered.destroy(device);
+        _pipe_bricks.destroy(device);
+        _pipe_slice_quad.destroy(device);
+        _pipe_cull.destroy(device);
+        _pipe_cell_filter.destroy(device);
+        _pipe_slice.destroy(device);
+        _pipe_mc_count.destroy(device);
+        _pipe_mc_emit.destroy(device);
+        _pipe_scan.destroy(device);
         _pipe_smaa_edges.destroy(device);
         _pipe_smaa_weights.destroy(device);
         _pipe_smaa_blending.destroy(device);
-        // destroy command pools
-        device.destroyCommandPool(_command_pool);
+        // destroy per frame resources
+        for (Frame& frame: _frames) frame.destroy(device);
+        _frames.clear();
+        _profiler.destroy(device);
         // destroy synchronization objects
-        device.destroyFence(_ready_to_record);
         device.destroySemaphore(_ready_to_write);
         device.destroySemaphore(_ready_to_read);
     }
     
-    void resize(vk::Device device, vma::Allocator vmalloc, Queues& queues, vk::Extent2D extent, Camera& camera) {
+    void resize(vk::PhysicalDevice phys_device, vk::Device device, vma::Allocator vmalloc, Queues& queues, vk::Extent2D extent, Scene& scene) {
         destroy(device, vmalloc);
-        init(device, vmalloc, queues, extent, camera);
+        init(phys_device, device, vmalloc, queues, extent, scene);
     }
     void wait(vk::Device device) {
-        // wait until the command buffer can be recorded
-        while (vk::Result::eTimeout == device.waitForFences(_ready_to_record, vk::True, UINT64_MAX));
-        device.resetFences(_ready_to_record);
+        // wait until the frame that last used this slot has finished, so its command buffer can be recorded again
+        trace::Zone zone { "fence wait" };
+        auto time_beg = std::chrono::steady_clock::now();
+        Frame& frame = get_frame();
+        while (vk::Result::eTimeout == device.waitForFences(frame._ready_to_record, vk::True, UINT64_MAX));
+        device.resetFences(frame._ready_to_record);
+        _wait_samples[_wait_sample_i++ % _wait_samples.size()] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - time_beg).count();
+    }
+    // slot of the frame about to be recorded, selecting per frame uniforms and descriptor sets
+    auto get_frame_slot() const -> uint32_t {
+        return (uint32_t)(_frame_i % _frames.size());
     }
-    void render(vk::Device device, Swapchain& swapchain, Queues& queues, Scene& scene) {
+    // frames known to have finished after waiting, as each submission waits on all commands of the one before it
+    auto get_finished_frame_count() const -> uint64_t {
+        return _frame_i >= _frames.size() ? _frame_i - _frames.size() + 1 : 0;
+    }
+    // present via the swapchain, or only keep the semaphore chain going when running headless without one
+    void render(vk::Device device, Swapchain* swapchain_p, Queues& queues, Scene& scene) {
+        // frame that last used this slot has finished, collect its timings
+        for (Pipeline::Base* pipe_p: get_pipelines()) pipe_p->set_frame(get_frame_slot());
+        for (Pipeline::Base* pipe_p: get_camera_pipelines()) pipe_p->set_dynamic_offset(0, 0, scene._camera._uniform_offset);
+        display_frames();
+        _profiler.display();
+        update_benchmark(scene);
+        update_isosurface(scene);
+        update_bricks(scene);
+        update_cell_filter(scene);
+        update_slice(scene);
+        update_cells(scene);
+
         // reset and record command buffer
-        device.resetCommandPool(_command_pool, {});
-        vk::CommandBuffer cmd = _command_buffer;
-        cmd.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
-        execute_pipes(cmd, scene);
-
-        // optionally run SMAA
-        if (Keys::pressed(SDLK_P)) _smaa_enabled = !_smaa_enabled;
-        if (_smaa_enabled) execute_smaa(cmd);
-        cmd.end();
-
-        // submit command buffer
-        vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eTopOfPipe;
+        Frame& frame = get_frame();
+        vk::CommandBuffer cmd = frame._command_buffer;
+        {
+            trace::Zone zone { "record" };
+            device.resetCommandPool(frame._command_pool, {});
+            cmd.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+            _profiler.begin_frame(device, cmd, _frame_i, get_finished_frame_count());
+            execute_pipes(device, cmd, scene);
+
+            // optionally run SMAA
+            if (Keys::pressed(SDLK_P)) _smaa_enabled = !_smaa_enabled;
+            if (_smaa_enabled) execute_smaa(cmd);
+            cmd.end();
+        }
+
+        // submit command buffer, no command may start before the previous frame has finished with the shared targets and buffers
+        vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eAllCommands;
         vk::SubmitInfo info_submit {
             .waitSemaphoreCount = 1,
             .pWaitSemaphores = &_ready_to_write,
@@ -89,11 +137,37 @@ public:
             .signalSemaphoreCount = 1,
             .pSignalSemaphores = &_ready_to_read,
         };
-        queues._universal.submit(info_submit, _ready_to_record);
+        {
+            trace::Zone zone { "submit" };
+            std::scoped_lock lock { queues._universal_mutex };
+            queues._universal.submit(info_submit, frame._ready_to_record);
+        }
+        _frame_i++;
         
         // present drawn image
-        swapchain.present(device, *_final_image_p, _ready_to_read, _ready_to_write);
+        if (swapchain_p != nullptr) {
+            swapchain_p->present(device, *_final_image_p, _ready_to_read, _ready_to_write, _profiler);
+            return;
+        }
+        // stand in for the present submission, so frames stay serialized as they would be with a swapchain
+        vk::SubmitInfo info_headless {
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &_ready_to_read,
+            .pWaitDstStageMask = &wait_stage,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &_ready_to_write,
+        };
+        std::scoped_lock lock { queues._universal_mutex };
+        queues._universal.submit(info_headless);
+    }
+    auto get_profiler() -> GpuProfiler& {
+        return _profiler;
     }
+
+    uint32_t _frames_in_flight = 2; // applied on the next init
+    bool _reinit_requested = false; // frames in flight changed
+    bool _smaa_enabled = true;
+
     
 private:
     void init_images(vk::Device device, vma::Allocator vmalloc, Queues& queues, vk::Extent2D extent) {
@@ -167,7 +241,8 @@ private:
         _smaa_area.transition_layout(info_transition);
         queues.oneshot_end(device, cmd);
     }
-    void init_pipelines(vk::Device device, vk::Extent2D extent, Camera& camera) {
+    void init_pipelines(vk::Device device, vk::Extent2D extent, Scene& scene) {
+        trace::Zone zone { "init pipelines" };
         // create graphics pipelines
         _pipe_default.init({
             .device = device, .extent = extent,
@@ -176,6 +251,7 @@ private:
             .depth_write = vk::True, .depth_test = vk::True,
             .cull_mode = vk::CullModeFlagBits::eNone,
             .vs_path = "defaults/default.vert", .fs_path = "defaults/default.frag",
+            .frame_n = (uint32_t)_frames.size(),
         });
         _pipe_cells.init({
             .device = device, .extent = extent,
@@ -184,14 +260,71 @@ private:
             .blend_enabled = vk::True,
             .depth_write = vk::False, .depth_test = vk::True,
             .poly_mode = vk::PolygonMode::eLine,
-            .primitive_topology = vk::PrimitiveTopology::eLineStrip,
-            .primitive_restart = true,
+            .primitive_topology = vk::PrimitiveTopology::eLineList,
             .cull_mode = vk::CullModeFlagBits::eNone,
             .vs_path = "extra/cells.vert", .fs_path = "extra/cells.frag",
+            .frame_n = (uint32_t)_frames.size(),
+        });
+        // one wireframe cube per cell passing the filter
+        _pipe_cells_filtered.init({
+            .device = device, .extent = extent,
+            .color_formats = { _color._format },
+            .depth_format = _depth_stencil._format,
+            .blend_enabled = vk::True,
+            .depth_write = vk::False, .depth_test = vk::True,
+            .poly_mode = vk::PolygonMode::eLine,
+            .primitive_topology = vk::PrimitiveTopology::eLineList,
+            .cull_mode = vk::CullModeFlagBits::eNone,
+            .vs_path = "extra/cells_filtered.vert", .fs_path = "extra/cells.frag",
+            .frame_n = (uint32_t)_frames.size(),
         });
-        // write camera descriptor to pipelines
-        _pipe_default.write_descriptor(device, 0, 0, camera._buffer);
-        _pipe_cells.write_descriptor(device, 0, 0, camera._buffer);
+        // same shaders, but reading the 16 byte packed vertex layout
+        vk::Bool32 packed = vk::True;
+        vk::SpecializationMapEntry packed_spec_entry { .constantID = 0, .offset = 0, .size = sizeof(packed) };
+        vk::SpecializationInfo packed_spec_info {
+            .mapEntryCount = 1,
+            .pMapEntries = &packed_spec_entry,
+            .dataSize = sizeof(packed),
+            .pData = &packed,
+        };
+        _pipe_default_packed.init({
+            .device = device, .extent = extent,
+            .color_formats = { _color._format },
+            .depth_format = _depth_stencil._format,
+            .depth_write = vk::True, .depth_test = vk::True,
+            .cull_mode = vk::CullModeFlagBits::eNone,
+            .vertex_formats = { vk::Format::eR16G16B16A16Unorm, vk::Format::eR16G16Snorm, vk::Format::eR8G8B8A8Unorm },
+            .vs_path = "defaults/default.vert", .vs_spec = &packed_spec_info,
+            .fs_path = "defaults/default.frag",
+            .frame_n = (uint32_t)_frames.size(),
+        });
+        // fullscreen sphere tracing of the brick map, writing the depth of each hit
+        _pipe_bricks.init({
+            .device = device, .extent = extent,
+            .color_formats = { _color._format },
+            .depth_format = _depth_stencil._format,
+            .depth_write = vk::True, .depth_test = vk::True,
+            .cull_mode = vk::CullModeFlagBits::eNone,
+            .vs_path = "defaults/oversized_triangle.vert", .fs_path = "extra/bricks.frag",
+            .frame_n = (uint32_t)_frames.size(),
+        });
+        // plane of sampled signed distances, blended like the cells
+        _pipe_slice_quad.init({
+            .device = device, .extent = extent,
+            .color_formats = { _color._format },
+            .depth_format = _depth_stencil._format,
+            .blend_enabled = vk::True,
+            .depth_write = vk::False, .depth_test = vk::True,
+            .cull_mode = vk::CullModeFlagBits::eNone,
+            .vs_path = "extra/slice.vert", .fs_path = "extra/slice.frag",
+            .frame_n = (uint32_t)_frames.size(),
+        });
+        _pipe_cull.init(device, "defaults/cull.comp", (uint32_t)_frames.size());
+        _pipe_cell_filter.init(device, "extra/cell_filter.comp", (uint32_t)_frames.size());
+        _pipe_slice.init(device, "extra/slice.comp", (uint32_t)_frames.size());
+        _pipe_mc_count.init(device, "extra/mc_count.comp", (uint32_t)_frames.size());
+        _pipe_mc_emit.init(device, "extra/mc_emit.comp", (uint32_t)_frames.size());
+        _pipe_scan.init(device, "defaults/scan.comp", (uint32_t)_frames.size());
 
         // create SMAA pipelines
         glm::aligned_vec4 SMAA_RT_METRICS = {
@@ -227,6 +360,7 @@ private:
             },
             .vs_path = "smaa/edges.vert", .vs_spec = &smaa_spec_info,
             .fs_path = "smaa/edges.frag", .fs_spec = &smaa_spec_info,
+            .frame_n = (uint32_t)_frames.size(),
         });
         _pipe_smaa_weights.init({
             .device = device, .extent = extent,
@@ -243,23 +377,54 @@ private:
             },
             .vs_path = "smaa/weights.vert", .vs_spec = &smaa_spec_info,
             .fs_path = "smaa/weights.frag", .fs_spec = &smaa_spec_info,
+            .frame_n = (uint32_t)_frames.size(),
         });
         _pipe_smaa_blending.init({
             .device = device, .extent = extent,
             .color_formats = { _color._format },
             .vs_path = "smaa/blending.vert", .vs_spec = &smaa_spec_info,
             .fs_path = "smaa/blending.frag", .fs_spec = &smaa_spec_info,
+            .frame_n = (uint32_t)_frames.size(),
         });
-        // update SMAA input texture descriptors
-        _pipe_smaa_edges.write_descriptor(device, 0, 0, _color);
-        _pipe_smaa_weights.write_descriptor(device, 0, 0, _smaa_area);
-        _pipe_smaa_weights.write_descriptor(device, 0, 1, _smaa_search);
-        _pipe_smaa_weights.write_descriptor(device, 0, 2, _smaa_edges);
-        _pipe_smaa_blending.write_descriptor(device, 0, 0, _smaa_weights);
-        _pipe_smaa_blending.write_descriptor(device, 0, 1, _color);
+
+        // descriptors that stay the same, written into the sets of every frame
+        for (uint32_t frame_i = 0; frame_i < _frames.size(); frame_i++) {
+            for (Pipeline::Base* pipe_p: get_pipelines()) pipe_p->set_frame(frame_i);
+            // camera matrix, offset into the uniform ring every frame
+            for (Pipeline::Base* pipe_p: get_camera_pipelines()) {
+                pipe_p->write_descriptor(device, 0, 0, scene._uniforms._buffer._data, sizeof(glm::aligned_mat4x4));
+            }
+            // SMAA input textures, frames execute one after another and can share them
+            _pipe_smaa_edges.write_descriptor(device, 0, 0, _color);
+            _pipe_smaa_weights.write_descriptor(device, 0, 0, _smaa_area);
+            _pipe_smaa_weights.write_descriptor(device, 0, 1, _smaa_search);
+            _pipe_smaa_weights.write_descriptor(device, 0, 2, _smaa_edges);
+            _pipe_smaa_blending.write_descriptor(device, 0, 0, _smaa_weights);
+            _pipe_smaa_blending.write_descriptor(device, 0, 1, _color);
+        }
     }
     
-    void execute_pipes(vk::CommandBuffer cmd, Scene& scene) {
+    void execute_pipes(vk::Device device, vk::CommandBuffer cmd, Scene& scene) {
+        // cull meshlets before rendering begins, assets still loading are skipped
+        auto& scene_data = scene._data;
+        bool main_ready = scene._asset_main->is_ready();
+        if (main_ready) {
+            auto zone = _profiler.zone(cmd, "cull");
+            select_lod(scene_data._mesh_main, scene);
+            execute_cull(device, cmd, scene_data._mesh_main, scene);
+        }
+        bool draw_cells = scene._render_grid && scene._asset_grid->is_ready();
+        if (draw_cells && scene._filter_cells) execute_cell_filter(device, cmd, scene);
+        bool draw_surface = scene._render_surface && scene._asset_grid->is_ready() && scene_data._surface._vertex_capacity > 0;
+        if (draw_surface) execute_isosurface(device, cmd, scene);
+        bool draw_bricks = scene._render_bricks && scene._asset_grid->is_ready() && scene_data._grid._bricks._brick_n > 0;
+        bool draw_slice = scene._render_slice && scene._asset_grid->is_ready() && scene_data._grid._bricks._brick_n > 0;
+        if (draw_bricks || draw_slice) {
+            auto zone = _profiler.zone(cmd, "brick upload");
+            scene_data._grid._bricks.upload(cmd, _frame_i);
+        }
+        if (draw_slice) execute_slice(device, cmd, scene);
+
         // draw scan points
         Image::TransitionInfo info_transition;
         info_transition = {
@@ -277,19 +442,390 @@ private:
         };
         _depth_stencil.transition_layout(info_transition);
 
-        auto& scene_data = scene._data;
-        auto& mesh_main = scene._render_grey ? scene_data._mesh_main_grey._mesh : scene_data._mesh_main._mesh;
-        _pipe_default.execute(cmd, mesh_main, _color, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eClear);
-        if (scene._render_subs) {
-            _pipe_default.execute(cmd, scene_data._mesh_subs[scene._mesh_sub_i]._mesh, _color, vk::AttachmentLoadOp::eLoad);
+        std::optional<glm::vec3> color_main = scene._render_grey ? std::optional(scene._color_grey) : std::nullopt;
+        if (main_ready) {
+            auto zone = _profiler.zone(cmd, "main mesh");
+            execute_plymesh(cmd, scene_data._mesh_main, color_main, _color, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eClear);
+        }
+        else {
+            // only clear attachments while the main mesh is loading
+            struct { void draw(vk::CommandBuffer) {} } nothing;
+            _pipe_default.execute(cmd, nothing, _color, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eClear);
+        }
+        if (scene._render_subs && scene.is_sub_ready()) {
+            auto zone = _profiler.zone(cmd, "sub mesh");
+            execute_plymesh(cmd, scene_data._mesh_subs[scene._mesh_sub_i], scene._color_subs, _color, vk::AttachmentLoadOp::eLoad);
+        }
+        
+        if (draw_surface) {
+            auto zone = _profiler.zone(cmd, "isosurface draw");
+            Isosurface& surface = scene_data._surface;
+            DrawConstants constants {
+                .bounds = surface._bounds,
+                .color = glm::vec4(scene._color_surface, 1),
+            };
+            _pipe_default_packed.set_push_constants(constants);
+            _pipe_default_packed.execute(cmd, surface, _color, vk::AttachmentLoadOp::eLoad, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+        }
+        if (draw_bricks) {
+            auto zone = _profiler.zone(cmd, "brick trace");
+            execute_bricks(device, cmd, scene);
+        }
+        if (draw_slice) {
+            auto zone = _profiler.zone(cmd, "slice draw");
+            Slice& slice = scene_data._slice;
+            _pipe_slice_quad.write_descriptor(device, 0, 1, slice._image);
+            _pipe_slice_quad.set_push_constants(QuadConstants {
+                .corner = glm::vec4(slice._corner, 1),
+                .u = glm::vec4(slice._u, 0),
+                .v = glm::vec4(slice._v, 0),
+            });
+            _pipe_slice_quad.execute(cmd, slice, _color, vk::AttachmentLoadOp::eLoad, _depth_stencil, vk::AttachmentLoadOp::eLoad);
         }
         
         // draw cells
-        if (scene._render_grid) {
-            _pipe_cells.execute(cmd, scene_data._grid._query_points, _color, vk::AttachmentLoadOp::eLoad, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+        if (draw_cells) {
+            auto zone = _profiler.zone(cmd, "cells");
+            Grid& grid = scene_data._grid;
+            if (scene._filter_cells) {
+                CellFilter& filter = scene_data._cell_filter;
+                _pipe_cells_filtered.write_descriptor(device, 0, 1, grid._query_points._data, grid._query_point_n * sizeof(Grid::QueryPoint), vk::DescriptorType::eStorageBuffer);
+                _pipe_cells_filtered.write_descriptor(device, 0, 2, grid._cells._data, grid._cell_n * sizeof(Grid::Cell), vk::DescriptorType::eStorageBuffer);
+                _pipe_cells_filtered.write_descriptor(device, 0, 3, filter._selected._data, filter._cell_n * sizeof(uint32_t), vk::DescriptorType::eStorageBuffer);
+                _pipe_cells_filtered.execute(cmd, filter, _color, vk::AttachmentLoadOp::eLoad, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+            }
+            else {
+                _pipe_cells.write_descriptor(device, 0, 1, grid._query_points._data, grid._query_point_n * sizeof(Grid::QueryPoint), vk::DescriptorType::eStorageBuffer);
+                _pipe_cells.write_descriptor(device, 0, 2, grid._edges._data, grid._edge_n * sizeof(Grid::Edge), vk::DescriptorType::eStorageBuffer);
+                _pipe_cells.execute(cmd, grid, _color, vk::AttachmentLoadOp::eLoad, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+            }
         }
         _final_image_p = &_color;
     }
+    // pick detail levels per chunk from their error projected onto the screen
+    void select_lod(Plymesh& plymesh, Scene& scene) {
+        if (!scene._render_lod) {
+            plymesh.reset_lod();
+            return;
+        }
+        Camera& camera = scene._camera;
+        float px_per_unit = (float)camera._extent.height / (2.0f * std::tan(glm::radians(camera._fov) * 0.5f));
+        plymesh.select_lod(glm::vec3(camera._pos), px_per_unit / scene._lod_error_px);
+    }
+    // select levels and cull meshlets on the gpu, the mesh then draws the compacted indirect commands
+    void execute_cull(vk::Device device, vk::CommandBuffer cmd, Plymesh& plymesh, Scene& scene) {
+        if (plymesh._packed) execute_cull(device, cmd, plymesh._mesh_packed, scene);
+        else execute_cull(device, cmd, plymesh._mesh, scene);
+    }
+    template<typename V>
+    void execute_cull(vk::Device device, vk::CommandBuffer cmd, ChunkedMesh<V>& mesh, Scene& scene) {
+        mesh._indirect = scene._cull_meshlets && mesh._meshlet_n > 0;
+        if (!mesh._indirect) return;
+
+        // the frame that last used these descriptor sets has finished
+        vk::DeviceSize draws_size = 2 * mesh._meshlet_n * sizeof(vk::DrawIndexedIndirectCommand);
+        _pipe_cull.write_descriptor(device, 0, 1, mesh._meshlets._data, mesh._meshlet_n * sizeof(Meshlet), vk::DescriptorType::eStorageBuffer);
+        _pipe_cull.write_descriptor(device, 0, 2, mesh._draws._data, draws_size, vk::DescriptorType::eStorageBuffer);
+        _pipe_cull.write_descriptor(device, 0, 3, mesh._draw_counts._data, 2 * sizeof(uint32_t), vk::DescriptorType::eStorageBuffer);
+
+        // reset draw counts
+        cmd.fillBuffer(mesh._draw_counts._data, 0, 2 * sizeof(uint32_t), 0);
+        vk::MemoryBarrier2 barrier {
+            .srcStageMask = vk::PipelineStageFlagBits2::eClear,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+        };
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+
+        Camera& camera = scene._camera;
+        CullConstants constants {
+            .eye = glm::vec4(glm::vec3(camera._pos), 1),
+            .error_scale = (float)camera._extent.height / (2.0f * std::tan(glm::radians(camera._fov) * 0.5f)) / scene._lod_error_px,
+            .meshlet_n = mesh._meshlet_n,
+            .flags = (scene._render_lod ? 1u : 0u) | 2u | (scene._cull_backfacing ? 4u : 0u),
+        };
+        _pipe_cull.set_push_constants(constants);
+        _pipe_cull.execute(cmd, (mesh._meshlet_n + 63) / 64, 1, 1);
+
+        // draws are read as indirect commands
+        barrier = {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect,
+            .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead,
+        };
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+    }
+    // compact the cells passing the filter whenever its settings changed, the instance count is the selection size
+    void execute_cell_filter(vk::Device device, vk::CommandBuffer cmd, Scene& scene) {
+        Grid& grid = scene._data._grid;
+        CellFilter& filter = scene._data._cell_filter;
+        if (filter._settings_applied == scene._cell_filter) return;
+        filter._settings_applied = scene._cell_filter;
+
+        // the frame that last used these descriptor sets has finished
+        _pipe_cell_filter.write_descriptor(device, 0, 0, grid._query_points._data, grid._query_point_n * sizeof(Grid::QueryPoint), vk::DescriptorType::eStorageBuffer);
+        _pipe_cell_filter.write_descriptor(device, 0, 1, grid._cells._data, grid._cell_n * sizeof(Grid::Cell), vk::DescriptorType::eStorageBuffer);
+        _pipe_cell_filter.write_descriptor(device, 0, 2, filter._selected._data, filter._cell_n * sizeof(uint32_t), vk::DescriptorType::eStorageBuffer);
+        _pipe_cell_filter.write_descriptor(device, 0, 3, filter._draw._data, sizeof(vk::DrawIndirectCommand), vk::DescriptorType::eStorageBuffer);
+
+        auto zone = _profiler.zone(cmd, "cell filter");
+        // reset the instance count, earlier frames have finished reading it as they execute one after another
+        cmd.fillBuffer(filter._draw._data, offsetof(vk::DrawIndirectCommand, instanceCount), sizeof(uint32_t), 0);
+        vk::MemoryBarrier2 barrier {
+            .srcStageMask = vk::PipelineStageFlagBits2::eClear,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+        };
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+
+        const CellFilter::Settings& settings = scene._cell_filter;
+        glm::vec3 extent = grid._bounds_max - grid._bounds_min;
+        FilterConstants constants {
+            .box_min = glm::vec4(grid._bounds_min + settings.box_min * extent, 0),
+            .box_max = glm::vec4(grid._bounds_min + settings.box_max * extent, 0),
+            .threshold = settings.threshold,
+            .cell_n = filter._cell_n,
+            .flags = (settings.zero_crossing ? 1u : 0u) | (settings.near_surface ? 2u : 0u) | (settings.box ? 4u : 0u),
+        };
+        auto [groups_x, groups_y] = get_groups(filter._cell_n, 256);
+        _pipe_cell_filter.set_push_constants(constants);
+        _pipe_cell_filter.execute(cmd, groups_x, groups_y, 1);
+
+        // selection and draw are read by the following draw
+        barrier = {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader,
+            .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead,
+        };
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+    }
+    // read back the selection size and timing once a filter pass has finished, later frames may still be filtering
+    void update_cell_filter(Scene& scene) {
+        auto ms = get_new_ms("cell filter", _filter_sample_n);
+        if (!ms.has_value() || !scene._asset_grid->is_ready()) return;
+        CellFilter& filter = scene._data._cell_filter;
+        filter._selected_n = filter.get_selected_count();
+        filter._filter_ms = ms.value();
+    }
+    // marching cubes over the grid whenever the iso value changed: count vertices per cell, scan them into offsets, then emit
+    void execute_isosurface(vk::Device device, vk::CommandBuffer cmd, Scene& scene) {
+        Grid& grid = scene._data._grid;
+        Isosurface& surface = scene._data._surface;
+        if (surface._iso_extracted == scene._iso_value) return;
+        surface._iso_extracted = scene._iso_value;
+        surface._extract_frame = _frame_i;
+        surface._extract_pending = true;
+
+        // the frame that last used these descriptor sets has finished
+        vk::DeviceSize scan_size = (surface._scan_levels.back().first + 1) * sizeof(uint32_t);
+        for (Pipeline::Compute* pipe_p: { &_pipe_mc_count, &_pipe_mc_emit }) {
+            pipe_p->write_descriptor(device, 0, 0, grid._query_points._data, grid._query_point_n * sizeof(Grid::QueryPoint), vk::DescriptorType::eStorageBuffer);
+            pipe_p->write_descriptor(device, 0, 1, grid._cells._data, grid._cell_n * sizeof(Grid::Cell), vk::DescriptorType::eStorageBuffer);
+            pipe_p->write_descriptor(device, 0, 2, surface._cases._data, 256 * sizeof(Isosurface::Case), vk::DescriptorType::eStorageBuffer);
+            pipe_p->write_descriptor(device, 0, 3, surface._scan._data, scan_size, vk::DescriptorType::eStorageBuffer);
+        }
+        _pipe_mc_emit.write_descriptor(device, 0, 4, surface._vertices._data, (vk::DeviceSize)surface._vertex_capacity * sizeof(Plymesh::VertexPacked), vk::DescriptorType::eStorageBuffer);
+        _pipe_mc_emit.write_descriptor(device, 0, 5, surface._draw._data, sizeof(Isosurface::Draw), vk::DescriptorType::eStorageBuffer);
+        _pipe_scan.write_descriptor(device, 0, 0, surface._scan._data, scan_size, vk::DescriptorType::eStorageBuffer);
+
+        auto zone = _profiler.zone(cmd, "isosurface extract");
+        vk::MemoryBarrier2 barrier {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+        };
+        ExtractConstants constants {
+            .bounds = surface._bounds,
+            .iso = scene._iso_value,
+            .cell_n = surface._cell_n,
+            .vertex_capacity = surface._vertex_capacity,
+            .total_i = surface._scan_levels.back().first,
+        };
+        auto [cell_groups_x, cell_groups_y] = get_groups(surface._cell_n, 256);
+        _pipe_mc_count.set_push_constants(constants);
+        _pipe_mc_count.execute(cmd, cell_groups_x, cell_groups_y, 1);
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+
+        // scan each level in blocks, writing the block totals into the next one up to the total,
+        // then offset each level by the scanned totals on the way back down
+        auto& levels = surface._scan_levels;
+        for (std::size_t i = 0; i + 1 < levels.size(); i++) {
+            auto [groups_x, groups_y] = get_groups(levels[i].second, Isosurface::scan_block);
+            _pipe_scan.set_push_constants(ScanConstants { levels[i].first, levels[i].second, levels[i + 1].first, 0 });
+            _pipe_scan.execute(cmd, groups_x, groups_y, 1);
+            cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+        }
+        for (std::size_t i = levels.size() - 2; i-- > 0;) {
+            auto [groups_x, groups_y] = get_groups(levels[i].second, Isosurface::scan_block);
+            _pipe_scan.set_push_constants(ScanConstants { levels[i].first, levels[i].second, levels[i + 1].first, 1 });
+            _pipe_scan.execute(cmd, groups_x, groups_y, 1);
+            cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+        }
+        _pipe_mc_emit.set_push_constants(constants);
+        _pipe_mc_emit.execute(cmd, cell_groups_x, cell_groups_y, 1);
+
+        // vertices and the draw are read by the following draw
+        barrier = {
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexAttributeInput,
+            .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eVertexAttributeRead,
+        };
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+    }
+    // split workgroups along y once they exceed the guaranteed limit of 65535 per dimension
+    static auto get_groups(uint32_t n, uint32_t group_size) -> std::pair<uint32_t, uint32_t> {
+        uint32_t groups = std::max(1u, (n + group_size - 1) / group_size);
+        uint32_t groups_x = std::min(groups, 65535u);
+        return { groups_x, (groups + groups_x - 1) / groups_x };
+    }
+    // latest extraction time, its triangle count is read back by the surface itself
+    void update_isosurface(Scene& scene) {
+        auto ms = get_new_ms("isosurface extract", _extract_sample_n);
+        if (ms.has_value()) scene._data._surface._extract_ms = ms.value();
+    }
+    // sphere trace the brick map over the whole screen, depth tested against the meshes drawn so far
+    void execute_bricks(vk::Device device, vk::CommandBuffer cmd, Scene& scene) {
+        Bricks& bricks = scene._data._grid._bricks;
+        Camera& camera = scene._camera;
+        // the frame that last used these descriptor sets has finished
+        _pipe_bricks.write_descriptor(device, 0, 1, bricks._indirection, vk::DescriptorType::eSampledImage);
+        _pipe_bricks.write_descriptor(device, 0, 2, bricks._atlas);
+        TraceConstants constants {
+            .inverse_matrix = glm::inverse(glm::mat4x4(camera._matrix)),
+            .eye = glm::vec4(glm::vec3(camera._pos), scene._iso_value),
+            .origin = glm::vec4(bricks._origin, bricks._voxelsize),
+            .dims = glm::uvec4(bricks._dims, glm::packUnorm4x8(glm::vec4(scene._color_bricks, 1))),
+            .viewport = glm::vec4(_color._extent.width, _color._extent.height, 0, 0),
+        };
+        _pipe_bricks.set_push_constants(constants);
+        _pipe_bricks.execute(cmd, _color, vk::AttachmentLoadOp::eLoad, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+    }
+    // sample the brick map across the plane whenever it moved, leaving the image readable by the quad
+    void execute_slice(vk::Device device, vk::CommandBuffer cmd, Scene& scene) {
+        Bricks& bricks = scene._data._grid._bricks;
+        Slice& slice = scene._data._slice;
+        if (slice._settings_applied == scene._slice) return;
+        slice._settings_applied = scene._slice;
+        slice.set_plane(scene._slice, scene._data._grid._bounds_min, scene._data._grid._bounds_max);
+
+        // the frame that last used these descriptor sets has finished
+        _pipe_slice.write_descriptor(device, 0, 0, slice._image, vk::DescriptorType::eStorageImage);
+        _pipe_slice.write_descriptor(device, 0, 1, bricks._indirection, vk::DescriptorType::eSampledImage);
+        _pipe_slice.write_descriptor(device, 0, 2, bricks._atlas);
+
+        auto zone = _profiler.zone(cmd, "slice sample");
+        slice._image.transition_layout({
+            .cmd = cmd,
+            .new_layout = vk::ImageLayout::eGeneral,
+            .dst_stage = vk::PipelineStageFlagBits2::eComputeShader,
+            .dst_access = vk::AccessFlagBits2::eShaderStorageWrite,
+        });
+        _pipe_slice.set_push_constants(SliceConstants {
+            .corner = glm::vec4(slice._corner, 1),
+            .u = glm::vec4(slice._u, 0),
+            .v = glm::vec4(slice._v, 0),
+            .origin = glm::vec4(bricks._origin, bricks._voxelsize),
+            .dims = glm::uvec4(bricks._dims, 0),
+        });
+        _pipe_slice.execute(cmd, (Slice::resolution + 15) / 16, (Slice::resolution + 15) / 16, 1);
+        slice._image.transition_layout({
+            .cmd = cmd,
+            .new_layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .dst_stage = vk::PipelineStageFlagBits2::eFragmentShader,
+            .dst_access = vk::AccessFlagBits2::eShaderSampledRead,
+        });
+    }
+    void update_slice(Scene& scene) {
+        auto ms = get_new_ms("slice sample", _slice_sample_n);
+        if (ms.has_value()) scene._data._slice._slice_ms = ms.value();
+    }
+    // latest cell draw time, to compare query point orders
+    void update_cells(Scene& scene) {
+        auto ms = get_new_ms("cells", _cells_sample_n);
+        if (ms.has_value()) scene._data._grid._draw_ms = ms.value();
+    }
+    // latest trace time
+    void update_bricks(Scene& scene) {
+        auto ms = get_new_ms("brick trace", _trace_sample_n);
+        if (ms.has_value()) scene._data._grid._bricks._trace_ms = ms.value();
+    }
+    // time of a profiler zone if a sample was collected since the count was last updated
+    auto get_new_ms(std::string_view name, std::size_t& sample_n) -> std::optional<double> {
+        auto [ms, sample_n_new] = _profiler.get_latest(name);
+        if (sample_n_new == sample_n) return std::nullopt;
+        sample_n = sample_n_new;
+        if (sample_n_new == 0) return std::nullopt;
+        return ms;
+    }
+    // draw with the pipeline matching the mesh's vertex layout, optionally replacing its vertex colors
+    template<typename... Attachments>
+    void execute_plymesh(vk::CommandBuffer cmd, Plymesh& plymesh, std::optional<glm::vec3> color, Attachments&&... attachments) {
+        DrawConstants constants {
+            .bounds = plymesh._bounds,
+            .color = color.has_value() ? glm::vec4(color.value(), 1) : glm::vec4(0),
+        };
+        if (plymesh._packed) {
+            _pipe_default_packed.set_push_constants(constants);
+            _pipe_default_packed.execute(cmd, plymesh._mesh_packed, std::forward<Attachments>(attachments)...);
+        }
+        else {
+            _pipe_default.set_push_constants(constants);
+            _pipe_default.execute(cmd, plymesh._mesh, std::forward<Attachments>(attachments)...);
+        }
+    }
+    // cpu time spent waiting for frames to finish, against how many frames may be recorded ahead
+    void display_frames() {
+        std::size_t sample_n = std::min(_wait_sample_i, _wait_samples.size());
+        double wait_avg = 0.0;
+        double wait_max = 0.0;
+        for (std::size_t i = 0; i < sample_n; i++) {
+            wait_avg += _wait_samples[i];
+            wait_max = std::max(wait_max, _wait_samples[i]);
+        }
+        if (sample_n > 0) wait_avg /= (double)sample_n;
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        ImGui::Begin("Frames", nullptr, ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_AlwaysAutoResize);
+        int frames_in_flight = (int)_frames_in_flight;
+        if (ImGui::SliderInt("in flight", &frames_in_flight, 1, (int)Scene::frames_max)) {
+            _frames_in_flight = (uint32_t)frames_in_flight;
+            _reinit_requested = _frames_in_flight != _frames.size();
+        }
+        ImGui::Text("cpu waited %.3f ms per frame, %.3f ms at most", wait_avg, wait_max);
+        ImGui::End();
+    }
+    // gpu time of the main mesh draw over a fixed number of frames, started via B
+    void update_benchmark(Scene& scene) {
+        if (Keys::pressed(SDLK_B) && !_bench_running) {
+            fmt::println("benchmarking main mesh draw over {} frames", _bench_frames);
+            _bench_samples.clear();
+            _bench_running = true;
+        }
+        auto ms = get_new_ms("main mesh", _bench_sample_n);
+        if (!_bench_running || !ms.has_value() || !scene._asset_main->is_ready()) return;
+        _bench_samples.push_back(ms.value());
+        if (_bench_samples.size() < _bench_frames) return;
+
+        // report
+        _bench_running = false;
+        std::sort(_bench_samples.begin(), _bench_samples.end());
+        double avg = 0.0;
+        for (double sample: _bench_samples) avg += sample;
+        avg /= (double)_bench_samples.size();
+        Plymesh& mesh = scene._data._mesh_main;
+        fmt::println("main mesh draw ({} vertex layout, {:.1f} MB, {} triangles): avg {:.3f} ms, median {:.3f} ms, p95 {:.3f} ms",
+            mesh._packed ? "packed" : "full",
+            (double)mesh.get_memory_size() / (1024.0 * 1024.0),
+            mesh.get_drawn_index_count() / 3,
+            avg,
+            _bench_samples[_bench_samples.size() / 2],
+            _bench_samples[_bench_samples.size() * 95 / 100]);
+    }
     void execute_smaa(vk::CommandBuffer cmd) {
         Image::TransitionInfo info_transition_read {
             .cmd = cmd,
@@ -304,31 +840,148 @@ private:
             .dst_access = vk::AccessFlagBits2::eColorAttachmentWrite
         };
         // SMAA edge detection
-        _color.transition_layout(info_transition_read);
-        _smaa_edges.transition_layout(info_transition_write);
-        _pipe_smaa_edges.execute(cmd, _smaa_edges, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eLoad);
-
+        {
+            auto zone = _profiler.zone(cmd, "smaa edges");
+            _color.transition_layout(info_transition_read);
+            _smaa_edges.transition_layout(info_transition_write);
+            _pipe_smaa_edges.execute(cmd, _smaa_edges, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+        }
         // SMAA blending weight calculation
-        _smaa_edges.transition_layout(info_transition_read);
-        _smaa_weights.transition_layout(info_transition_write);
-        _pipe_smaa_weights.execute(cmd, _smaa_weights, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eLoad);
-
+        {
+            auto zone = _profiler.zone(cmd, "smaa weights");
+            _smaa_edges.transition_layout(info_transition_read);
+            _smaa_weights.transition_layout(info_transition_write);
+            _pipe_smaa_weights.execute(cmd, _smaa_weights, vk::AttachmentLoadOp::eClear, _depth_stencil, vk::AttachmentLoadOp::eLoad);
+        }
         // SMAA neighborhood blending
-        _smaa_weights.transition_layout(info_transition_read);
-        _smaa_output.transition_layout(info_transition_write);
-        _pipe_smaa_blending.execute(cmd, _smaa_output, vk::AttachmentLoadOp::eClear);
+        {
+            auto zone = _profiler.zone(cmd, "smaa blending");
+            _smaa_weights.transition_layout(info_transition_read);
+            _smaa_output.transition_layout(info_transition_write);
+            _pipe_smaa_blending.execute(cmd, _smaa_output, vk::AttachmentLoadOp::eClear);
+        }
         _final_image_p = &_smaa_output;
     }
 
 private:
-    // synchronization
-    vk::Fence _ready_to_record;
+    // push constants of the default pipelines
+    struct DrawConstants {
+        Plymesh::Bounds bounds;
+        glm::vec4 color; // replaces vertex colors when alpha > 0
+    };
+    // push constants of the meshlet cull pass
+    struct CullConstants {
+        glm::vec4 eye;
+        float error_scale;
+        uint32_t meshlet_n;
+        uint32_t flags;
+        uint32_t pad = 0;
+    };
+    // push constants of the cell filter pass
+    struct FilterConstants {
+        glm::vec4 box_min;
+        glm::vec4 box_max;
+        float threshold;
+        uint32_t cell_n;
+        uint32_t flags;
+        uint32_t pad = 0;
+    };
+    // push constants of both marching cubes passes
+    struct ExtractConstants {
+        Plymesh::Bounds bounds;
+        float iso;
+        uint32_t cell_n;
+        uint32_t vertex_capacity;
+        uint32_t total_i;
+    };
+    // push constants of the brick map trace, 128 bytes
+    struct TraceConstants {
+        glm::mat4x4 inverse_matrix;
+        glm::vec4 eye; // w: iso value
+        glm::vec4 origin; // w: voxelsize
+        glm::uvec4 dims; // w: packed color
+        glm::vec4 viewport;
+    };
+    // push constants of the slice sampling pass
+    struct SliceConstants {
+        glm::vec4 corner;
+        glm::vec4 u;
+        glm::vec4 v;
+        glm::vec4 origin; // w: voxelsize
+        glm::uvec4 dims;
+    };
+    // push constants of the slice quad
+    struct QuadConstants {
+        glm::vec4 corner;
+        glm::vec4 u;
+        glm::vec4 v;
+    };
+    // push constants of each scan level
+    struct ScanConstants {
+        uint32_t beg;
+        uint32_t n;
+        uint32_t sums_beg;
+        uint32_t add;
+    };
+
+    // resources of one frame in flight, reused once its submission has finished
+    struct Frame {
+        void init(vk::Device device, Queues& queues) {
+            _command_pool = device.createCommandPool({ .queueFamilyIndex = queues._universal_i });
+            vk::CommandBufferAllocateInfo bufferInfo {
+                .commandPool = _command_pool,
+                .level = vk::CommandBufferLevel::ePrimary,
+                .commandBufferCount = 1,
+            };
+            _command_buffer = device.allocateCommandBuffers(bufferInfo).front();
+            _ready_to_record = device.createFence({ .flags = vk::FenceCreateFlagBits::eSignaled });
+        }
+        void destroy(vk::Device device) {
+            device.destroyCommandPool(_command_pool);
+            device.destroyFence(_ready_to_record);
+        }
+        // command recording
+        vk::CommandPool _command_pool;
+        vk::CommandBuffer _command_buffer;
+        vk::Fence _ready_to_record;
+    };
+    auto get_frame() -> Frame& {
+        return _frames[_frame_i % _frames.size()];
+    }
+    // every pipeline, to select the descriptor sets of a frame
+    auto get_pipelines() -> std::array<Pipeline::Base*, 15> {
+        return {
+            &_pipe_default, &_pipe_default_packed, &_pipe_cells, &_pipe_cells_filtered, &_pipe_bricks, &_pipe_slice_quad,
+            &_pipe_cull, &_pipe_cell_filter, &_pipe_slice, &_pipe_mc_count, &_pipe_mc_emit, &_pipe_scan,
+            &_pipe_smaa_edges, &_pipe_smaa_weights, &_pipe_smaa_blending,
+        };
+    }
+    // pipelines reading the camera matrix at set 0, binding 0
+    auto get_camera_pipelines() -> std::array<Pipeline::Base*, 7> {
+        return { &_pipe_default, &_pipe_default_packed, &_pipe_cells, &_pipe_cells_filtered, &_pipe_bricks, &_pipe_slice_quad, &_pipe_cull };
+    }
+
+    // synchronization with the swapchain, whose submissions alternate with ours
     vk::Semaphore _ready_to_write;
     vk::Semaphore _ready_to_read;
 
-    // command recording
-    vk::CommandPool _command_pool;
-    vk::CommandBuffer _command_buffer;
+    // frames in flight
+    std::vector<Frame> _frames;
+    uint64_t _frame_i = 0; // frames recorded so far, kept across resizes
+    GpuProfiler _profiler; // per pass timings, including the swapchain's
+
+    // timings, passes are read from the profiler whenever it collected a new sample of them
+    std::size_t _extract_sample_n = 0;
+    std::size_t _trace_sample_n = 0;
+    std::size_t _filter_sample_n = 0;
+    std::size_t _slice_sample_n = 0;
+    std::size_t _cells_sample_n = 0;
+    std::size_t _bench_sample_n = 0;
+    std::array<double, 120> _wait_samples = {}; // cpu time spent waiting for a frame to finish, in ms
+    std::size_t _wait_sample_i = 0;
+    std::vector<double> _bench_samples;
+    std::size_t _bench_frames = 500;
+    bool _bench_running = false;
 
     // Images
     DepthStencil _depth_stencil;
@@ -340,11 +993,21 @@ private:
     Image _smaa_edges;
     Image _smaa_weights;
     Image _smaa_output;
-    bool _smaa_enabled = true;
 
     // pipelines
     Pipeline::Graphics _pipe_default;
+    Pipeline::Graphics _pipe_default_packed;
     Pipeline::Graphics _pipe_cells;
+    Pipeline::Graphics _pipe_cells_filtered;
+    Pipeline::Graphics _pipe_bricks;
+    Pipeline::Graphics _pipe_slice_quad;
+    Pipeline::Compute _pipe_cull;
+    Pipeline::Compute _pipe_cell_filter;
+    Pipeline::Compute _pipe_slice;
+    // isosurface extraction
+    Pipeline::Compute _pipe_mc_count;
+    Pipeline::Compute _pipe_mc_emit;
+    Pipeline::Compute _pipe_scan;
     // SMAA
     Pipeline::Graphics _pipe_smaa_edges;
     Pipeline::Graphics _pipe_smaa_weights;
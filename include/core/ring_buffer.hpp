@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <fmt/base.h>
+#include "core/buffer.hpp"
+
+// persistently mapped uniform buffer with one region per frame in flight
+// each frame sub-allocates its data linearly from its own region, which is bound with dynamic offsets,
+// so a region is only rewritten once the frame that last used its slot has finished
+struct RingBuffer {
+    void init(vma::Allocator vmalloc, const vk::ArrayProxy<uint32_t>& queues, vk::DeviceSize frame_size, uint32_t frame_n) {
+        _frame_size = (frame_size + alignment - 1) / alignment * alignment;
+        _frame_n = frame_n;
+        // host coherent, so writes never have to be flushed
+        _buffer.init(vmalloc,
+            vk::BufferCreateInfo {
+                .size = _frame_size * _frame_n,
+                .usage = vk::BufferUsageFlagBits::eUniformBuffer,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = queues.size(),
+                .pQueueFamilyIndices = queues.data(),
+            },
+            vma::AllocationCreateInfo {
+                .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped,
+                .usage = vma::MemoryUsage::eAutoPreferDevice,
+                .requiredFlags = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                .preferredFlags = vk::MemoryPropertyFlagBits::eDeviceLocal, // ReBAR
+            });
+        _mapped_p = static_cast<std::byte*>(_buffer.map(vmalloc));
+        _frame_i = 0;
+        _offset = 0;
+    }
+    void destroy(vma::Allocator vmalloc) {
+        if (_mapped_p == nullptr) return;
+        vmalloc.unmapMemory(_buffer._allocation);
+        _mapped_p = nullptr;
+        _buffer.destroy(vmalloc);
+    }
+    // start writing into the region of a frame slot, whose previous contents are no longer read
+    void begin_frame(uint32_t frame_slot) {
+        _frame_i = frame_slot % _frame_n;
+        _offset = 0;
+    }
+    // copy data into the current region, returns the dynamic offset to bind it with
+    template<typename T>
+    auto push(const T& data) -> uint32_t {
+        vk::DeviceSize size = (sizeof(T) + alignment - 1) / alignment * alignment;
+        if (_offset + size > _frame_size) {
+            fmt::println("ring buffer region of {} bytes exhausted, overwriting it", _frame_size);
+            _offset = 0;
+        }
+        vk::DeviceSize offset = _frame_i * _frame_size + _offset;
+        std::memcpy(_mapped_p + offset, &data, sizeof(T));
+        _offset += size;
+        return (uint32_t)offset;
+    }
+
+    // largest minUniformBufferOffsetAlignment allowed by the spec, so offsets are valid on every device
+    static constexpr vk::DeviceSize alignment = 256;
+    DeviceBuffer<std::byte> _buffer;
+    std::byte* _mapped_p = nullptr;
+    vk::DeviceSize _frame_size = 0; // bytes per region
+    vk::DeviceSize _offset = 0; // within the current region
+    uint32_t _frame_n = 0;
+    uint32_t _frame_i = 0;
+};
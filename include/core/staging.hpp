@@ -0,0 +1,188 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <functional>
+#include <span>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.hpp>
+#include <fmt/base.h>
+#include "core/queues.hpp"
+
+// chunked upload into a device buffer with bounded host memory
+// writes go straight into the destination when it is host visible (ReBAR),
+// otherwise through two staging chunks so one is filled while the other is being copied
+struct StagingStream {
+    void init(vk::Device device, vma::Allocator vmalloc, Queues& queues, vk::DeviceSize chunk_size = 16ull << 20) {
+        _device = device;
+        _vmalloc = vmalloc;
+        _queue = queues._universal;
+        _queue_mutex_p = &queues._universal_mutex;
+        _queue_family = queues._universal_i;
+        _chunk_size = chunk_size;
+        _command_pool = device.createCommandPool({
+            .flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+            .queueFamilyIndex = _queue_family,
+        });
+        vk::CommandBufferAllocateInfo info_buffers {
+            .commandPool = _command_pool,
+            .level = vk::CommandBufferLevel::ePrimary,
+            .commandBufferCount = (uint32_t)_slots.size(),
+        };
+        auto command_buffers = device.allocateCommandBuffers(info_buffers);
+        for (std::size_t i = 0; i < _slots.size(); i++) {
+            _slots[i]._command_buffer = command_buffers[i];
+            _slots[i]._ready = device.createFence({ .flags = vk::FenceCreateFlagBits::eSignaled });
+        }
+    }
+    void destroy() {
+        wait();
+        for (auto& slot: _slots) {
+            if (slot._buffer) _vmalloc.destroyBuffer(slot._buffer, slot._allocation);
+            _device.destroyFence(slot._ready);
+            slot = {};
+        }
+        _device.destroyCommandPool(_command_pool);
+    }
+
+    // start streaming into dst, which is written directly when mapped
+    // tee receives every committed range as well, e.g. to write a cache while uploading,
+    // writes then go through host memory first, as mapped device memory is too slow to read back
+    void begin(vk::Buffer dst, vma::Allocation dst_allocation, void* dst_mapped_p, std::function<void(std::span<const std::byte>)> tee = {}) {
+        _dst = dst;
+        _dst_allocation = dst_allocation;
+        _dst_mapped_p = static_cast<std::byte*>(dst_mapped_p);
+        _dst_offset = 0;
+        _tee = std::move(tee);
+        if (_dst_mapped_p != nullptr) {
+            vk::MemoryPropertyFlags props = _vmalloc.getAllocationMemoryProperties(dst_allocation);
+            _dst_flushing = !(props & vk::MemoryPropertyFlagBits::eHostCoherent);
+        }
+    }
+    // get memory for the next (at most) size bytes of the destination
+    auto acquire(vk::DeviceSize size) -> std::byte* {
+        if (!_tee) return acquire_dst(size);
+        if (_tee_chunk.size() < size) _tee_chunk.resize(std::max(size, _chunk_size));
+        return _tee_chunk.data();
+    }
+    // publish size bytes written to the last acquired memory
+    void commit(vk::DeviceSize size) {
+        if (!_tee) return commit_dst(size);
+        if (size == 0) return;
+        _tee(std::span<const std::byte>(_tee_chunk.data(), size));
+        std::memcpy(acquire_dst(size), _tee_chunk.data(), size);
+        commit_dst(size);
+    }
+    // wait for all pending copies
+    void wait() {
+        for (auto& slot: _slots) {
+            while (vk::Result::eTimeout == _device.waitForFences(slot._ready, vk::True, UINT64_MAX));
+        }
+    }
+    // streaming chunk size in bytes
+    auto get_chunk_size() const -> vk::DeviceSize {
+        return _chunk_size;
+    }
+
+private:
+    auto acquire_dst(vk::DeviceSize size) -> std::byte* {
+        if (_dst_mapped_p != nullptr) return _dst_mapped_p + _dst_offset;
+
+        // wait until the slot's previous copy has finished
+        Slot& slot = _slots[_slot_i];
+        while (vk::Result::eTimeout == _device.waitForFences(slot._ready, vk::True, UINT64_MAX));
+        if (slot._size < size) {
+            // (re)create staging chunk, only grows past chunk size for oversized writes
+            if (slot._buffer) _vmalloc.destroyBuffer(slot._buffer, slot._allocation);
+            slot._size = std::max(size, _chunk_size);
+            vk::BufferCreateInfo info_buffer {
+                .size = slot._size,
+                .usage = vk::BufferUsageFlagBits::eTransferSrc,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .queueFamilyIndexCount = 1,
+                .pQueueFamilyIndices = &_queue_family,
+            };
+            vma::AllocationCreateInfo info_allocation {
+                .flags =
+                    vma::AllocationCreateFlagBits::eHostAccessSequentialWrite |
+                    vma::AllocationCreateFlagBits::eMapped,
+                .usage = vma::MemoryUsage::eAutoPreferHost,
+            };
+            vma::AllocationInfo info;
+            std::tie(slot._buffer, slot._allocation) = _vmalloc.createBuffer(info_buffer, info_allocation, &info);
+            slot._mapped_p = static_cast<std::byte*>(info.pMappedData);
+            vk::MemoryPropertyFlags props = _vmalloc.getAllocationMemoryProperties(slot._allocation);
+            slot._flushing = !(props & vk::MemoryPropertyFlagBits::eHostCoherent);
+        }
+        return slot._mapped_p;
+    }
+    void commit_dst(vk::DeviceSize size) {
+        if (size == 0) return;
+        if (_dst_mapped_p != nullptr) {
+            if (_dst_flushing) _vmalloc.flushAllocation(_dst_allocation, _dst_offset, size);
+            _dst_offset += size;
+            return;
+        }
+
+        // copy staging chunk into destination
+        Slot& slot = _slots[_slot_i];
+        if (slot._flushing) _vmalloc.flushAllocation(slot._allocation, 0, size);
+        _device.resetFences(slot._ready);
+        vk::CommandBuffer cmd = slot._command_buffer;
+        cmd.reset();
+        cmd.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+        vk::BufferCopy region {
+            .srcOffset = 0,
+            .dstOffset = _dst_offset,
+            .size = size,
+        };
+        cmd.copyBuffer(slot._buffer, _dst, region);
+        // make copies visible to all later reads on this queue
+        vk::MemoryBarrier2 barrier {
+            .srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eMemoryRead,
+        };
+        cmd.pipelineBarrier2({ .memoryBarrierCount = 1, .pMemoryBarriers = &barrier });
+        cmd.end();
+        vk::SubmitInfo info_submit {
+            .commandBufferCount = 1,
+            .pCommandBuffers = &cmd,
+        };
+        {
+            std::scoped_lock lock { *_queue_mutex_p };
+            _queue.submit(info_submit, slot._ready);
+        }
+        _dst_offset += size;
+        _slot_i = (_slot_i + 1) % _slots.size();
+    }
+    struct Slot {
+        vk::CommandBuffer _command_buffer;
+        vk::Fence _ready;
+        vk::Buffer _buffer;
+        vma::Allocation _allocation;
+        std::byte* _mapped_p = nullptr;
+        vk::DeviceSize _size = 0;
+        bool _flushing = false;
+    };
+    vk::Device _device;
+    vma::Allocator _vmalloc;
+    vk::Queue _queue;
+    std::mutex* _queue_mutex_p = nullptr;
+    uint32_t _queue_family = 0;
+    vk::CommandPool _command_pool;
+    std::array<Slot, 2> _slots;
+    std::size_t _slot_i = 0;
+    vk::DeviceSize _chunk_size = 0;
+    // destination
+    vk::Buffer _dst;
+    vma::Allocation _dst_allocation;
+    std::byte* _dst_mapped_p = nullptr;
+    vk::DeviceSize _dst_offset = 0;
+    bool _dst_flushing = false;
+    std::function<void(std::span<const std::byte>)> _tee;
+    std::vector<std::byte> _tee_chunk;
+};
@@ -1,11 +1,14 @@
 #pragma once
 #include <chrono>
+#include <mutex>
 #include <thread>
 #include <vulkan/vulkan.hpp>
 #include "core/window.hpp"
 #include "core/queues.hpp"
 #include "core/imgui.hpp"
 #include "core/image.hpp"
+#include "core/gpu_profiler.hpp"
+#include "core/trace.hpp"
 
 class Swapchain {
     struct SyncFrame {
@@ -43,6 +46,7 @@ public:
         vk::SurfaceCapabilitiesKHR capabilities = phys_device.getSurfaceCapabilitiesKHR(window._surface);
         std::vector<vk::SurfaceFormatKHR> formats = phys_device.getSurfaceFormatsKHR(window._surface);
         _presentation_queue = queues._universal;
+        _presentation_mutex_p = &queues._universal_mutex;
         _extent = window.size();
         // adjust extent in case surface has changed, but no window resize event was received yet
         if (_extent.width < capabilities.minImageExtent.width) _extent.width = capabilities.minImageExtent.width;
@@ -135,36 +139,48 @@ public:
         init(physDevice, device, window, queues);
         fmt::println("Swapchain resized to: {}x{}", _extent.width, _extent.height);
     }
-    void present(vk::Device device, Image& src_image, vk::Semaphore src_ready_to_read, vk::Semaphore src_ready_to_write) {
+    void present(vk::Device device, Image& src_image, vk::Semaphore src_ready_to_read, vk::Semaphore src_ready_to_write, GpuProfiler& profiler) {
         // wait for this frame's fence to be signaled and reset it
         SyncFrame& frame = _sync_frames[_sync_frame_i++ % _sync_frames.size()];
-        while (vk::Result::eTimeout == device.waitForFences(frame._ready_to_record, vk::True, UINT64_MAX));
-        device.resetFences(frame._ready_to_record);
+        {
+            trace::Zone zone { "swapchain fence wait" };
+            while (vk::Result::eTimeout == device.waitForFences(frame._ready_to_record, vk::True, UINT64_MAX));
+            device.resetFences(frame._ready_to_record);
+        }
 
         // acquire image from swapchain
         uint32_t swap_index = 0;
-        for (auto result = vk::Result::eTimeout; result == vk::Result::eTimeout;) {
-            std::tie(result, swap_index) = device.acquireNextImageKHR(_swapchain, UINT64_MAX, frame._ready_to_write);
-            // mark swapchain for resize, but still continue to present
-            if (result == vk::Result::eSuboptimalKHR) {
-                fmt::println("Swapchain image suboptimal");
-                _resize_requested = true;
-            }
-            // abort if swapchain is out of date
-            else
-            if (result == vk::Result::eErrorOutOfDateKHR) {
-                fmt::println("Swapchain image out of date");
-                _resize_requested = true;
-                return;
+        {
+            trace::Zone zone { "acquire" };
+            for (auto result = vk::Result::eTimeout; result == vk::Result::eTimeout;) {
+                std::tie(result, swap_index) = device.acquireNextImageKHR(_swapchain, UINT64_MAX, frame._ready_to_write);
+                // mark swapchain for resize, but still continue to present
+                if (result == vk::Result::eSuboptimalKHR) {
+                    fmt::println("Swapchain image suboptimal");
+                    _resize_requested = true;
+                }
+                // abort if swapchain is out of date
+                else
+                if (result == vk::Result::eErrorOutOfDateKHR) {
+                    fmt::println("Swapchain image out of date");
+                    _resize_requested = true;
+                    return;
+                }
             }
         }
-        
+
         // restart command buffer
         device.resetCommandPool(frame._command_pool);
         vk::CommandBuffer cmd = frame._command_buffer;
         cmd.begin({ .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
-        draw_imgui(cmd, src_image);
-        draw_swapchain(cmd, src_image, swap_index);
+        {
+            auto zone = profiler.zone(cmd, "imgui");
+            draw_imgui(cmd, src_image);
+        }
+        {
+            auto zone = profiler.zone(cmd, "blit");
+            draw_swapchain(cmd, src_image, swap_index);
+        }
         // transition swapchain image into presentation layout
         Image::TransitionInfo info_transition {
             .cmd = cmd,
@@ -178,8 +194,9 @@ public:
         // submit command buffer to graphics queue
         std::array<vk::Semaphore, 2> wait_semaphores = { src_ready_to_read, frame._ready_to_write };
         std::array<vk::Semaphore, 2> sign_semaphores = { src_ready_to_write, frame._ready_to_read };
+        // the blit reads the rendered image, so wait for all of the renderer's commands
         std::array<vk::PipelineStageFlags, 2> wait_stages = { 
-            vk::PipelineStageFlagBits::eTopOfPipe, 
+            vk::PipelineStageFlagBits::eAllCommands, 
             vk::PipelineStageFlagBits::eTopOfPipe 
         };
         vk::SubmitInfo info_submit {
@@ -191,7 +208,9 @@ public:
             .signalSemaphoreCount = (uint32_t)sign_semaphores.size(),
             .pSignalSemaphores = sign_semaphores.data(),
         };
+        std::unique_lock lock { *_presentation_mutex_p };
         _presentation_queue.submit(info_submit, frame._ready_to_record);
+        lock.unlock();
 
         // present swapchain image
         vk::PresentInfoKHR presentInfo {
@@ -202,9 +221,15 @@ public:
             .pImageIndices = &swap_index,
             .pResults = nullptr
         };
-        wait_target_framerate();
+        {
+            trace::Zone zone { "target framerate" };
+            wait_target_framerate();
+        }
         try {
+            trace::Zone zone { "present" };
+            lock.lock();
             vk::Result result = _presentation_queue.presentKHR(presentInfo);
+            lock.unlock();
             if (result == vk::Result::eSuboptimalKHR) {
                 fmt::println("Swapchain suboptimal");
                 _resize_requested = true;
@@ -263,6 +288,7 @@ public:
     vk::Extent2D _extent;
     vk::Format _format;
     vk::Queue _presentation_queue;
+    std::mutex* _presentation_mutex_p = nullptr;
     bool _resize_requested;
 private:
     std::vector<SyncFrame> _sync_frames;
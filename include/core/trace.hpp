@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string_view>
+
+// cpu timeline of scoped zones on every thread, written as chrome trace json (chrome://tracing, ui.perfetto.dev)
+// each thread records into its own ring of the most recent zones, zones cost a single load while no capture runs
+namespace trace {
+    inline std::atomic<bool> capturing = false;
+
+    inline auto now_ns() -> int64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    // append a finished zone to the ring of the calling thread, the name has to be a literal
+    void record(const char* name, std::string_view detail, int64_t beg_ns, int64_t end_ns);
+    // label of the calling thread in the trace
+    void set_thread_name(const char* name);
+    // discard previous zones and start recording
+    void begin_capture();
+    // stop recording and write all recorded zones to path
+    auto end_capture(std::string_view path) -> bool;
+
+    // records the time between construction and destruction, with an optional detail such as a file name
+    struct Zone {
+        Zone(const char* name, std::string_view detail = {}): _name(name), _detail(detail) {
+            if (capturing.load(std::memory_order_relaxed)) _beg_ns = now_ns();
+        }
+        Zone(const Zone&) = delete;
+        ~Zone() {
+            if (_beg_ns >= 0) record(_name, _detail, _beg_ns, now_ns());
+        }
+        const char* _name;
+        std::string_view _detail;
+        int64_t _beg_ns = -1; // not recorded when negative
+    };
+}
@@ -36,6 +36,17 @@ struct Window {
             exit(0);
         }
 
+        vk::Instance instance = create_instance(name, extensions);
+
+        // SDL: create surface
+        VkSurfaceKHR surfaceTemp;
+        if (SDL_Vulkan_CreateSurface(_window_p, instance, nullptr, &surfaceTemp)) fmt::println("{}", SDL_GetError());
+        _surface = surfaceTemp;
+
+        return instance;
+    }
+    // instance with the given extensions, also used without a window for headless runs
+    static auto create_instance(const std::string& name, const std::vector<const char*>& extensions) -> vk::Instance {
         // optionally enable debug layers
         std::vector<const char*> layers;
 #       ifdef VULKAN_VALIDATION_LAYERS
@@ -66,14 +77,7 @@ struct Window {
             .enabledExtensionCount = (uint32_t)extensions.size(),
             .ppEnabledExtensionNames = extensions.data()
         };
-        vk::Instance instance = vk::createInstance(info_instance);
-
-        // SDL: create surface
-        VkSurfaceKHR surfaceTemp;
-        if (SDL_Vulkan_CreateSurface(_window_p, instance, nullptr, &surfaceTemp)) fmt::println("{}", SDL_GetError());
-        _surface = surfaceTemp;
-
-        return instance;
+        return vk::createInstance(info_instance);
     }
     void destroy(vk::Instance instance) {
         instance.destroySurfaceKHR(_surface);
@@ -1,7 +1,7 @@
 #version 460
 
-layout(location = 0) in vec4 in_position;
-layout(location = 1) in vec4 in_normal;
+layout(location = 0) in vec4 in_position; // unorm16 relative to mesh bounds when packed
+layout(location = 1) in vec4 in_normal; // octahedral snorm16 when packed
 layout(location = 2) in vec4 in_color;
 layout(location = 0) out vec3 out_normal;
 layout(location = 1) out vec3 out_color;
@@ -10,10 +10,24 @@ layout(location = 1) out vec3 out_color;
 layout(set = 0, binding = 0) uniform Camera {
     mat4x4 matrix;
 } camera;
+// Mesh bounds to dequantize packed positions (identity otherwise) and optional color override (alpha > 0)
+layout(push_constant) uniform Draw {
+    vec4 bounds_min;
+    vec4 bounds_extent;
+    vec4 color;
+} draw;
+layout(constant_id = 0) const bool packed = false;
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = vec4(in_position.xyz, 1.0);
+    gl_Position = vec4(draw.bounds_min.xyz + in_position.xyz * draw.bounds_extent.xyz, 1.0);
     gl_Position = camera.matrix * gl_Position;
-    out_normal = in_normal.rgb;
-    out_color = in_color.rgb;
-}
\ No newline at end of file
+    out_normal = packed ? oct_decode(in_normal.xy) : in_normal.rgb;
+    out_color = draw.color.a > 0.0 ? draw.color.rgb : in_color.rgb;
+}
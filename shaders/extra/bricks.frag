@@ -0,0 +1,100 @@
+#version 460
+#extension GL_EXT_samplerless_texture_functions: require
+#extension GL_ARB_shading_language_include: require
+#include "extra/bricks.glsl"
+
+layout(location = 0) out vec4 out_color;
+
+// Camera view and projection matrix
+layout(set = 0, binding = 0) uniform Camera {
+    mat4x4 matrix;
+} camera;
+layout(push_constant) uniform Trace {
+    mat4x4 inverse_matrix;
+    vec4 eye; // w: iso value
+    vec4 origin; // w: voxelsize
+    uvec4 dims; // bricks along each axis, w: packed color
+    vec4 viewport; // width, height
+} trace;
+
+const float hit_distance = 0.02;
+const float min_step = 0.05;
+const int max_steps = 512;
+
+// distance to the iso level, empty bricks are outside the surface
+float get_distance(vec3 p) {
+    float signed_distance;
+    if (!get_brick_distance(p, trace.dims.xyz, signed_distance)) return 1.0;
+    return signed_distance - trace.eye.w;
+}
+vec3 get_normal(vec3 p) {
+    const vec2 e = vec2(0.5, 0.0);
+    return normalize(vec3(
+        get_distance(p + e.xyy) - get_distance(p - e.xyy),
+        get_distance(p + e.yxy) - get_distance(p - e.yxy),
+        get_distance(p + e.yyx) - get_distance(p - e.yyx)));
+}
+
+void main() {
+    // view ray in lattice units, reconstructed from the far plane
+    vec2 ndc = gl_FragCoord.xy / trace.viewport.xy * 2.0 - 1.0;
+    vec4 far = trace.inverse_matrix * vec4(ndc, 1.0, 1.0);
+    float voxelsize = trace.origin.w;
+    vec3 ro = (trace.eye.xyz - trace.origin.xyz) / voxelsize;
+    vec3 rd = normalize(far.xyz / far.w - trace.eye.xyz);
+
+    // clip against the volume
+    vec3 volume = vec3(trace.dims.xyz) * brick_voxels;
+    vec3 inv = 1.0 / rd;
+    vec3 t_a = (vec3(0.0) - ro) * inv;
+    vec3 t_b = (volume - ro) * inv;
+    vec3 t_min = min(t_a, t_b);
+    vec3 t_max = max(t_a, t_b);
+    float t = max(max(max(t_min.x, t_min.y), t_min.z), 0.0);
+    float t_end = min(min(t_max.x, t_max.y), t_max.z);
+    if (t >= t_end) discard;
+
+    // walk the bricks along the ray, only occupied ones are sphere traced
+    ivec3 brick = clamp(ivec3(floor((ro + rd * t) / brick_voxels)), ivec3(0), ivec3(trace.dims.xyz) - 1);
+    ivec3 brick_step = ivec3(sign(rd));
+    vec3 t_delta = mix(vec3(1e30), abs(inv) * brick_voxels, notEqual(rd, vec3(0.0)));
+    vec3 t_next = mix(vec3(1e30), ((vec3(brick) + max(sign(rd), 0.0)) * brick_voxels - ro) * inv, notEqual(rd, vec3(0.0)));
+    int steps = 0;
+    bool hit = false;
+    while (!hit && t < t_end && steps < max_steps) {
+        float t_exit = min(min(min(t_next.x, t_next.y), t_next.z), t_end);
+        if (texelFetch(indirection, brick, 0).r != 0u) {
+            float d_prev = 1.0;
+            float t_prev = t;
+            while (t < t_exit && steps < max_steps) {
+                float d = get_distance(ro + rd * t);
+                steps++;
+                if (d < hit_distance) {
+                    // refine crossings of the zero level between the last two samples
+                    if (d < 0.0 && d_prev > 0.0) t = mix(t_prev, t, d_prev / (d_prev - d));
+                    hit = true;
+                    break;
+                }
+                d_prev = d;
+                t_prev = t;
+                t += max(d * 0.9, min_step);
+            }
+            if (hit) break;
+        }
+        steps++;
+        t = t_exit;
+        // step into the neighbouring brick across the nearest boundary
+        if (t_next.x <= t_next.y && t_next.x <= t_next.z) { brick.x += brick_step.x; t_next.x += t_delta.x; }
+        else if (t_next.y <= t_next.z) { brick.y += brick_step.y; t_next.y += t_delta.y; }
+        else { brick.z += brick_step.z; t_next.z += t_delta.z; }
+        if (any(lessThan(brick, ivec3(0))) || any(greaterThanEqual(brick, ivec3(trace.dims.xyz)))) break;
+    }
+    if (!hit) discard;
+
+    vec3 p = ro + rd * t;
+    vec4 clip = camera.matrix * vec4(trace.origin.xyz + p * voxelsize, 1.0);
+    gl_FragDepth = clip.z / clip.w;
+    vec3 light_dir = vec3(0.0, 0.0, -1.0);
+    float intensity = max(dot(get_normal(p), light_dir), 0.0);
+    out_color = vec4(unpackUnorm4x8(trace.dims.w).rgb * intensity, 1.0);
+}
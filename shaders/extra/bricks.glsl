@@ -0,0 +1,19 @@
+// shared by the brick map trace and slice passes
+
+// atlas slot of each brick, packed as 1 << 31 | z << 16 | y << 8 | x, or 0 when empty
+layout(set = 0, binding = 1) uniform utexture3D indirection;
+// 8³ signed distances per brick in voxels, borders shared with the neighbouring bricks
+layout(set = 0, binding = 2) uniform sampler3D atlas;
+
+const float brick_voxels = 7.0;
+
+// trilinear distance at a lattice position, false within empty bricks
+bool get_brick_distance(vec3 p, uvec3 dims, out float signed_distance) {
+    vec3 brick = clamp(floor(p / brick_voxels), vec3(0.0), vec3(dims - 1u));
+    uint entry = texelFetch(indirection, ivec3(brick), 0).r;
+    if (entry == 0u) return false;
+    vec3 slot = vec3(entry & 0xffu, (entry >> 8) & 0xffu, (entry >> 16) & 0xffu);
+    vec3 local = clamp(p - brick * brick_voxels, vec3(0.0), vec3(brick_voxels));
+    signed_distance = textureLod(atlas, (slot * 8.0 + local + 0.5) / vec3(textureSize(atlas, 0)), 0.0).r;
+    return true;
+}
@@ -1,16 +1,24 @@
 #version 460
 
-layout(location = 0) in vec3 in_position;
-layout(location = 1) in float in_signed_distance;
+struct QueryPoint {
+    vec3 position;
+    float signed_distance;
+};
+
 layout(location = 0) out float out_signed_distance;
 
 // Camera view and projection matrix
 layout(set = 0, binding = 0) uniform Camera {
     mat4x4 matrix;
 } camera;
+layout(std430, set = 0, binding = 1) readonly buffer QueryPoints { QueryPoint query_points[]; };
+// unique cell edges as pairs of query point indices
+layout(std430, set = 0, binding = 2) readonly buffer Edges { uvec2 edges[]; };
 
 void main() {
-    gl_Position = vec4(in_position, 1.0);
-    gl_Position = camera.matrix * gl_Position;
-    out_signed_distance = in_signed_distance;
-}
\ No newline at end of file
+    // two vertices per edge
+    uvec2 edge = edges[gl_VertexIndex / 2];
+    QueryPoint point = query_points[gl_VertexIndex % 2 == 0 ? edge.x : edge.y];
+    gl_Position = camera.matrix * vec4(point.position, 1.0);
+    out_signed_distance = point.signed_distance;
+}
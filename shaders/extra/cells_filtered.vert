@@ -0,0 +1,36 @@
+#version 460
+
+struct QueryPoint {
+    vec3 position;
+    float signed_distance;
+};
+struct Cell {
+    uint corners[8];
+};
+
+layout(location = 0) out float out_signed_distance;
+
+// Camera view and projection matrix
+layout(set = 0, binding = 0) uniform Camera {
+    mat4x4 matrix;
+} camera;
+layout(std430, set = 0, binding = 1) readonly buffer QueryPoints { QueryPoint query_points[]; };
+layout(std430, set = 0, binding = 2) readonly buffer Cells { Cell cells[]; };
+// cells passing extra/cell_filter.comp, one instance each
+layout(std430, set = 0, binding = 3) readonly buffer Selected { uint selected[]; };
+
+// corner pairs of the 12 cube edges: front face, back face, then the connecting edges
+const uvec2 edge_corners[12] = uvec2[12](
+    uvec2(0, 1), uvec2(1, 2), uvec2(2, 3), uvec2(3, 0),
+    uvec2(4, 5), uvec2(5, 6), uvec2(6, 7), uvec2(7, 4),
+    uvec2(0, 4), uvec2(1, 5), uvec2(2, 6), uvec2(3, 7)
+);
+
+void main() {
+    // two vertices per edge
+    uvec2 edge = edge_corners[gl_VertexIndex / 2];
+    uint corner = gl_VertexIndex % 2 == 0 ? edge.x : edge.y;
+    QueryPoint point = query_points[cells[selected[gl_InstanceIndex]].corners[corner]];
+    gl_Position = camera.matrix * vec4(point.position, 1.0);
+    out_signed_distance = point.signed_distance;
+}
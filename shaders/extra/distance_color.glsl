@@ -0,0 +1,15 @@
+// color ramp of signed distances in voxels, shared by the cell wireframe and the slice plane
+
+vec4 get_distance_color(float signed_distance) {
+    // create complementary color gradient between negative and positive signed distances
+    vec3 col_negative = vec3(0.0, 1.0, 0.0);
+    vec3 col_positive = vec3(0.0, 0.0, 1.0);
+    vec3 col_sd = mix(col_negative, col_positive, signed_distance * 0.5 + 0.5);
+
+    // mark the "close-to-zero" with a bright red
+    float sd_zero = clamp(signed_distance * 8, -1.0, 1.0);
+    vec3 col_final = mix(vec3(1.0, 0.0, 0.0), col_sd, abs(sd_zero));
+
+    float intensity = 1.0 - abs(signed_distance);
+    return vec4(col_final, intensity);
+}
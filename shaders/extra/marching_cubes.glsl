@@ -0,0 +1,48 @@
+// shared by the marching cubes count and emit passes
+
+struct QueryPoint {
+    vec3 position;
+    float signed_distance;
+};
+struct Cell {
+    uint corners[8];
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer QueryPoints { QueryPoint query_points[]; };
+layout(std430, set = 0, binding = 1) readonly buffer Cells { Cell cells[]; };
+// vertex count, then 15 edge indices packed into 4 bits each
+layout(std430, set = 0, binding = 2) readonly buffer Cases { uvec4 cases[256]; };
+// per cell vertex counts, scanned into vertex offsets between both passes
+layout(std430, set = 0, binding = 3) buffer Scan { uint scan[]; };
+layout(push_constant) uniform Extract {
+    vec4 bounds_min; // to quantize positions
+    vec4 bounds_extent;
+    float iso;
+    uint cell_n;
+    uint vertex_capacity;
+    uint total_i; // of the scanned vertex count within scan
+} extract;
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// corner pairs of the 12 cube edges: front face, back face, then the connecting edges
+const uvec2 edge_corners[12] = uvec2[12](
+    uvec2(0, 1), uvec2(1, 2), uvec2(2, 3), uvec2(3, 0),
+    uvec2(4, 5), uvec2(5, 6), uvec2(6, 7), uvec2(7, 4),
+    uvec2(0, 4), uvec2(1, 5), uvec2(2, 6), uvec2(3, 7)
+);
+
+// dispatches are split along y once they exceed the workgroup count limit
+uint get_cell_index() {
+    return (gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x) * gl_WorkGroupSize.x + gl_LocalInvocationID.x;
+}
+// bit i is set when corner i lies below the iso value
+uint get_case(uint cell_i, out vec3 positions[8], out float distances[8]) {
+    uint case_i = 0;
+    for (uint i = 0; i < 8; i++) {
+        QueryPoint point = query_points[cells[cell_i].corners[i]];
+        positions[i] = point.position;
+        distances[i] = point.signed_distance;
+        case_i |= uint(point.signed_distance < extract.iso) << i;
+    }
+    return case_i;
+}
@@ -0,0 +1,11 @@
+#version 460
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 0) out vec4 out_color;
+
+// written by extra/slice.comp
+layout(set = 0, binding = 1) uniform sampler2D slice;
+
+void main() {
+    out_color = texture(slice, in_uv);
+}
@@ -0,0 +1,21 @@
+#version 460
+
+layout(location = 0) out vec2 out_uv;
+
+// Camera view and projection matrix
+layout(set = 0, binding = 0) uniform Camera {
+    mat4x4 matrix;
+} camera;
+layout(push_constant) uniform Plane {
+    vec4 corner; // world space
+    vec4 u; // edge vectors spanning the plane
+    vec4 v;
+} plane;
+
+void main() {
+    // two triangles spanning the plane
+    const vec2 corners[6] = vec2[6](vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(0, 0), vec2(1, 1), vec2(0, 1));
+    out_uv = corners[gl_VertexIndex];
+    vec3 position = plane.corner.xyz + plane.u.xyz * out_uv.x + plane.v.xyz * out_uv.y;
+    gl_Position = camera.matrix * vec4(position, 1.0);
+}
@@ -0,0 +1,237 @@
+#include <cstring>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <fmt/base.h>
+#include "core/cache.hpp"
+#include "core/parallel.hpp"
+
+namespace cache {
+    namespace {
+        constexpr std::array<char, 8> magic = { 't', 's', 'd', 'f', 'v', 'i', 's', 'c' };
+        constexpr uint32_t format = 1; // of the container, independent of the asset versions
+        constexpr std::size_t page_size = 4096;
+        constexpr std::size_t block_size = 1 << 20; // hashed independently
+        struct Header {
+            std::array<char, 8> magic;
+            uint32_t format;
+            uint32_t entry_n;
+            Stamp stamp;
+            uint64_t checksum; // of the entry table
+        };
+
+        constexpr uint64_t prime_1 = 0x9e3779b185ebca87ull;
+        constexpr uint64_t prime_2 = 0xc2b2ae3d27d4eb4full;
+        constexpr uint64_t prime_3 = 0x165667b19e3779f9ull;
+        auto rotl(uint64_t x, int r) -> uint64_t {
+            return (x << r) | (x >> (64 - r));
+        }
+        auto mix(uint64_t acc, uint64_t value) -> uint64_t {
+            return rotl(acc + value * prime_2, 31) * prime_1;
+        }
+        // four independent lanes over 32 byte stripes, similar to xxhash64
+        auto hash(std::span<const std::byte> data, uint64_t seed) -> uint64_t {
+            std::array<uint64_t, 4> lanes = { seed + prime_1 + prime_2, seed + prime_2, seed, seed - prime_1 };
+            const std::byte* data_p = data.data();
+            std::size_t stripe_n = data.size() / 32;
+            for (std::size_t s = 0; s < stripe_n; s++) {
+                std::array<uint64_t, 4> values;
+                std::memcpy(values.data(), data_p + s * 32, 32);
+                for (std::size_t l = 0; l < 4; l++) lanes[l] = mix(lanes[l], values[l]);
+            }
+            uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+            h += data.size();
+            for (std::size_t i = stripe_n * 32; i < data.size(); i++) {
+                h = rotl(h ^ ((uint64_t)data_p[i] * prime_3), 11) * prime_1;
+            }
+            h ^= h >> 33;
+            h *= prime_2;
+            h ^= h >> 29;
+            h *= prime_3;
+            h ^= h >> 32;
+            return h;
+        }
+        auto align(std::size_t offset) -> std::size_t {
+            return (offset + page_size - 1) / page_size * page_size;
+        }
+    }
+
+    auto get_stamp(std::string_view path, uint32_t version, uint64_t key) -> Stamp {
+        std::error_code error;
+        std::filesystem::path path_fs { path };
+        uint64_t size = std::filesystem::file_size(path_fs, error);
+        if (error) size = 0;
+        auto mtime = std::filesystem::last_write_time(path_fs, error);
+        return Stamp {
+            .source_size = size,
+            .source_mtime = error ? 0 : (int64_t)mtime.time_since_epoch().count(),
+            .key = key,
+            .version = version,
+        };
+    }
+    auto get_checksum(std::span<const std::byte> data) -> uint64_t {
+        std::size_t block_n = (data.size() + block_size - 1) / block_size;
+        if (block_n <= 1) return hash(data, 0);
+        std::vector<uint64_t> hashes(block_n);
+        parallel::for_each(block_n, [&](std::size_t b) {
+            hashes[b] = hash(data.subspan(b * block_size, std::min(block_size, data.size() - b * block_size)), b);
+        });
+        return hash(std::as_bytes(std::span(hashes)), data.size());
+    }
+
+    auto Writer::open(std::string_view path, std::size_t section_n) -> bool {
+        abort();
+        _path = path;
+        _path_tmp = _path + ".tmp";
+        _file.open(_path_tmp, std::ofstream::binary | std::ofstream::trunc);
+        if (!_file.good()) {
+            fmt::println("unable to write cache: {}", _path_tmp);
+            return false;
+        }
+        // sections start on page boundaries after the header and entry table
+        _section_n = section_n;
+        _offset = align(sizeof(Header) + section_n * sizeof(Entry));
+        _failed = false;
+        return true;
+    }
+    auto Writer::reserve(uint32_t id, std::size_t size) -> std::size_t {
+        if (_sections.size() == _section_n) _failed = true;
+        _sections.push_back({ .entry { .id = id, ._pad = 0, .offset = _offset, .size = size, .checksum = 0 } });
+        _offset = align(_offset + size);
+        return _sections.size() - 1;
+    }
+    void Writer::append(std::size_t section_i, std::span<const std::byte> data) {
+        Section& section = _sections[section_i];
+        if (section.written + data.size() > section.entry.size) {
+            _failed = true;
+            return;
+        }
+        _file.seekp((std::streamoff)(section.entry.offset + section.written));
+        _file.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+        section.written += data.size();
+
+        // same blocks as get_checksum(), complete ones are hashed in parallel right away
+        std::size_t pos = 0;
+        if (section.partial.size() > 0) {
+            pos = std::min(block_size - section.partial.size(), data.size());
+            section.partial.insert(section.partial.end(), data.begin(), data.begin() + pos);
+            if (section.partial.size() < block_size) return;
+            section.hashes.push_back(hash(section.partial, section.hashes.size()));
+            section.partial.clear();
+        }
+        std::size_t block_beg = section.hashes.size();
+        std::size_t block_n = (data.size() - pos) / block_size;
+        section.hashes.resize(block_beg + block_n);
+        parallel::for_each(block_n, [&](std::size_t b) {
+            section.hashes[block_beg + b] = hash(data.subspan(pos + b * block_size, block_size), block_beg + b);
+        });
+        section.partial.assign(data.begin() + pos + block_n * block_size, data.end());
+    }
+    auto Writer::commit(const Stamp& stamp) -> bool {
+        std::vector<Entry> entries;
+        for (auto& section: _sections) {
+            _failed = _failed || section.written != section.entry.size;
+            if (section.partial.size() > 0) section.hashes.push_back(hash(section.partial, section.hashes.size()));
+            uint64_t checksum = hash({}, 0);
+            if (section.hashes.size() == 1) checksum = section.hashes[0];
+            else if (section.hashes.size() > 1) checksum = hash(std::as_bytes(std::span(section.hashes)), section.entry.size);
+            entries.push_back(section.entry);
+            entries.back().checksum = checksum;
+        }
+        Header header {
+            .magic = magic,
+            .format = format,
+            .entry_n = (uint32_t)entries.size(),
+            .stamp = stamp,
+            .checksum = get_checksum(std::as_bytes(std::span(entries))),
+        };
+        // the file has to reach the end of the last section, which may have been written before others
+        std::array<char, page_size> padding = {};
+        std::size_t end = entries.size() > 0 ? entries.back().offset + entries.back().size : sizeof(Header);
+        _file.seekp(0, std::ofstream::end);
+        std::size_t size = (std::size_t)_file.tellp();
+        while (size < end) {
+            std::size_t n = std::min(end - size, padding.size());
+            _file.write(padding.data(), (std::streamsize)n);
+            size += n;
+        }
+        _file.seekp(0);
+        _file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        _file.write(reinterpret_cast<const char*>(entries.data()), (std::streamsize)(entries.size() * sizeof(Entry)));
+        _file.close();
+        if (_failed || _file.fail()) {
+            fmt::println("unable to write cache: {}", _path_tmp);
+            abort();
+            return false;
+        }
+
+        // replace the previous cache only once the new one is complete
+        std::error_code error;
+        std::filesystem::rename(_path_tmp, std::filesystem::path(_path), error);
+        if (error) {
+            fmt::println("unable to replace cache: {} ({})", _path, error.message());
+            abort();
+            return false;
+        }
+        _path_tmp.clear();
+        _sections.clear();
+        return true;
+    }
+    void Writer::abort() {
+        if (_file.is_open()) _file.close();
+        std::error_code error;
+        if (!_path_tmp.empty()) std::filesystem::remove(_path_tmp, error);
+        _path_tmp.clear();
+        _sections.clear();
+    }
+
+    auto Reader::open(std::string_view path, const Stamp& stamp, bool verify) -> bool {
+        close();
+        if (!_file.open(path)) return false;
+        auto data = _file.data();
+
+        // outdated caches are silently rejected, corrupted ones are reported
+        Header header;
+        if (data.size() < sizeof(Header)) {
+            fmt::println("corrupted cache: {}", path);
+            close();
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(Header));
+        if (header.magic != magic || header.format != format || header.stamp != stamp) {
+            close();
+            return false;
+        }
+        std::size_t table_end = sizeof(Header) + (std::size_t)header.entry_n * sizeof(Entry);
+        if (table_end > data.size()) {
+            fmt::println("corrupted cache: {}", path);
+            close();
+            return false;
+        }
+        // mapping is page aligned, the table directly follows the 8 byte aligned header
+        _entries = { reinterpret_cast<const Entry*>(data.data() + sizeof(Header)), header.entry_n };
+        bool valid = get_checksum(std::as_bytes(_entries)) == header.checksum;
+        for (const Entry& entry: _entries) {
+            if (!valid) break;
+            valid = entry.offset % page_size == 0 && entry.offset <= data.size() && entry.size <= data.size() - entry.offset;
+            valid = valid && (!verify || get_checksum(data.subspan(entry.offset, entry.size)) == entry.checksum);
+        }
+        if (!valid) {
+            fmt::println("corrupted cache: {}", path);
+            close();
+            return false;
+        }
+        return true;
+    }
+    void Reader::close() {
+        _file.close();
+        _entries = {};
+    }
+    auto Reader::get(uint32_t id) const -> std::span<const std::byte> {
+        for (const Entry& entry: _entries) {
+            if (entry.id == id) return _file.data().subspan(entry.offset, entry.size);
+        }
+        return {};
+    }
+}
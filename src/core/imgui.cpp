@@ -109,5 +109,23 @@ namespace ImGui
             ImGui::DestroyContext();
             device.destroyDescriptorPool(s_imgui_desc_pool);
         }
+        void init_headless(vk::Extent2D extent) {
+            ImGui::CreateContext();
+            ImGuiIO& io = ImGui::GetIO();
+            io.DisplaySize = ImVec2((float)extent.width, (float)extent.height);
+            io.IniFilename = nullptr;
+            // font atlas is never uploaded, but has to exist for new frames
+            io.Fonts->Build();
+        }
+        void new_frame_headless(float delta_s) {
+            ImGui::GetIO().DeltaTime = delta_s > 0.0f ? delta_s : 1.0f / 60.0f;
+            ImGui::NewFrame();
+        }
+        void end_frame_headless() {
+            ImGui::EndFrame();
+        }
+        void shutdown_headless() {
+            ImGui::DestroyContext();
+        }
     }
 }
\ No newline at end of file
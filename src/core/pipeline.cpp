@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <map>
 #include <set>
 #include <span>
@@ -37,7 +38,7 @@ auto Pipeline::Base::compile(vk::Device device, std::string_view path)
 	}
 	return device.createShaderModule(info_shader);
 }
-auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string_view>& shader_paths)
+auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string_view>& shader_paths, std::span<const vk::Format> vertex_formats)
     -> std::pair< vk::VertexInputBindingDescription, std::vector<vk::VertexInputAttributeDescription>>
 {
 	// reflect shaders
@@ -92,6 +93,10 @@ auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string
 		// sort attributes by location
         auto sorter = [](auto& a, auto& b) { return a.location < b.location; };
 		std::sort(std::begin(attr_descs), std::end(attr_descs), sorter);
+		// override reflected formats for packed attributes (e.g. unorm inputs read as vec4)
+		for (std::size_t i = 0; i < attr_descs.size() && i < vertex_formats.size(); i++) {
+			if (vertex_formats[i] != vk::Format::eUndefined) attr_descs[i].format = vertex_formats[i];
+		}
 		// compute final offsets of each attribute and total vertex stride
 		for (auto& attribute: attr_descs) {
 			attribute.offset = vertex_input_desc.stride;
@@ -99,6 +104,20 @@ auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string
 		}
 	}
 
+	// combine push constant blocks of all stages into a single range
+	for (auto& reflection: reflections) {
+		uint32_t blocks_n = 0;
+		auto result = reflection.EnumerateEntryPointPushConstantBlocks("main", &blocks_n, nullptr);
+		if (result != SPV_REFLECT_RESULT_SUCCESS) fmt::println("shader reflection error: {}", (uint32_t)result);
+		std::vector<SpvReflectBlockVariable*> blocks(blocks_n);
+		result = reflection.EnumerateEntryPointPushConstantBlocks("main", &blocks_n, blocks.data());
+		if (result != SPV_REFLECT_RESULT_SUCCESS) fmt::println("shader reflection error: {}", (uint32_t)result);
+		for (auto* block: blocks) {
+			_push_constant_range.stageFlags |= (vk::ShaderStageFlags)reflection.GetShaderStage();
+			_push_constant_range.size = std::max(_push_constant_range.size, block->offset + block->size);
+		}
+	}
+
 	// combine descriptor sets
 	std::vector<SpvReflectDescriptorSet*> refl_desc_sets;
 	for (auto& reflection: reflections) {
@@ -122,8 +141,15 @@ auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string
 			auto [_, unique] = unique_bindings.emplace(binding_p->set, binding_p->binding);
 			if (!unique) continue;
 
+            // uniform buffers are sub-allocated from a ring, so they are bound with dynamic offsets
+            vk::DescriptorType type = (vk::DescriptorType)binding_p->descriptor_type;
+            if (type == vk::DescriptorType::eUniformBuffer) {
+                type = vk::DescriptorType::eUniformBufferDynamic;
+                _dynamic_bindings.emplace_back(binding_p->set, binding_p->binding);
+            }
+
             // tally descriptor types for descriptor pool
-            auto [it_node, emplaced] = binding_tally.emplace((vk::DescriptorType)binding_p->descriptor_type, 1);
+            auto [it_node, emplaced] = binding_tally.emplace(type, 1);
             if (!emplaced) it_node->second++;
 
             // reflect binding
@@ -134,7 +160,7 @@ auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string
             //    binding_p->name);
             vk::DescriptorSetLayoutBinding binding {
                 .binding = binding_p->binding,
-                .descriptorType = (vk::DescriptorType)binding_p->descriptor_type,
+                .descriptorType = type,
                 .descriptorCount = binding_p->count,
                 .stageFlags = stage_flags, // todo: combine stages flags if its present in both
 				.pImmutableSamplers = nullptr
@@ -182,23 +208,29 @@ auto Pipeline::Base::reflect(vk::Device device, const vk::ArrayProxy<std::string
         _desc_set_layouts.emplace_back(device.createDescriptorSetLayout(descLayoutInfo));
     }
 
-    // create descriptor pool
+    // create descriptor pool, with a copy of every set per frame in flight
     std::vector<vk::DescriptorPoolSize> poolSizes;
     poolSizes.reserve(binding_tally.size());
-    for (const auto& pair : binding_tally) poolSizes.emplace_back(pair.first, pair.second);
+    for (const auto& pair : binding_tally) poolSizes.emplace_back(pair.first, pair.second * _frame_n);
     auto poolCreateInfo = vk::DescriptorPoolCreateInfo {
-        .maxSets = (uint32_t)unique_bindings.size(),
+        .maxSets = (uint32_t)unique_bindings.size() * _frame_n,
         .poolSizeCount = (uint32_t)poolSizes.size(), 
         .pPoolSizes = poolSizes.data(),
     };
     _pool = device.createDescriptorPool(poolCreateInfo);
 
     // allocate desc sets
+    std::vector<vk::DescriptorSetLayout> frame_layouts;
+    for (uint32_t i = 0; i < _frame_n; i++) frame_layouts.insert(frame_layouts.end(), _desc_set_layouts.cbegin(), _desc_set_layouts.cend());
     vk::DescriptorSetAllocateInfo allocInfo {
         .descriptorPool = _pool,
-        .descriptorSetCount = (uint32_t)_desc_set_layouts.size(), 
-        .pSetLayouts = _desc_set_layouts.data(),
+        .descriptorSetCount = (uint32_t)frame_layouts.size(), 
+        .pSetLayouts = frame_layouts.data(),
     };
     _desc_sets = device.allocateDescriptorSets(allocInfo);
+
+    // dynamic offsets are consumed in set and binding order
+    std::sort(_dynamic_bindings.begin(), _dynamic_bindings.end());
+    _dynamic_offsets.assign(_dynamic_bindings.size(), 0);
     return { vertex_input_desc, attr_descs };
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include <string>
+#include "core/platform.hpp"
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <sys/resource.h>
+#endif
+
+namespace platform {
+    auto MappedFile::open(std::string_view path) -> bool {
+        close();
+        std::string path_str { path };
+#       if defined(_WIN32)
+            HANDLE file_h = CreateFileA(path_str.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file_h == INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file_h, &size) || size.QuadPart == 0) {
+                CloseHandle(file_h);
+                return false;
+            }
+            HANDLE mapping_h = CreateFileMappingA(file_h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file_h);
+            if (mapping_h == nullptr) return false;
+            // the view keeps the mapping alive after its handle is closed
+            void* data_p = MapViewOfFile(mapping_h, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping_h);
+            if (data_p == nullptr) return false;
+            _size = (std::size_t)size.QuadPart;
+#       else
+            int fd = ::open(path_str.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat info;
+            if (fstat(fd, &info) != 0 || info.st_size == 0) {
+                ::close(fd);
+                return false;
+            }
+            void* data_p = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (data_p == MAP_FAILED) return false;
+            // hint at the (mostly) sequential access pattern of the loaders
+            madvise(data_p, (std::size_t)info.st_size, MADV_SEQUENTIAL);
+            madvise(data_p, (std::size_t)info.st_size, MADV_WILLNEED);
+            _size = (std::size_t)info.st_size;
+#       endif
+        _data_p = static_cast<const std::byte*>(data_p);
+        return true;
+    }
+    void MappedFile::close() {
+        if (_data_p == nullptr) return;
+#       if defined(_WIN32)
+            UnmapViewOfFile(_data_p);
+#       else
+            munmap(const_cast<std::byte*>(_data_p), _size);
+#       endif
+        _data_p = nullptr;
+        _size = 0;
+    }
+
+    auto get_peak_rss() -> std::size_t {
+#       if defined(_WIN32)
+            PROCESS_MEMORY_COUNTERS counters;
+            if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+            return (std::size_t)counters.PeakWorkingSetSize;
+#       else
+            struct rusage usage;
+            if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#           if defined(__APPLE__)
+                return (std::size_t)usage.ru_maxrss; // bytes on macOS
+#           else
+                return (std::size_t)usage.ru_maxrss * 1024; // kilobytes on linux
+#           endif
+#       endif
+    }
+}
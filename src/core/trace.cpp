@@ -0,0 +1,132 @@
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fmt/base.h>
+#include <fmt/format.h>
+#include "core/trace.hpp"
+
+namespace trace {
+    namespace {
+        constexpr std::size_t ring_size = 1 << 15; // zones kept per thread
+        struct Event {
+            const char* name;
+            int64_t beg_ns;
+            int64_t end_ns;
+            std::array<char, 40> detail; // truncated, null terminated
+        };
+        // zones of one thread, the lock is only contended while a capture begins or ends
+        struct Ring {
+            std::mutex mutex;
+            std::vector<Event> events; // allocated on the first recorded zone
+            std::size_t event_n = 0; // recorded since the capture began, the oldest are overwritten
+            std::string thread_name;
+            uint32_t tid;
+        };
+        // rings outlive their threads, so zones of finished workers are still written
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Ring>> rings;
+            int64_t origin_ns = 0; // capture begin
+        };
+        auto get_registry() -> Registry& {
+            static Registry registry;
+            return registry;
+        }
+        auto get_ring() -> Ring& {
+            thread_local Ring* ring_p = nullptr;
+            if (ring_p != nullptr) return *ring_p;
+            Registry& registry = get_registry();
+            std::scoped_lock lock { registry.mutex };
+            ring_p = registry.rings.emplace_back(std::make_unique<Ring>()).get();
+            ring_p->tid = (uint32_t)registry.rings.size();
+            ring_p->thread_name = fmt::format("thread {}", ring_p->tid);
+            return *ring_p;
+        }
+        // names and details are file names or literals, only quotes and backslashes need escaping
+        auto escape(std::string_view str) -> std::string {
+            std::string escaped;
+            escaped.reserve(str.size());
+            for (char c: str) {
+                if (c == '"' || c == '\\') escaped.push_back('\\');
+                if ((unsigned char)c >= 0x20) escaped.push_back(c);
+            }
+            return escaped;
+        }
+    }
+
+    void record(const char* name, std::string_view detail, int64_t beg_ns, int64_t end_ns) {
+        Ring& ring = get_ring();
+        std::scoped_lock lock { ring.mutex };
+        if (ring.events.size() == 0) ring.events.resize(ring_size);
+        Event& event = ring.events[ring.event_n++ % ring_size];
+        event.name = name;
+        event.beg_ns = beg_ns;
+        event.end_ns = end_ns;
+        std::size_t detail_n = std::min(detail.size(), event.detail.size() - 1);
+        std::copy_n(detail.data(), detail_n, event.detail.data());
+        event.detail[detail_n] = '\0';
+    }
+    void set_thread_name(const char* name) {
+        Ring& ring = get_ring();
+        std::scoped_lock lock { ring.mutex };
+        ring.thread_name = name;
+    }
+    void begin_capture() {
+        Registry& registry = get_registry();
+        std::scoped_lock lock { registry.mutex };
+        for (auto& ring_p: registry.rings) {
+            std::scoped_lock lock_ring { ring_p->mutex };
+            ring_p->event_n = 0;
+        }
+        registry.origin_ns = now_ns();
+        capturing.store(true, std::memory_order_relaxed);
+        fmt::println("trace capture started");
+    }
+    auto end_capture(std::string_view path) -> bool {
+        capturing.store(false, std::memory_order_relaxed);
+        std::string path_str { path };
+        std::ofstream file(path_str, std::ofstream::trunc);
+        if (!file.good()) {
+            fmt::println("unable to write trace: {}", path_str);
+            return false;
+        }
+
+        // one complete event per zone in microseconds, plus the name of each thread
+        Registry& registry = get_registry();
+        std::scoped_lock lock { registry.mutex };
+        std::size_t zone_n = 0;
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (auto& ring_p: registry.rings) {
+            std::scoped_lock lock_ring { ring_p->mutex };
+            if (!first) file << ",\n";
+            first = false;
+            file << fmt::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})", ring_p->tid, escape(ring_p->thread_name));
+            std::size_t event_n = std::min(ring_p->event_n, ring_size);
+            for (std::size_t i = ring_p->event_n - event_n; i < ring_p->event_n; i++) {
+                const Event& event = ring_p->events[i % ring_size];
+                if (event.beg_ns < registry.origin_ns) continue;
+                file << fmt::format(R"(,{}{{"name":"{}","cat":"cpu","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f})",
+                    '\n', escape(event.name), ring_p->tid,
+                    (double)(event.beg_ns - registry.origin_ns) / 1000.0,
+                    (double)(event.end_ns - event.beg_ns) / 1000.0);
+                if (event.detail[0] != '\0') file << fmt::format(R"(,"args":{{"detail":"{}"}})", escape(event.detail.data()));
+                file << "}";
+                zone_n++;
+            }
+        }
+        file << "\n]}\n";
+        file.close();
+        if (file.fail()) {
+            fmt::println("unable to write trace: {}", path_str);
+            return false;
+        }
+        fmt::println("trace of {} zones written to {}", zone_n, path_str);
+        return true;
+    }
+}
@@ -1,11 +1,17 @@
 #define SDL_MAIN_USE_CALLBACKS
 #include <SDL3/SDL_main.h>
+#include <string_view>
 #include "core/engine.hpp"
+#include "core/trace.hpp"
 
-SDL_AppResult SDL_AppInit(void** appstate_pp, int, char**) {
+SDL_AppResult SDL_AppInit(void** appstate_pp, int argc, char** argv) {
+    // capture startup as well, otherwise traces are started via T
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--trace") trace::begin_capture();
+    }
     *appstate_pp = new Engine();
     Engine* engine_p = static_cast<Engine*>(*appstate_pp);
-    engine_p->init();
+    engine_p->init(Benchmark::parse(argc, argv));
     return SDL_AppResult::SDL_APP_CONTINUE;
 }
 SDL_AppResult SDL_AppEvent(void* appstate_p, const SDL_Event* event_p) {
@@ -14,8 +20,7 @@ SDL_AppResult SDL_AppEvent(void* appstate_p, const SDL_Event* event_p) {
 }
 SDL_AppResult SDL_AppIterate(void* appstate_p) {
     Engine* engine_p = static_cast<Engine*>(appstate_p);
-    engine_p->execute_frame();
-    return SDL_AppResult::SDL_APP_CONTINUE;
+    return engine_p->execute_frame();
 }
 void SDL_AppQuit(void* appstate_p) {
     Engine* engine_p = static_cast<Engine*>(appstate_p);
@@ -0,0 +1,13 @@
+#pragma once
+#include <fmt/base.h>
+
+// minimal checks, failures are printed and turn the exit code of the test non zero
+inline int check_failures = 0;
+inline void check(bool condition, const char* what) {
+    if (condition) return;
+    fmt::println("check failed: {}", what);
+    check_failures++;
+}
+inline auto check_result() -> int {
+    return check_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fmt/base.h>
+#include "core/parallel.hpp"
+#include "check.hpp"
+
+int main() {
+    // every index is visited exactly once, also for nested and concurrent calls
+    std::vector<std::atomic<uint32_t>> visits(100000);
+    parallel::for_each(visits.size(), [&](std::size_t i) { visits[i]++; });
+    check(std::all_of(visits.begin(), visits.end(), [](const std::atomic<uint32_t>& n) { return n == 1; }), "each index once");
+    std::atomic<std::size_t> sum = 0;
+    {
+        std::vector<std::jthread> callers;
+        for (std::size_t t = 0; t < 4; t++) callers.emplace_back([&]() {
+            for (std::size_t r = 0; r < 50; r++) {
+                parallel::for_each(8, [&](std::size_t) { parallel::for_each(16, [&](std::size_t j) { sum += j; }); });
+            }
+        });
+    }
+    check(sum == 4 * 50 * 8 * 120, "nested and concurrent calls complete");
+
+    // radix sort orders by the key and keeps equal keys in their order
+    std::vector<std::pair<uint32_t, uint32_t>> items(300000);
+    for (uint32_t i = 0; i < items.size(); i++) items[i] = { (uint32_t)((i * 2654435761u) >> 12) % 5000, i };
+    auto expected = items;
+    std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    parallel::radix_sort(items, [](const std::pair<uint32_t, uint32_t>& item) { return item.first; }, 13);
+    fmt::println("sorted {} items on {} threads", items.size(), parallel::get_thread_count());
+    check(items == expected, "stable radix sort");
+    return check_result();
+}
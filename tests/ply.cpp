@@ -0,0 +1,128 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fmt/base.h>
+#include <fmt/format.h>
+#include "components/extra/ply.hpp"
+#include "check.hpp"
+
+// faces with a scalar before and a second list after the index list, so neither decoder can assume a fixed size
+struct Face {
+    uint8_t flags;
+    std::vector<uint32_t> indices;
+    std::vector<float> texcoords;
+};
+static auto get_faces(std::size_t face_n, uint32_t vertex_n, bool triangles_only) -> std::vector<Face> {
+    std::vector<Face> faces(face_n);
+    uint32_t state = 1;
+    auto random = [&]() { state = state * 1664525u + 1013904223u; return state >> 8; };
+    for (Face& face: faces) {
+        face.flags = (uint8_t)random();
+        std::size_t count = triangles_only ? 3 : 3 + random() % 4;
+        for (std::size_t k = 0; k < count; k++) face.indices.push_back(random() % vertex_n);
+        if (!triangles_only) face.texcoords.resize(random() % 3, 0.5f);
+    }
+    return faces;
+}
+static auto get_header(const char* format, uint32_t vertex_n, std::size_t face_n, bool triangles_only) -> std::string {
+    std::string header = fmt::format("ply\nformat {} 1.0\nelement vertex {}\nproperty float x\nproperty float y\nproperty float z\nelement face {}\n", format, vertex_n, face_n);
+    if (triangles_only) header += "property list uchar int vertex_indices\n";
+    else header += "property uchar flags\nproperty list uchar int vertex_indices\nproperty list uchar float texcoord\n";
+    return header + "end_header\n";
+}
+static auto get_binary(uint32_t vertex_n, const std::vector<Face>& faces, bool triangles_only) -> std::vector<std::byte> {
+    std::string file = get_header("binary_little_endian", vertex_n, faces.size(), triangles_only);
+    auto append = [&](const void* src_p, std::size_t size) { file.append(static_cast<const char*>(src_p), size); };
+    for (uint32_t v = 0; v < vertex_n; v++) {
+        float position[3] = { (float)v, 0.0f, 0.0f };
+        append(position, sizeof(position));
+    }
+    for (const Face& face: faces) {
+        if (!triangles_only) append(&face.flags, 1);
+        uint8_t count = (uint8_t)face.indices.size();
+        append(&count, 1);
+        append(face.indices.data(), face.indices.size() * sizeof(uint32_t));
+        if (triangles_only) continue;
+        count = (uint8_t)face.texcoords.size();
+        append(&count, 1);
+        append(face.texcoords.data(), face.texcoords.size() * sizeof(float));
+    }
+    std::vector<std::byte> bytes(file.size());
+    std::memcpy(bytes.data(), file.data(), file.size());
+    return bytes;
+}
+static auto get_ascii(uint32_t vertex_n, const std::vector<Face>& faces) -> std::vector<std::byte> {
+    std::string file = get_header("ascii", vertex_n, faces.size(), false);
+    for (uint32_t v = 0; v < vertex_n; v++) file += fmt::format("{} 0 0\n", v);
+    for (const Face& face: faces) {
+        file += fmt::format("{} {}", face.flags, face.indices.size());
+        for (uint32_t index: face.indices) file += fmt::format(" {}", index);
+        file += fmt::format(" {}", face.texcoords.size());
+        for (float texcoord: face.texcoords) file += fmt::format(" {}", texcoord);
+        file += "\n";
+    }
+    std::vector<std::byte> bytes(file.size());
+    std::memcpy(bytes.data(), file.data(), file.size());
+    return bytes;
+}
+static auto get_fans(const std::vector<Face>& faces) -> std::vector<uint32_t> {
+    std::vector<uint32_t> indices;
+    for (const Face& face: faces) {
+        for (std::size_t k = 2; k < face.indices.size(); k++) indices.insert(indices.end(), { face.indices[0], face.indices[k - 1], face.indices[k] });
+    }
+    return indices;
+}
+static auto decode(std::span<const std::byte> file, std::vector<uint32_t>& indices) -> bool {
+    ply::Header header;
+    if (!header.parse(file)) return false;
+    const ply::Element* vertex_p = header.find("vertex");
+    const ply::Element* face_p = header.find("face");
+    if (vertex_p == nullptr || face_p == nullptr) return false;
+    ply::TriangleReader<uint32_t> reader;
+    if (!reader.init(header, *face_p, *face_p->find("vertex_indices"), vertex_p->count)) return false;
+    indices.assign(reader.get_index_count(0, reader.get_chunk_count()), 0);
+    // decode in two ranges, as the mesh loader does with its upload groups
+    std::size_t half = reader.get_chunk_count() / 2;
+    return reader.read(0, half, indices.data()) && reader.read(half, reader.get_chunk_count(), indices.data() + reader.get_index_count(0, half));
+}
+
+int main() {
+    uint32_t vertex_n = 5000;
+    std::vector<uint32_t> indices;
+
+    // mixed polygons, large enough to be scanned in several pieces
+    std::vector<Face> faces = get_faces(400'000, vertex_n, false);
+    std::vector<uint32_t> expected = get_fans(faces);
+    std::vector<std::byte> binary = get_binary(vertex_n, faces, false);
+    check(decode(binary, indices), "binary polygons decode");
+    check(indices == expected, "binary polygons match");
+
+    // bytes after the last face are ignored
+    binary.resize(binary.size() + 7, std::byte(0xff));
+    check(decode(binary, indices), "binary with trailing bytes decodes");
+    check(indices == expected, "binary with trailing bytes matches");
+
+    std::vector<std::byte> ascii = get_ascii(vertex_n, faces);
+    check(decode(ascii, indices), "ascii polygons decode");
+    check(indices == expected, "ascii polygons match");
+
+    // fixed size triangles take the uniform path
+    std::vector<Face> triangles = get_faces(300'000, vertex_n, true);
+    check(decode(get_binary(vertex_n, triangles, true), indices), "binary triangles decode");
+    check(indices == get_fans(triangles), "binary triangles match");
+
+    // out of range indices and truncated data are rejected
+    faces[123'456].indices[1] = vertex_n;
+    check(!decode(get_binary(vertex_n, faces, false), indices), "binary index out of range");
+    check(!decode(get_ascii(vertex_n, faces), indices), "ascii index out of range");
+    faces[123'456].indices[1] = 0;
+    binary = get_binary(vertex_n, faces, false);
+    binary.resize(binary.size() - 3);
+    check(!decode(binary, indices), "truncated binary");
+    ascii = get_ascii(vertex_n, faces);
+    ascii.resize(ascii.size() - 3);
+    check(!decode(ascii, indices), "truncated ascii");
+    return check_result();
+}
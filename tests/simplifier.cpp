@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include <fmt/base.h>
+#include "components/mesh/simplifier.hpp"
+#include "check.hpp"
+
+// heightfield of n x n quads facing +y, with rolling hills so collapses have to choose
+static void build_heightfield(std::size_t n, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices) {
+    for (std::size_t z = 0; z <= n; z++) {
+        for (std::size_t x = 0; x <= n; x++) {
+            float height = 4.0f * std::sin((float)x * 0.11f) * std::cos((float)z * 0.07f) + 0.5f * std::sin((float)(x + 2 * z) * 0.05f);
+            positions.push_back(glm::vec3((float)x, height, (float)z));
+        }
+    }
+    for (std::size_t z = 0; z < n; z++) {
+        for (std::size_t x = 0; x < n; x++) {
+            uint32_t i = (uint32_t)(z * (n + 1) + x);
+            uint32_t row = (uint32_t)(n + 1);
+            indices.insert(indices.end(), { i, i + row, i + 1, i + 1, i + row, i + row + 1 });
+        }
+    }
+}
+
+int main() {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    build_heightfield(200, positions, indices);
+    std::vector<uint8_t> locked(positions.size(), 0);
+
+    // every triangle keeps facing up and none degenerates
+    std::vector<uint32_t> simplified;
+    std::size_t target_n = indices.size() / 10;
+    float error = simplifier::simplify(indices, positions, locked, target_n, simplified);
+    check(simplified.size() % 3 == 0, "whole triangles");
+    check(simplified.size() < indices.size() / 2, "reduced the triangle count");
+    check(error >= 0.0f && std::isfinite(error), "finite error");
+    std::size_t folded_n = 0;
+    std::size_t degenerate_n = 0;
+    for (std::size_t t = 0; t < simplified.size(); t += 3) {
+        glm::vec3 a = positions[simplified[t + 0]];
+        glm::vec3 b = positions[simplified[t + 1]];
+        glm::vec3 c = positions[simplified[t + 2]];
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length <= 1e-6f) degenerate_n++;
+        else if (n.y / length <= 0.0f) folded_n++;
+    }
+    fmt::println("{} -> {} triangles, {} folded, {} degenerate", indices.size() / 3, simplified.size() / 3, folded_n, degenerate_n);
+    check(folded_n == 0, "no folded triangles");
+    check(degenerate_n == 0, "no degenerate triangles");
+
+    // locked vertices are still referenced
+    std::vector<uint8_t> locked_corners(positions.size(), 0);
+    uint32_t corner = (uint32_t)(positions.size() / 2);
+    locked_corners[corner] = 1;
+    simplifier::simplify(indices, positions, locked_corners, target_n, simplified);
+    bool corner_kept = false;
+    for (uint32_t index: simplified) corner_kept |= index == corner;
+    check(corner_kept, "locked vertex kept");
+
+    // open borders stay in place, so the outline of the heightfield is unchanged
+    bool border_kept = true;
+    std::vector<uint8_t> used(positions.size(), 0);
+    for (uint32_t index: simplified) used[index] = 1;
+    for (std::size_t x = 0; x <= 200; x++) border_kept &= used[x] == 1;
+    check(border_kept, "border vertices kept");
+    return check_result();
+}
@@ -0,0 +1,44 @@
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include <fmt/base.h>
+#include "components/mesh/welder.hpp"
+#include "check.hpp"
+
+static auto weld(const std::vector<glm::vec3>& positions, float epsilon) -> Welder {
+    Welder welder;
+    welder.init(positions.size(), epsilon);
+    for (std::size_t i = 0; i < positions.size(); i++) welder.set(i, positions[i]);
+    welder.weld();
+    return welder;
+}
+
+int main() {
+    // bitwise equal positions merge into their first occurrence, -0.0 included
+    std::vector<glm::vec3> exact = { { 0, 0, 0 }, { 1, 2, 3 }, { -0.0f, 0, 0 }, { 1, 2, 3 }, { 1, 2, 3.0001f } };
+    Welder welder = weld(exact, 0.0f);
+    check(welder.get_unique_count() == 3, "three exact positions");
+    check(welder.remap(2) == welder.remap(0) && welder.remap(3) == welder.remap(1), "duplicates share their id");
+    check(welder.remap(4) == 2 && welder.is_unique(4) && !welder.is_unique(3), "unique ids in order of first occurrence");
+
+    // positions within epsilon merge across cell borders, distant ones in the same cell row do not
+    std::vector<glm::vec3> close = { { 0.00999f, 0, 0 }, { 0.01001f, 0, 0 }, { 0.5f, 0.00999f, 0.00999f }, { 0.5f, 0.01001f, 0.01001f }, { 0.5f, 0.5f, 0.5f } };
+    welder = weld(close, 0.01f);
+    check(welder.remap(1) == welder.remap(0), "merged across an x border");
+    check(welder.remap(3) == welder.remap(2), "merged across a diagonal border");
+    check(welder.get_unique_count() == 3, "three epsilon positions");
+
+    // far out positions are clamped symmetrically rather than wrapping
+    std::vector<glm::vec3> far = { { 1e30f, 0, 0 }, { -1e30f, 0, 0 }, { 0, 0, 0 } };
+    welder = weld(far, 0.01f);
+    check(welder.get_unique_count() == 3, "clamped positions stay apart");
+
+    // a grid spaced wider than epsilon keeps every vertex
+    std::vector<glm::vec3> grid;
+    for (std::size_t i = 0; i < 200000; i++) grid.push_back(glm::vec3((float)(i % 500) * 0.015f, (float)(i / 500) * 0.015f, 0.0f));
+    welder = weld(grid, 0.01f);
+    fmt::println("{} of {} grid vertices unique", welder.get_unique_count(), grid.size());
+    check(welder.get_unique_count() == grid.size(), "spaced grid unchanged");
+    return check_result();
+}